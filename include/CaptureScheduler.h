@@ -0,0 +1,139 @@
+#ifndef CAPTURE_SCHEDULER_H
+#define CAPTURE_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RawImage.h"
+#include "CaptureSettings.h"
+
+class X11ScreenCapturer;
+
+/**
+ * Queue every capture request goes through. Captures run at their due time
+ * on a capture thread, so neither delays nor the captures themselves block
+ * the GTK main loop. The thread opens its own X connection and capturer
+ * when the first job runs.
+ *
+ * Requests for a target that already has a job waiting are coalesced into
+ * that job, so a burst of triggers (key repeat, repeated commands) costs one
+ * capture. Only the grab is shared: every request keeps its completion
+ * callback and each one is called with the result. The number of waiting jobs is bounded; when the queue is full
+ * either the oldest waiting job or the new request is dropped.
+ */
+class CaptureScheduler {
+public:
+    // Runs on the capture thread; fills the image and returns false on failure
+    using CaptureJob = std::function<bool(X11ScreenCapturer& capturer, RawImage& raw)>;
+    // Called with the image, or nullptr if the capture failed or the job was
+    // cancelled or dropped. Runs on the capture thread, or on the caller's
+    // thread for jobs removed by cancel() or schedule(); hand the work to
+    // the main loop
+    using CompletionCallback = std::function<void(uint64_t id, std::shared_ptr<RawImage> raw)>;
+
+    enum class DropPolicy {
+        DropOldest,  // Make room by dropping the job waiting longest
+        RejectNew    // Refuse the new request
+    };
+
+    struct Stats {
+        uint64_t queued = 0;     // Jobs accepted
+        uint64_t coalesced = 0;  // Requests merged into a waiting job
+        uint64_t dropped = 0;    // Jobs or requests dropped because the queue was full
+        uint64_t completed = 0;  // Captures that succeeded
+        uint64_t failed = 0;     // Captures that failed
+        size_t pending = 0;      // Jobs waiting or running
+    };
+
+    /**
+     * Constructor starts the capture thread.
+     */
+    CaptureScheduler();
+
+    /**
+     * Destructor drops pending jobs (without callbacks) and stops the thread.
+     */
+    ~CaptureScheduler();
+
+    CaptureScheduler(const CaptureScheduler&) = delete;
+    CaptureScheduler& operator=(const CaptureScheduler&) = delete;
+
+    /**
+     * Queue a capture.
+     * @param due When to capture
+     * @param key Target of the capture; a request for a key that has a job
+     *            waiting joins that job (moved to the earlier due time) and
+     *            its job is discarded. Empty keys are never coalesced.
+     * @param job Capture to run
+     * @param callback Completion callback, called even if the request joined
+     *                 a waiting job
+     * @param coalesced Set to whether the request joined a waiting job
+     * @return Job id for cancel(), 0 if the request was dropped
+     */
+    uint64_t schedule(std::chrono::steady_clock::time_point due, const std::string& key,
+                      CaptureJob job, CompletionCallback callback, bool* coalesced = nullptr);
+
+    /**
+     * Remove a job that has not started; the callbacks of every request it
+     * answers get nullptr.
+     * @return False if the job already ran or is running
+     */
+    bool cancel(uint64_t id);
+
+    /**
+     * Maximum number of waiting jobs (8 by default) and what to drop when
+     * a request arrives with the queue full.
+     */
+    void set_max_pending(size_t max_pending);
+    void set_drop_policy(DropPolicy policy);
+    size_t get_max_pending() const;
+    DropPolicy get_drop_policy() const;
+
+    /**
+     * Settings for the capture thread's capturer, normally those of the
+     * main capturer. Applied before the next job runs.
+     */
+    void set_capture_settings(const CaptureSettings& settings);
+    CaptureSettings get_capture_settings() const;
+
+    /**
+     * Number of jobs not yet finished.
+     */
+    size_t pending() const;
+
+    Stats stats() const;
+
+private:
+    struct Job {
+        uint64_t id;
+        std::string key;
+        CaptureJob capture;
+        // One per request coalesced into the job, in request order
+        std::vector<CompletionCallback> callbacks;
+    };
+    using JobQueue = std::multimap<std::chrono::steady_clock::time_point, Job>;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    // By due time; jobs due at the same time keep their order
+    JobQueue jobs_;
+    uint64_t next_id_;
+    size_t max_pending_;
+    DropPolicy drop_policy_;
+    CaptureSettings settings_;
+    Stats stats_;
+    bool busy_;
+    bool stopping_;
+
+    void run();
+};
+
+#endif // CAPTURE_SCHEDULER_H
@@ -0,0 +1,33 @@
+#ifndef CAPTURE_SETTINGS_H
+#define CAPTURE_SETTINGS_H
+
+#include <string>
+#include "ImageScaler.h"
+#include "PngEncoder.h"
+
+/**
+ * Settings that change how a capturer grabs and encodes pixels. The main
+ * capturer is configured from the settings file and the panel; capturers
+ * on worker threads take a copy of its settings so every capture behaves
+ * the same wherever it runs.
+ */
+struct CaptureSettings {
+    bool use_shm = true;      // MIT-SHM grabs
+    bool use_mirror = false;  // Damage-tracked desktop mirror for screen captures
+
+    std::string output_format = "png";
+    int quality = 85;  // Lossy formats
+    PngEncoder::Preset png_preset = PngEncoder::Preset::Balanced;
+    int png_compression_level = 4;  // zlib level, the preset's unless overridden
+    ImageScaler::Filter scale_filter = ImageScaler::Filter::Area;
+
+    bool operator==(const CaptureSettings& other) const {
+        return use_shm == other.use_shm && use_mirror == other.use_mirror &&
+               output_format == other.output_format && quality == other.quality &&
+               png_preset == other.png_preset && png_compression_level == other.png_compression_level &&
+               scale_filter == other.scale_filter;
+    }
+    bool operator!=(const CaptureSettings& other) const { return !(*this == other); }
+};
+
+#endif // CAPTURE_SETTINGS_H
@@ -0,0 +1,67 @@
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "EncodedImage.h"
+
+/**
+ * Writes encoded captures to disk on a background thread, so capturing and
+ * publishing never wait on file I/O.
+ */
+class CaptureWriter {
+public:
+    // Called on the writer thread once the file is in place (or the write failed)
+    using CompletionCallback = std::function<void(const std::string& path, bool success)>;
+
+    /**
+     * Constructor starts the writer thread.
+     */
+    CaptureWriter();
+
+    /**
+     * Destructor finishes pending writes and stops the thread.
+     */
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * Queue an image to be written.
+     * @param path Destination file, parent directories are created as needed
+     * @param image Encoded image, shared so the caller can keep publishing it
+     * @param callback Optional completion callback
+     */
+    void write(const std::string& path, std::shared_ptr<const EncodedImage> image,
+               CompletionCallback callback = nullptr);
+
+    /**
+     * Number of writes not yet finished.
+     */
+    size_t pending() const;
+
+private:
+    struct Job {
+        std::string path;
+        std::shared_ptr<const EncodedImage> image;
+        CompletionCallback callback;
+    };
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool busy_;
+    bool stopping_;
+
+    void run();
+    static bool write_file(const std::string& path, const EncodedImage& image);
+};
+
+#endif // CAPTURE_WRITER_H
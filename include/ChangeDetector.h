@@ -0,0 +1,82 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RawImage.h"
+
+/**
+ * Tells whether a capture differs from the previous capture of the same
+ * target (a window, screen or region) without keeping its pixels.
+ * Captures are split into 64x64 tiles and each tile is reduced to a 64-bit
+ * hash, an XXH3-style multiply-accumulate with an AVX2 version selected at
+ * runtime. Comparing the hashes of two captures gives the changed tiles and
+ * their bounding box.
+ */
+class ChangeDetector {
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    struct TileHashes {
+        int width = 0;
+        int height = 0;
+        int columns = 0;
+        int rows = 0;
+        std::vector<uint64_t> hashes;  // Row by row, columns per row
+
+        bool empty() const { return hashes.empty(); }
+    };
+
+    struct Change {
+        bool has_previous = false;  // False for the first capture of a target
+        int changed_tiles = 0;
+        int total_tiles = 0;
+        // Bounding box of the changed tiles, clipped to the image
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+
+        bool is_unchanged() const { return has_previous && changed_tiles == 0; }
+    };
+
+    /**
+     * Hash every tile of an image.
+     */
+    static void hash_tiles(const RawImage& image, TileHashes& tiles);
+
+    /**
+     * Compare the tile hashes of two captures; a size change changes everything.
+     */
+    static Change compare(const TileHashes& previous, const TileHashes& current);
+
+    /**
+     * Compare a capture with the previous one of the target and remember it.
+     * @param target Key of the captured window, screen or region
+     */
+    Change update(const std::string& target, const RawImage& image);
+
+    /**
+     * Drop the remembered capture of one or all targets.
+     */
+    void forget(const std::string& target);
+    void clear();
+
+    /**
+     * Name of the hashing kernel used on this CPU, for diagnostics.
+     */
+    static const char* kernel_name();
+
+    /**
+     * Fall back to the scalar hash, so both can be tested on one machine.
+     * SIMD is enabled by default.
+     */
+    static void set_simd_enabled(bool enabled);
+
+private:
+    std::unordered_map<std::string, TileHashes> previous_;
+};
+
+#endif // CHANGE_DETECTOR_H
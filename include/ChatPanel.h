@@ -16,6 +16,7 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include "../include/MqttClient.h"
 #include <nlohmann/json.hpp> // Forward declare or include if needed
 
@@ -40,7 +41,8 @@ protected:
     void on_save_conversation_clicked();
     void on_load_conversation_clicked();
     bool on_key_press_event(GdkEventKey* event);
-    void on_mqtt_message(const std::string& topic, const std::string& payload);
+    // Runs on the main loop
+    void on_mqtt_message(std::string_view topic, std::string_view payload);
     
 private:
     // Message representation
@@ -62,6 +64,7 @@ private:
     
     // MQTT Client
     std::shared_ptr<MqttClient> mqtt_client_;
+    std::vector<MqttClient::HandlerId> mqtt_handlers_;
 
     // State
     int active_conversation_id_ = -1; // ID of the currently loaded conversation
@@ -0,0 +1,109 @@
+#ifndef CHUNK_ASSEMBLER_H
+#define CHUNK_ASSEMBLER_H
+
+#include <chrono>
+#include <deque>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ChunkTransfer.h"
+
+/**
+ * Puts chunked messages back together as their chunks arrive, in any order.
+ * Transfers are buffered in memory up to a total budget; transfers that do
+ * not fit are written to a temporary file instead. Completed messages are
+ * handed over in memory, so a spooled transfer is refused on completion if
+ * reading it back would go over the budget beside the buffered ones, and a
+ * message larger than the whole budget is refused from its first chunk.
+ * Spooled transfers are limited in number and bytes too, so a peer cannot
+ * use up file descriptors or disk; past either limit new transfers that do
+ * not fit in memory are refused.
+ * A transfer that gets no chunk for the timeout is dropped along with
+ * whatever it received.
+ * Thread-safe.
+ */
+class ChunkAssembler {
+public:
+    enum class Result {
+        Incomplete,  // Chunk stored, more to come
+        Complete,    // Chunk completed its message
+        Rejected     // Malformed, too large, or of a dropped transfer
+    };
+
+    /**
+     * @param spool_dir Directory for the temporary files of large transfers
+     * @param memory_limit Bytes of transfers buffered in memory, all together
+     * @param timeout Time without a chunk after which a transfer is dropped
+     */
+    explicit ChunkAssembler(const std::string& spool_dir = "received/partial",
+                            size_t memory_limit = 64 * 1024 * 1024,
+                            std::chrono::seconds timeout = std::chrono::seconds(30));
+    ~ChunkAssembler();
+
+    ChunkAssembler(const ChunkAssembler&) = delete;
+    ChunkAssembler& operator=(const ChunkAssembler&) = delete;
+
+    /**
+     * Store a chunk.
+     * @param message Set to the reassembled message on Complete
+     */
+    Result add(std::string_view payload, std::string& message);
+
+    /**
+     * Drop transfers that timed out.
+     * @return Description of each dropped transfer, for logging
+     */
+    std::vector<std::string> expire();
+
+    /**
+     * Largest message accepted (256 MB by default); the memory budget
+     * limits it too.
+     */
+    void set_max_message_size(uint64_t bytes);
+
+    /**
+     * Most transfers spooled to disk at once (4 by default) and their
+     * combined size (256 MB by default).
+     */
+    void set_spool_limits(size_t max_transfers, uint64_t max_bytes);
+
+    size_t transfers_in_progress() const;
+    size_t memory_in_use() const;
+    size_t spooled_transfers() const;
+
+private:
+    struct Transfer {
+        uint64_t total_size = 0;
+        uint64_t chunk_size = 0;
+        std::vector<bool> received;
+        uint32_t received_count = 0;
+        std::chrono::steady_clock::time_point last_chunk;
+        std::string buffer;  // Whole message, when buffered in memory
+        std::string spool_path;  // Temporary file otherwise
+        std::fstream spool;
+    };
+
+    std::string spool_dir_;
+    size_t memory_limit_;
+    std::chrono::seconds timeout_;
+    uint64_t max_message_size_;
+    mutable std::mutex mutex_;
+    std::map<uint64_t, std::unique_ptr<Transfer>> transfers_;
+    size_t memory_in_use_;
+    size_t max_spooled_transfers_;
+    uint64_t max_spooled_bytes_;
+    size_t spooled_transfers_;
+    uint64_t spooled_bytes_;
+    std::deque<uint64_t> dropped_;  // Recently dropped transfers, whose late chunks are ignored
+
+    bool start_transfer(uint64_t id, const ChunkTransfer::Chunk& chunk, Transfer& transfer);
+    bool finish_transfer(Transfer& transfer, std::string& message);
+    void drop_transfer(std::map<uint64_t, std::unique_ptr<Transfer>>::iterator it);
+};
+
+#endif // CHUNK_ASSEMBLER_H
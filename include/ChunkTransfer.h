@@ -0,0 +1,69 @@
+#ifndef CHUNK_TRANSFER_H
+#define CHUNK_TRANSFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Framing for messages split into chunks, so a large capture is published
+ * as a series of small messages instead of one that exceeds the broker's
+ * message size limit or holds up other traffic. A chunk is:
+ *
+ *   "PWCK"   magic
+ *   1 byte   version
+ *   8 bytes  transfer id
+ *   4 bytes  chunk index
+ *   4 bytes  chunk count
+ *   8 bytes  offset of the chunk in the message
+ *   8 bytes  size of the whole message
+ *   data     the chunk's bytes
+ *
+ * Numbers are big-endian. The reassembled message is an ordinary payload
+ * (JSON or an ImageFrame).
+ *
+ * Every chunk but the last has the same size, so the chunk size is implied
+ * by the first chunk's size or any other chunk's offset / index, and the
+ * header has to agree with it exactly.
+ */
+struct ChunkTransfer {
+    static const unsigned char VERSION = 1;
+    static const size_t HEADER_SIZE = 37;
+
+    struct Chunk {
+        uint64_t transfer_id = 0;
+        uint32_t index = 0;
+        uint32_t count = 0;
+        uint64_t offset = 0;
+        uint64_t total_size = 0;
+        const unsigned char* data = nullptr;  // Points into the payload
+        size_t size = 0;
+        uint64_t chunk_size = 0;  // Size of every chunk but the last
+    };
+
+    /**
+     * Whether a message payload is a chunk.
+     */
+    static bool is_chunk(std::string_view payload);
+
+    /**
+     * Build chunk index of a message split into chunk_size pieces.
+     */
+    static std::string encode(const std::string& message, uint64_t transfer_id, uint32_t index, size_t chunk_size);
+
+    /**
+     * Number of chunks a message of this size is split into.
+     */
+    static uint32_t chunk_count(size_t message_size, size_t chunk_size);
+
+    /**
+     * Read a chunk's header; the data points into payload.
+     * @return False if the chunk is malformed or its count, offset and size
+     *         are not exactly those of its message split into chunk_size
+     *         pieces
+     */
+    static bool decode(std::string_view payload, Chunk& chunk);
+};
+
+#endif // CHUNK_TRANSFER_H
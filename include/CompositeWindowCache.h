@@ -0,0 +1,99 @@
+#ifndef COMPOSITE_WINDOW_CACHE_H
+#define COMPOSITE_WINDOW_CACHE_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <unordered_map>
+#include <cstddef>
+
+class X11Connection;
+
+/**
+ * Keeps captured windows redirected through XComposite and caches their
+ * named pixmaps, so repeated captures of a window skip the redirect, sync
+ * and naming round trips.
+ * A named pixmap is the window's live backing store: its contents follow
+ * damage by themselves, and only a resize, map or unmap replaces it. Those
+ * are picked up from StructureNotify events on the window, which the owner
+ * dispatches to handle_event() before each get(); DestroyNotify drops the
+ * entry. Windows are unredirected when they fall out of the cache
+ * or the cache is destroyed.
+ */
+class CompositeWindowCache {
+public:
+    struct WindowPixmap {
+        Pixmap pixmap = 0;
+        Visual* visual = nullptr;
+        int depth = 0;
+        int width = 0;
+        int height = 0;
+        bool exists = false;    // False if the window is gone
+        bool viewable = false;  // Unmapped windows have no pixmap
+    };
+
+    /**
+     * Constructor checks for the XComposite extension.
+     * @param connection Connection shared with the capturer
+     */
+    explicit CompositeWindowCache(X11Connection& connection);
+
+    /**
+     * Destructor frees all pixmaps and unredirects all windows.
+     */
+    ~CompositeWindowCache();
+
+    CompositeWindowCache(const CompositeWindowCache&) = delete;
+    CompositeWindowCache& operator=(const CompositeWindowCache&) = delete;
+
+    bool is_available() const { return available_; }
+
+    /**
+     * Get the pixmap with a window's contents, redirecting and naming it on
+     * first use.
+     * @return True if info.pixmap can be grabbed from; otherwise info tells
+     *         whether the window exists and is viewable
+     */
+    bool get(Window window, WindowPixmap& info);
+
+    /**
+     * Drop a window's pixmap (e.g. after a failed grab), keeping it redirected.
+     */
+    void invalidate(Window window);
+
+    /**
+     * Free a window's pixmap and stop redirecting it.
+     */
+    void release(Window window);
+
+    /**
+     * Release all windows.
+     */
+    void clear();
+
+    /**
+     * Handle an event dispatched by the shared connection.
+     */
+    void handle_event(const XEvent& event);
+
+    size_t size() const { return windows_.size(); }
+
+private:
+    struct Entry {
+        WindowPixmap info;
+        bool valid = false;
+        unsigned long last_used = 0;
+    };
+
+    X11Connection& connection_;
+    Display* display_;
+    bool available_;
+    std::unordered_map<Window, Entry> windows_;
+    unsigned long use_counter_;
+    size_t max_windows_;
+
+    void free_pixmap(Entry& entry);
+    void unredirect(Window window);
+    void trim();
+};
+
+#endif // COMPOSITE_WINDOW_CACHE_H
@@ -0,0 +1,95 @@
+#ifndef CONTINUOUS_CAPTURE_H
+#define CONTINUOUS_CAPTURE_H
+
+#include <X11/Xlib.h>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "FrameRing.h"
+#include "CaptureSettings.h"
+
+/**
+ * Captures a window or screen at a fixed rate on a dedicated thread into a
+ * FrameRing. The thread has its own X connection and capturer, so nothing
+ * runs on the GTK main loop.
+ */
+class ContinuousCapture {
+public:
+    enum class Target { Window, Screen };
+
+    // Called on the capture thread after each frame; keep it short
+    using FrameCallback = std::function<void(uint64_t sequence)>;
+
+    /**
+     * Constructor.
+     * @param ring_capacity Number of preallocated frames in the ring
+     */
+    explicit ContinuousCapture(size_t ring_capacity = 8);
+
+    /**
+     * Destructor stops the capture thread.
+     */
+    ~ContinuousCapture();
+
+    ContinuousCapture(const ContinuousCapture&) = delete;
+    ContinuousCapture& operator=(const ContinuousCapture&) = delete;
+
+    /**
+     * Start capturing.
+     * @param target Window or screen
+     * @param id Window ID or screen number (-1 for the whole desktop)
+     * @param fps Frames per second
+     * @param width, height Size of the target, to size the ring's frames
+     *        before the first capture; 0 if unknown
+     * @return False if already running
+     */
+    bool start(Target target, unsigned long id, double fps, int width = 0, int height = 0);
+
+    /**
+     * Stop capturing and join the thread. Frames stay readable in the ring.
+     */
+    void stop();
+
+    bool is_running() const { return running_.load(); }
+    bool is_capturing(Target target, unsigned long id) const;
+
+    /**
+     * Change the frame rate while running.
+     */
+    void set_fps(double fps);
+    double get_fps() const { return fps_.load(); }
+
+    void set_frame_callback(FrameCallback callback);
+
+    /**
+     * Settings for the capture thread's capturer, normally those of the
+     * main capturer. Applied before the next frame.
+     */
+    void set_capture_settings(const CaptureSettings& settings);
+
+    /**
+     * Ring the frames are written to, for consumers.
+     */
+    const FrameRing& ring() const { return *ring_; }
+
+private:
+    std::unique_ptr<FrameRing> ring_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<double> fps_;
+    Target target_;
+    unsigned long target_id_;
+
+    std::mutex mutex_;  // Guards callback_, settings_ and the stop wait
+    std::condition_variable stop_cv_;
+    FrameCallback callback_;
+    CaptureSettings settings_;
+
+    void run();
+};
+
+#endif // CONTINUOUS_CAPTURE_H
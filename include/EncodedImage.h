@@ -0,0 +1,26 @@
+#ifndef ENCODED_IMAGE_H
+#define ENCODED_IMAGE_H
+
+#include <vector>
+#include <string>
+
+/**
+ * Compressed capture held in memory, ready to be published or written to disk.
+ */
+struct EncodedImage {
+    std::vector<unsigned char> data;
+    std::string format = "png";
+    int width = 0;
+    int height = 0;
+
+    // Area that changed since the previous capture of the same target, in
+    // image pixels; a width of 0 means unknown (e.g. the first capture)
+    int changed_x = 0;
+    int changed_y = 0;
+    int changed_width = 0;
+    int changed_height = 0;
+
+    bool empty() const { return data.empty(); }
+};
+
+#endif // ENCODED_IMAGE_H
@@ -0,0 +1,105 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include "RawImage.h"
+
+/**
+ * Fixed-size ring of preallocated frames written by one producer thread and
+ * read by any number of consumers.
+ * The producer never waits: it takes the next slot with try_lock and skips
+ * slots a consumer is still copying from, overwriting the oldest frames
+ * when consumers fall behind. Consumers copy frames out, so a slow consumer
+ * only ever delays itself.
+ */
+class FrameRing {
+public:
+    struct Frame {
+        RawImage image;
+        uint64_t sequence = 0;  // 1 for the first frame, 0 means empty
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    // Fills a slot's image, returns false to discard the frame
+    using FillFunction = std::function<bool(RawImage& image)>;
+
+    /**
+     * Constructor.
+     * @param capacity Number of slots
+     * @param width, height Expected frame size, used to preallocate the slots
+     */
+    FrameRing(size_t capacity, int width = 0, int height = 0);
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * Size every slot for frames of this size, dropping the frames of
+     * slots that had another size. Call while no producer is writing.
+     */
+    void preallocate(int width, int height);
+
+    /**
+     * Write a frame (producer side, never blocks on consumers).
+     * @return Sequence number of the new frame, 0 if no slot was free or fill failed
+     */
+    uint64_t write(const FillFunction& fill);
+
+    /**
+     * Copy the newest frame if it is newer than after_sequence.
+     */
+    bool read_latest(Frame& frame, uint64_t after_sequence = 0) const;
+
+    /**
+     * Copy a specific frame if it is still in the ring.
+     */
+    bool read(uint64_t sequence, Frame& frame) const;
+
+    /**
+     * Wait until a frame newer than after_sequence is written.
+     * @return False on timeout
+     */
+    bool wait_for_frame(uint64_t after_sequence, std::chrono::milliseconds timeout) const;
+
+    /**
+     * Sequence number of the newest frame, 0 if none yet.
+     */
+    uint64_t latest_sequence() const { return latest_sequence_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Producer statistics
+    uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+    uint64_t frames_dropped() const { return frames_dropped_.load(std::memory_order_relaxed); }
+
+    /**
+     * Wake up all waiting consumers, e.g. when the producer stops.
+     */
+    void notify_all() const;
+
+private:
+    struct Slot {
+        mutable std::mutex mutex;
+        Frame frame;
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots_;
+    size_t next_slot_;  // Producer only
+    std::atomic<uint64_t> latest_sequence_;
+    std::atomic<uint64_t> frames_written_;
+    std::atomic<uint64_t> frames_dropped_;
+
+    mutable std::mutex wait_mutex_;
+    mutable std::condition_variable wait_cv_;
+
+    static void copy_frame(const Frame& from, Frame& to);
+};
+
+#endif // FRAME_RING_H
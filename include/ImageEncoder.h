@@ -0,0 +1,61 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <string>
+#include "RawImage.h"
+#include "EncodedImage.h"
+#include "PngEncoder.h"
+
+/**
+ * Encodes captures in the selected output format.
+ * PNG goes through the parallel PngEncoder, JPEG through libjpeg and WebP
+ * through libwebp when the build found it (HAVE_WEBP).
+ */
+class ImageEncoder {
+public:
+    ImageEncoder();
+
+    /**
+     * Select the output format ("png", "jpeg" or "webp").
+     * @return False if the format is unknown or not compiled in
+     */
+    bool set_format(const std::string& format);
+    const std::string& get_format() const { return format_; }
+
+    /**
+     * Quality for lossy formats, 1-100 (default 85).
+     */
+    void set_quality(int quality);
+    int get_quality() const { return quality_; }
+
+    /**
+     * PNG encoder settings.
+     */
+    PngEncoder& png() { return png_encoder_; }
+    const PngEncoder& png() const { return png_encoder_; }
+
+    /**
+     * Encode in the selected format.
+     */
+    bool encode(const RawImage& raw, EncodedImage& encoded) const;
+
+    /**
+     * Encode in a specific format, e.g. to match a file extension.
+     */
+    bool encode(const RawImage& raw, const std::string& format, EncodedImage& encoded) const;
+
+    /**
+     * Check if a format can be encoded by this build.
+     */
+    static bool is_format_available(const std::string& format);
+
+private:
+    std::string format_;
+    int quality_;
+    PngEncoder png_encoder_;
+
+    bool encode_jpeg(const RawImage& raw, EncodedImage& encoded) const;
+    bool encode_webp(const RawImage& raw, EncodedImage& encoded) const;
+};
+
+#endif // IMAGE_ENCODER_H
@@ -0,0 +1,62 @@
+#ifndef IMAGE_FORMAT_H
+#define IMAGE_FORMAT_H
+
+#include <string>
+#include <algorithm>
+#include <cctype>
+
+/**
+ * Capture image format names ("png", "jpeg", "webp") and their MIME types and
+ * file extensions. Header-only so the agent can use it without the capture code.
+ */
+struct ImageFormat {
+    /**
+     * Normalize a format name or file extension ("JPG", ".jpeg", ...).
+     * @return Canonical name, or an empty string if unknown
+     */
+    static std::string normalize(std::string format) {
+        if (!format.empty() && format[0] == '.') {
+            format.erase(0, 1);
+        }
+        std::transform(format.begin(), format.end(), format.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (format == "png") return "png";
+        if (format == "jpeg" || format == "jpg") return "jpeg";
+        if (format == "webp") return "webp";
+        return "";
+    }
+
+    /**
+     * Format of an image file, from its extension.
+     */
+    static std::string from_path(const std::string& path) {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            return "";
+        }
+        return normalize(path.substr(dot));
+    }
+
+    /**
+     * MIME type for a format, image/png if unknown.
+     */
+    static std::string mime_type(const std::string& format) {
+        std::string name = normalize(format);
+        if (name == "jpeg") return "image/jpeg";
+        if (name == "webp") return "image/webp";
+        return "image/png";
+    }
+
+    /**
+     * File extension for a format, including the dot.
+     */
+    static std::string extension(const std::string& format) {
+        std::string name = normalize(format);
+        if (name == "jpeg") return ".jpg";
+        if (name == "webp") return ".webp";
+        return ".png";
+    }
+};
+
+#endif // IMAGE_FORMAT_H
@@ -0,0 +1,59 @@
+#ifndef IMAGE_FRAME_H
+#define IMAGE_FRAME_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "EncodedImage.h"
+
+/**
+ * Binary framing for image messages, so images travel as raw bytes instead
+ * of base64 inside JSON. A frame is:
+ *
+ *   "PWIM"  magic
+ *   1 byte  version
+ *   4 bytes length of the header, big-endian
+ *   header  JSON metadata (routing, trigger, timestamp, ...) with an "images"
+ *           array giving each image's format, size and SHA-256
+ *   images  the image bytes, back to back in the order of "images"
+ *
+ * Receivers only parse the small header; the image bytes are used in place.
+ */
+struct ImageFrame {
+    static const unsigned char VERSION = 1;
+
+    // An image inside a decoded frame, pointing into the payload
+    struct Image {
+        const nlohmann::json* meta = nullptr;  // Entry of the header's "images"
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    /**
+     * Whether a message payload is a binary image frame.
+     */
+    static bool is_frame(std::string_view payload);
+
+    /**
+     * Build a frame. Each image gets an entry in header["images"] (existing
+     * entries are kept and completed) with its format, MIME type, size,
+     * dimensions and SHA-256.
+     */
+    static std::string encode(nlohmann::json header, const std::vector<const EncodedImage*>& images);
+
+    /**
+     * Split a frame into its header and images, checking sizes and hashes.
+     * The images point into payload, which must outlive them.
+     * @return False if the frame is malformed or an image is corrupt
+     */
+    static bool decode(std::string_view payload, nlohmann::json& header, std::vector<Image>& images);
+
+    /**
+     * SHA-256 of some bytes, as lowercase hex.
+     */
+    static std::string sha256(const unsigned char* data, size_t length);
+};
+
+#endif // IMAGE_FRAME_H
@@ -0,0 +1,73 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <string>
+#include "RawImage.h"
+
+/**
+ * Downscales ARGB32 captures before they are encoded.
+ * Vision models resample large images anyway, while encoding, transfer and
+ * token costs all grow with the pixel count, so captures can be reduced to a
+ * maximum long edge and/or pixel count first.
+ * Scaling is separable (a horizontal, then a vertical pass) with 14-bit
+ * fixed-point weights that are computed once per source/target size. The
+ * area filter averages the exact source area behind each output pixel; the
+ * Lanczos filter (a = 3) keeps small text sharper. Both passes have AVX2
+ * versions selected at runtime.
+ */
+class ImageScaler {
+public:
+    enum class Filter {
+        Area,
+        Lanczos
+    };
+
+    /**
+     * Size limits; 0 means unlimited.
+     */
+    struct Limits {
+        int max_long_edge = 0;
+        double max_megapixels = 0.0;
+
+        bool is_limited() const { return max_long_edge > 0 || max_megapixels > 0.0; }
+    };
+
+    /**
+     * Largest size within the limits that keeps the aspect ratio.
+     * Images are never enlarged.
+     * @return False if the image already fits
+     */
+    static bool fit_size(int width, int height, const Limits& limits,
+                         int& fitted_width, int& fitted_height);
+
+    /**
+     * Scale an image to the given size.
+     * @return False if either image size is empty
+     */
+    static bool scale(const RawImage& src, RawImage& dst, int width, int height, Filter filter);
+
+    /**
+     * Scale an image down to fit the limits.
+     * @return False if it already fits (dst is left untouched)
+     */
+    static bool scale_to_fit(const RawImage& src, RawImage& dst, const Limits& limits, Filter filter);
+
+    /**
+     * Filter names for settings ("area", "lanczos").
+     */
+    static const char* filter_name(Filter filter);
+    static bool parse_filter(const std::string& name, Filter& filter);
+
+    /**
+     * Name of the kernels used on this CPU, for diagnostics.
+     */
+    static const char* kernel_name();
+
+    /**
+     * Fall back to the scalar kernels, so both can be tested on one machine.
+     * SIMD is enabled by default.
+     */
+    static void set_simd_enabled(bool enabled);
+};
+
+#endif // IMAGE_SCALER_H
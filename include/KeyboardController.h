@@ -9,20 +9,30 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <memory>
+
+class X11Connection;
 
 /**
  * Class for handling global keyboard shortcuts in X11 environment.
- * Currently supports intercepting the Numpad Enter key to trigger captures.
+ * Currently supports intercepting the Numpad Enter key to trigger captures,
+ * Ctrl+Numpad Enter to dump the replay buffer and Ctrl+Numpad 1-9 to
+ * capture saved regions.
  */
 class KeyboardController {
 public:
     /**
-     * Constructor initializes the X11 connection.
+     * Constructor opens an X11 connection of its own.
      */
     KeyboardController();
     
     /**
-     * Destructor cleans up X11 resources and releases grabbed keys.
+     * Constructor shares an X11 connection and its event dispatching.
+     */
+    explicit KeyboardController(std::shared_ptr<X11Connection> connection);
+    
+    /**
+     * Destructor releases grabbed keys.
      */
     ~KeyboardController();
     
@@ -50,27 +60,43 @@ public:
     typedef sigc::signal<void> type_signal_capture_key_pressed;
     type_signal_capture_key_pressed signal_capture_key_pressed() { return m_signal_capture_key_pressed; }
     
+    /**
+     * Signal emitted when Ctrl+Numpad Enter is pressed.
+     * Used to save the last seconds of the replay buffer.
+     */
+    typedef sigc::signal<void> type_signal_replay_key_pressed;
+    type_signal_replay_key_pressed signal_replay_key_pressed() { return m_signal_replay_key_pressed; }
+    
+    /**
+     * Signal emitted when Ctrl+Numpad 1-9 is pressed, with the digit.
+     * Used to capture the saved region bound to it.
+     */
+    typedef sigc::signal<void, int> type_signal_region_key_pressed;
+    type_signal_region_key_pressed signal_region_key_pressed() { return m_signal_region_key_pressed; }
+    
 private:
     // X11 resources
+    std::shared_ptr<X11Connection> connection_;
     Display* display_;
     Window root_window_;
     bool monitoring_;
-    sigc::connection event_check_connection_;
+    int key_subscription_;
     
     // Key grabbing
     unsigned int numpad_enter_keycode_;
     std::vector<int> grabbed_modifiers_;
+    std::vector<unsigned int> region_keycodes_;   // Numpad 1-9
+    std::vector<int> region_modifiers_;           // Ctrl with any lock state
     
     // Signals
     type_signal_capture_key_pressed m_signal_capture_key_pressed;
+    type_signal_replay_key_pressed m_signal_replay_key_pressed;
+    type_signal_region_key_pressed m_signal_region_key_pressed;
     
     // X11 event processing
-    bool process_x11_events();
+    void handle_key_press(XEvent& event);
     void register_keyboard_shortcuts();
     void unregister_keyboard_shortcuts();
-    
-    // Error handling for X11
-    static int x11_error_handler(Display*, XErrorEvent*);
 };
 
 #endif // KEYBOARD_CONTROLLER_H
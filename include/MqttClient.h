@@ -2,13 +2,59 @@
 #define MQTT_CLIENT_H
 
 #include <mosquitto.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "EncodedImage.h"
+#include "TopicRouter.h"
+#include "WorkerPool.h"
 
 class MqttClient {
 public:
-    using MessageCallback = std::function<void(const std::string&, const std::string&)>;
+    // Payloads are views that are only valid during the call
+    using MessageHandler = TopicRouter::Handler;
+    using Delivery = TopicRouter::Delivery;
+    using HandlerId = uint64_t;
+    // Called on the network thread once the broker accepted the connection
+    using ConnectCallback = std::function<void()>;
+    
+    // Outcome of one published message
+    struct PublishResult {
+        bool delivered = false;  // Acknowledged by the broker (QoS 1, 2) or written to it (QoS 0)
+        std::string error;       // Why not, otherwise
+        size_t bytes = 0;
+        int qos = 0;
+        std::chrono::milliseconds latency{0};  // From publishing to delivery
+    };
+    // Called on the network thread when a message is delivered or failed
+    using PublishCallback = std::function<void(const PublishResult&)>;
+    
+    struct PublishStats {
+        uint64_t delivered = 0;
+        uint64_t failed = 0;
+        uint64_t rejected = 0;  // Images refused because of the in-flight limit
+        size_t in_flight = 0;
+        size_t in_flight_bytes = 0;
+        std::chrono::milliseconds last_latency{0};
+        std::chrono::milliseconds max_latency{0};
+    };
+    
+    // How images are sent: base64 inside JSON, understood by every receiver,
+    // or binary ImageFrame messages for receivers that announced support
+    enum class ImageTransport {
+        Json,
+        Binary
+    };
     
     MqttClient();
     ~MqttClient();
@@ -16,20 +62,122 @@ public:
     bool connect(const std::string& host, const std::string& username, int port = 1883);
     void disconnect();
     bool is_connected() const { return connected_; }
+    // Queue a message; false if it could not be queued
     bool publish(const std::string& topic, const std::string& message);
+    // Queue a message with QoS 0, 1 or 2. The future (and on_complete, if
+    // given) gets the result once the broker acknowledged the message, or
+    // at once if it was not queued.
+    std::future<PublishResult> publish_async(const std::string& topic, std::string message, int qos = 0,
+                                             PublishCallback on_complete = nullptr);
     bool publish_image(const std::string& topic, const std::string& filename, 
                       const std::string& window_title, const std::string& trigger_type,
                       bool as_base64 = false);
-    void set_message_callback(MessageCallback callback);
-    bool subscribe(const std::string& topic);
+    // Publish an in-memory capture; filename is only sent as metadata
+    bool publish_image(const std::string& topic, const EncodedImage& image,
+                      const std::string& filename, const std::string& routing_info,
+                      const std::string& trigger_type, PublishCallback on_complete = nullptr);
+    // Publish several frames (e.g. a replay) as one multi-image message;
+    // offsets_ms gives each frame's time relative to the first
+    bool publish_images(const std::string& topic,
+                       const std::vector<std::shared_ptr<const EncodedImage>>& images,
+                       const std::vector<long>& offsets_ms, const std::string& routing_info,
+                       const std::string& trigger_type, PublishCallback on_complete = nullptr);
+    // Image messages larger than this are split into ChunkTransfer chunks
+    // and sent one at a time, so other messages go out in between; 0 sends
+    // them in one piece (256 KB by default)
+    void set_chunk_size(size_t bytes);
+    size_t get_chunk_size() const;
+    void set_image_transport(ImageTransport transport) { image_transport_ = transport; }
+    ImageTransport get_image_transport() const { return image_transport_; }
+    // QoS of image messages (0 by default)
+    void set_image_qos(int qos) { image_qos_ = std::clamp(qos, 0, 2); }
+    int get_image_qos() const { return image_qos_; }
+    // Image messages are refused while this many bytes of images are
+    // published but not yet delivered, so a slow link does not pile up
+    // captures in memory; a single larger image is still sent when no other
+    // image is in flight. Other messages are never refused, so chat and
+    // commands keep flowing during a large transfer (64 MB by default, 0 for
+    // no limit)
+    void set_max_in_flight_bytes(size_t bytes);
+    size_t get_max_in_flight_bytes() const;
+    PublishStats publish_stats() const;
+    void set_connect_callback(ConnectCallback callback) { connect_callback_ = callback; }
+    // Register a handler for the messages matching an MQTT topic filter and
+    // subscribe to it. Any number of handlers can share a client, and
+    // filters are subscribed again on every connect, so handlers can be
+    // added before connecting. Returns 0 if the filter is malformed.
+    HandlerId add_handler(const std::string& filter, MessageHandler handler,
+                          Delivery delivery = Delivery::NetworkThread);
+    // Unregister a handler, unsubscribing its filter if no handler is left
+    // on it; deliveries already queued for it are dropped
+    void remove_handler(HandlerId id);
 
 private:
     struct mosquitto* mosq_;
-    bool connected_;
-    MessageCallback message_callback_;
+    std::atomic<bool> connected_;  // Written on the network thread, read by the sender too
+    ImageTransport image_transport_;
+    int image_qos_;
+    ConnectCallback connect_callback_;
+    TopicRouter router_;
+    std::unique_ptr<WorkerPool> handler_pool_;  // Started with the first Worker handler
+    std::mutex handler_pool_mutex_;
+    
+    // A published message waiting for its delivery
+    struct PendingPublish {
+        std::promise<PublishResult> promise;
+        PublishCallback on_complete;
+        size_t bytes = 0;
+        int qos = 0;
+        std::chrono::steady_clock::time_point started;
+        bool image = false;  // Counted against the in-flight limit
+        bool completed = false;
+    };
+    // Messages written to mosquitto by message id; chunks other than the
+    // last of a transfer have no PendingPublish
+    std::map<int, std::shared_ptr<PendingPublish>> in_flight_;
+    std::deque<int> early_mids_;  // Delivered before mosquitto_publish() returned
+    size_t max_in_flight_bytes_;
+    size_t image_bytes_in_flight_;
+    PublishStats publish_stats_;
+    mutable std::mutex in_flight_mutex_;
+    
+    // Chunked messages waiting to be sent, oldest first
+    struct OutgoingTransfer {
+        std::string topic;
+        std::string message;
+        uint64_t id;
+        uint32_t next_chunk;
+        uint32_t chunk_count;
+        size_t chunk_size;
+        int qos;
+        std::shared_ptr<PendingPublish> pending;  // Completed with the last chunk
+    };
+    size_t chunk_size_;
+    uint64_t next_transfer_id_;
+    std::deque<OutgoingTransfer> outgoing_;
+    int last_written_mid_;  // Message id of the last message written to the broker
+    bool chunk_sender_stopping_;
+    mutable std::mutex chunk_mutex_;
+    std::condition_variable chunk_cv_;
+    std::thread chunk_sender_;
+    
+    // Publish a message; images are sent in chunks if larger than the chunk
+    // size and count against the in-flight limit. pending gets the result
+    bool publish_payload(const std::string& topic, std::string message, int qos,
+                         std::shared_ptr<PendingPublish> pending, bool image);
+    void track_publish(int mid, std::shared_ptr<PendingPublish> pending);
+    void complete_publish(const std::shared_ptr<PendingPublish>& pending, const std::string& error);
+    // Fail the messages in flight with QoS up to max_qos; mosquitto sends
+    // the others again after reconnecting
+    void fail_in_flight(const std::string& error, int max_qos = 2);
+    void dispatch(std::string_view topic, std::string_view payload);
+    void run_chunk_sender();
+    
+    static std::string encode_base64(const unsigned char* data, size_t length);
     
     static void on_connect_callback(struct mosquitto* mosq, void* obj, int rc);
     static void on_disconnect_callback(struct mosquitto* mosq, void* obj, int rc);
+    static void on_publish_callback(struct mosquitto* mosq, void* obj, int mid);
     static void on_message_callback(struct mosquitto* mosq, void* obj, const struct mosquitto_message* message);
 };
 
@@ -0,0 +1,56 @@
+#ifndef MQTT_TOPICS_H
+#define MQTT_TOPICS_H
+
+#include <string>
+
+/**
+ * MQTT topic scheme: sauron/<from>/<to>/<type>, e.g. sauron/ui/agent/image.
+ * Receivers subscribe to the recipients and types they handle, so the broker
+ * filters messages instead of every client parsing every payload. Messages
+ * for no particular recipient go to "all". Header-only so the agent can use
+ * it without the UI code.
+ */
+struct MqttTopics {
+    static constexpr const char* ROOT = "sauron";
+    static constexpr const char* BROADCAST = "all";
+
+    /**
+     * Topic of a message.
+     */
+    static std::string make(const std::string& from, const std::string& to, const std::string& type) {
+        return std::string(ROOT) + "/" + from + "/" + to + "/" + type;
+    }
+
+    /**
+     * Subscription for messages to a recipient from anyone, of one type or
+     * of every type ("#").
+     */
+    static std::string subscription(const std::string& to, const std::string& type = "#") {
+        return std::string(ROOT) + "/+/" + to + "/" + type;
+    }
+
+    /**
+     * Split a topic into its parts.
+     * @return False if the topic is not in the scheme
+     */
+    static bool parse(const std::string& topic, std::string& from, std::string& to, std::string& type) {
+        std::string prefix = std::string(ROOT) + "/";
+        if (topic.compare(0, prefix.size(), prefix) != 0) {
+            return false;
+        }
+        size_t from_end = topic.find('/', prefix.size());
+        if (from_end == std::string::npos) {
+            return false;
+        }
+        size_t to_end = topic.find('/', from_end + 1);
+        if (to_end == std::string::npos || topic.find('/', to_end + 1) != std::string::npos) {
+            return false;
+        }
+        from = topic.substr(prefix.size(), from_end - prefix.size());
+        to = topic.substr(from_end + 1, to_end - from_end - 1);
+        type = topic.substr(to_end + 1);
+        return !from.empty() && !to.empty() && !type.empty();
+    }
+};
+
+#endif // MQTT_TOPICS_H
@@ -0,0 +1,94 @@
+#ifndef PIXEL_CONVERTER_H
+#define PIXEL_CONVERTER_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <cstdint>
+
+/**
+ * Converts XImage pixel data to Cairo's ARGB32 layout (native-endian
+ * 0xAARRGGBB words, always opaque).
+ * A row kernel is picked once per image from its red/green/blue masks, depth,
+ * bits per pixel and byte order. Common TrueColor layouts (32-bit xRGB/xBGR,
+ * 30-bit, 16-bit 565) have SSE2 and AVX2 versions selected at runtime; any
+ * other format goes through a scalar mask-based path that produces the same
+ * result as decoding XGetPixel values.
+ */
+class PixelConverter {
+public:
+    // Instruction sets the row kernels can use
+    enum class Simd { Scalar, SSE2, AVX2 };
+
+    /**
+     * Constructor inspects the image format and selects a kernel.
+     */
+    explicit PixelConverter(const XImage* image);
+
+    /**
+     * Check if the image format is supported.
+     */
+    bool is_valid() const { return valid_; }
+
+    /**
+     * Name of the selected kernel, for diagnostics.
+     */
+    const char* kernel_name() const { return kernel_name_; }
+
+    /**
+     * Convert a range of rows into an ARGB32 buffer.
+     * @param image Image with the same format the converter was created for
+     * @param first_row First source row to convert
+     * @param row_count Number of rows to convert
+     * @param dst Destination for first_row (4-byte aligned rows)
+     * @param dst_stride Bytes per destination row
+     */
+    void convert_rows(const XImage* image, int first_row, int row_count,
+                      unsigned char* dst, int dst_stride) const;
+
+    /**
+     * Convert a whole image into an ARGB32 buffer.
+     */
+    void convert(const XImage* image, unsigned char* dst, int dst_stride) const;
+
+    /**
+     * Convenience wrapper: select a kernel and convert in one call.
+     * @return False if the image format is not supported
+     */
+    static bool convert_image(const XImage* image, unsigned char* dst, int dst_stride);
+
+    /**
+     * Best instruction set the CPU supports.
+     */
+    static Simd detected_simd();
+
+    /**
+     * Limit the instruction set of converters created from now on, so each
+     * kernel can be tested on one machine. No limit by default.
+     */
+    static void set_max_simd(Simd simd);
+
+private:
+    using RowKernel = void (*)(const unsigned char* src, uint32_t* dst, int width);
+
+    struct Channel {
+        unsigned long mask = 0;
+        int shift = 0;
+        int bits = 0;
+    };
+
+    bool valid_;
+    RowKernel kernel_;
+    const char* kernel_name_;
+    int bits_per_pixel_;
+    bool swap_bytes_;
+    Channel red_, green_, blue_;
+
+    void select_kernel(const XImage* image);
+    void convert_row_generic(const XImage* image, int row, uint32_t* dst) const;
+    uint32_t pixel_to_argb(unsigned long pixel) const;
+
+    static Channel make_channel(unsigned long mask);
+    static uint32_t expand_channel(unsigned long pixel, const Channel& channel);
+};
+
+#endif // PIXEL_CONVERTER_H
@@ -0,0 +1,82 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "RawImage.h"
+#include "EncodedImage.h"
+
+class WorkerPool;
+
+/**
+ * Multi-threaded PNG encoder for ARGB32 captures.
+ * The image is split into row bands that are filtered and deflated in
+ * parallel as independent raw deflate streams, each ending on a byte boundary
+ * (sync flush), so they can be concatenated into one zlib stream. Adler-32 and
+ * CRC-32 values are combined per band, so the output is a standard 8-bit RGB
+ * PNG with a single IDAT chunk.
+ */
+class PngEncoder {
+public:
+    // Speed/size trade-off
+    enum class Preset {
+        Fastest,   // zlib level 1 with run-length matching, cheapest filter choice
+        Balanced,  // zlib level 4, heuristic filter choice
+        Smallest   // zlib level 9, heuristic filter choice including Paeth
+    };
+
+    /**
+     * Constructor.
+     * @param preset Compression preset
+     * @param pool Worker pool for the bands, nullptr for a shared pool
+     *             sized to the hardware
+     */
+    explicit PngEncoder(Preset preset = Preset::Balanced, WorkerPool* pool = nullptr);
+
+    /**
+     * Select a preset; resets the compression level to the preset default.
+     */
+    void set_preset(Preset preset);
+    Preset get_preset() const { return preset_; }
+
+    /**
+     * Override the zlib compression level (0-9) of the current preset.
+     */
+    void set_compression_level(int level);
+    int get_compression_level() const { return level_; }
+
+    /**
+     * Encode an image.
+     * @return False if the image is empty or deflate failed
+     */
+    bool encode(const RawImage& raw, EncodedImage& encoded) const;
+
+    /**
+     * Preset names as used in settings.ini ("fastest", "balanced", "smallest").
+     */
+    static const char* preset_name(Preset preset);
+    static bool preset_from_string(const std::string& name, Preset& preset);
+
+private:
+    struct Band {
+        int first_row = 0;
+        int row_count = 0;
+        std::vector<unsigned char> data;  // Raw deflate output
+        uint32_t adler = 1;               // Adler-32 of the filtered rows
+        uint32_t crc = 0;                 // CRC-32 of data
+        size_t filtered_size = 0;
+        bool ok = false;
+    };
+
+    Preset preset_;
+    int level_;
+    WorkerPool* pool_;
+
+    void encode_band(const RawImage& raw, Band& band, bool last) const;
+    int band_count(const RawImage& raw) const;
+
+    static WorkerPool& shared_pool();
+};
+
+#endif // PNG_ENCODER_H
@@ -0,0 +1,31 @@
+#ifndef RAW_IMAGE_H
+#define RAW_IMAGE_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Uncompressed capture in Cairo's ARGB32 layout
+ * (native-endian 0xAARRGGBB words, always opaque).
+ */
+struct RawImage {
+    int width = 0;
+    int height = 0;
+    int stride = 0; // Bytes per row
+    std::vector<unsigned char> pixels;
+
+    bool empty() const { return pixels.empty(); }
+
+    // Resize the buffer, keeping the allocation when the size is unchanged
+    void resize(int new_width, int new_height) {
+        width = new_width;
+        height = new_height;
+        stride = new_width * 4;
+        pixels.resize(static_cast<size_t>(stride) * new_height);
+    }
+
+    unsigned char* row(int y) { return pixels.data() + static_cast<size_t>(y) * stride; }
+    const unsigned char* row(int y) const { return pixels.data() + static_cast<size_t>(y) * stride; }
+};
+
+#endif // RAW_IMAGE_H
@@ -0,0 +1,52 @@
+#ifndef REGION_SELECTOR_H
+#define REGION_SELECTOR_H
+
+#include <gtkmm.h>
+#include "X11ScreenCapturer.h"
+
+/**
+ * Overlay covering the desktop for picking a capture region with a
+ * rubber band. It shows a still of the desktop, dimmed outside the
+ * rectangle being dragged, and grabs the pointer and keyboard while open.
+ * Releasing the button emits signal_region_selected with the rectangle in
+ * desktop coordinates; Escape, the right button, a click or closing the
+ * overlay emits signal_cancelled. The overlay hides itself either way.
+ */
+class RegionSelector : public Gtk::Window {
+public:
+    // Takes over the desktop still shown behind the selection
+    explicit RegionSelector(RawImage desktop);
+    virtual ~RegionSelector();
+
+    typedef sigc::signal<void, X11ScreenCapturer::CaptureRect> type_signal_region_selected;
+    type_signal_region_selected signal_region_selected() { return m_signal_region_selected; }
+
+    typedef sigc::signal<void> type_signal_cancelled;
+    type_signal_cancelled signal_cancelled() { return m_signal_cancelled; }
+
+protected:
+    bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override;
+    bool on_map_event(GdkEventAny* event) override;
+    bool on_button_press_event(GdkEventButton* event) override;
+    bool on_button_release_event(GdkEventButton* event) override;
+    bool on_motion_notify_event(GdkEventMotion* event) override;
+    bool on_key_press_event(GdkEventKey* event) override;
+    bool on_delete_event(GdkEventAny* event) override;
+
+private:
+    RawImage desktop_;
+    Cairo::RefPtr<Cairo::ImageSurface> desktop_surface_;
+    bool dragging_;
+    double start_x_, start_y_;
+    double end_x_, end_y_;
+    type_signal_region_selected m_signal_region_selected;
+    type_signal_cancelled m_signal_cancelled;
+    sigc::connection selected_timeout_;  // Pending emission of the selection
+
+    // Rectangle between the drag start and the pointer
+    X11ScreenCapturer::CaptureRect selection() const;
+    void close_overlay();
+    void cancel();
+};
+
+#endif // REGION_SELECTOR_H
@@ -0,0 +1,108 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "FrameRing.h"
+#include "ImageScaler.h"
+#include "EncodedImage.h"
+
+/**
+ * Rolling buffer of the last few seconds of compressed frames, so a capture
+ * can still be taken after the interesting moment has passed.
+ * An encoder thread follows a FrameRing (normally fed by ContinuousCapture),
+ * compresses new frames as JPEG and keeps them until they are older than the
+ * configured duration or the byte budget is exceeded. Frames identical to the
+ * previous one share its encoded image and cost no extra memory.
+ */
+class ReplayBuffer {
+public:
+    struct Entry {
+        std::shared_ptr<const EncodedImage> image;
+        uint64_t sequence = 0;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    /**
+     * Constructor.
+     * @param byte_budget Maximum bytes of encoded frames kept in memory
+     * @param seconds How far back frames are kept
+     */
+    explicit ReplayBuffer(size_t byte_budget = 64 * 1024 * 1024, double seconds = 10.0);
+
+    /**
+     * Destructor stops the encoder thread.
+     */
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    /**
+     * Start following a frame ring. The ring must outlive the buffer or stop().
+     * @return False if already running
+     */
+    bool start(const FrameRing& ring);
+
+    /**
+     * Stop the encoder thread. Buffered frames are kept until clear().
+     */
+    void stop();
+
+    bool is_running() const { return running_.load(); }
+
+    // Limits, applied on the next frame
+    void set_duration(double seconds);
+    double get_duration() const { return duration_.load(); }
+    void set_byte_budget(size_t bytes);
+    size_t get_byte_budget() const { return byte_budget_.load(); }
+
+    // JPEG quality for buffered frames (default 70)
+    void set_quality(int quality);
+    int get_quality() const { return quality_.load(); }
+
+    // Frames are scaled down to fit these limits before encoding (unlimited by default)
+    void set_scale_limits(const ImageScaler::Limits& limits, ImageScaler::Filter filter);
+
+    /**
+     * Copy the frames of the last seconds, oldest first.
+     * @param seconds How far back to go, 0 for everything buffered
+     */
+    std::vector<Entry> snapshot(double seconds = 0) const;
+
+    /**
+     * Drop all buffered frames.
+     */
+    void clear();
+
+    // Current memory use
+    size_t size_bytes() const;
+    size_t frame_count() const;
+
+private:
+    const FrameRing* ring_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> byte_budget_;
+    std::atomic<double> duration_;
+    std::atomic<int> quality_;
+    std::atomic<int> max_long_edge_;
+    std::atomic<double> max_megapixels_;
+    std::atomic<ImageScaler::Filter> scale_filter_;
+
+    mutable std::mutex mutex_;  // Guards frames_ and bytes_
+    std::deque<Entry> frames_;
+    size_t bytes_;
+
+    void run();
+    void push(Entry entry, bool shared);
+    void trim(std::chrono::steady_clock::time_point now);
+};
+
+#endif // REPLAY_BUFFER_H
@@ -8,6 +8,8 @@
 #include <gtkmm.h>
 #include <nlohmann/json.hpp>
 #include "MqttClient.h"
+#include "ImageFrame.h"
+#include "ChunkAssembler.h"
 
 // Forward declarations
 class AIBackend;
@@ -97,18 +99,23 @@ private:
     
     // Core components
     std::shared_ptr<MqttClient> mqtt_client_;
+    MqttClient::HandlerId mqtt_handler_{0};
     std::shared_ptr<AIBackend> ai_backend_;
     sqlite3* db_;
     
     // State variables
     bool mqtt_connected_{false};
     int active_conversation_id_{-1};
+    std::string pending_image_path_;  // Latest received capture, sent with the next user message
+    uint64_t received_image_messages_{0};  // Numbers received files, so none overwrite each other
+    ChunkAssembler chunk_assembler_;  // Large messages arriving in chunks
     
     // Handler methods
     void on_backend_type_changed();
     void on_mqtt_connect_clicked();
-    void on_mqtt_message(const std::string& topic, const std::string& payload);
+    void on_mqtt_message(std::string_view topic, std::string_view payload);
     void on_save_settings_clicked();
+    bool expire_chunk_transfers();
     
     // Database operations
     bool save_conversation(Conversation& conversation);
@@ -127,6 +134,10 @@ private:
     
     // Message handling
     void handle_ui_message(const nlohmann::json& msg_json);
+    // Store received captures, binary frames or decoded JSON
+    void handle_images(const nlohmann::json& header, const std::vector<ImageFrame::Image>& images);
+    // Announce the image transports this agent accepts
+    void send_hello_to_ui();
     void send_message_to_ai(const std::string& message, const std::string& image_path);
     void send_response_to_ui(const std::string& message);
 };
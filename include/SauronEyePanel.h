@@ -7,9 +7,16 @@
 #include <optional>
 #include <chrono>
 #include <filesystem>
+#include <map>
 #include "../include/X11ScreenCapturer.h"
 #include "../include/MqttClient.h"
+#include "../include/CaptureWriter.h"
+#include "../include/ContinuousCapture.h"
+#include "../include/ReplayBuffer.h"
 #include "../include/WindowColumns.h"
+#include "../include/RegionSelector.h"
+#include "../include/ChangeDetector.h"
+#include "../include/CaptureScheduler.h"
 
 class SauronEyePanel : public Gtk::Box {
 public:
@@ -17,7 +24,8 @@ public:
                   std::shared_ptr<MqttClient> mqtt_client);
     virtual ~SauronEyePanel();
     
-    // Signal accessors
+    // Signal accessors; the path of a capture is empty when it was not
+    // saved to disk
     typedef sigc::signal<void, std::string> type_signal_capture_taken;
     type_signal_capture_taken signal_capture_taken() { return m_signal_capture_taken; }
     
@@ -25,31 +33,115 @@ public:
     typedef sigc::signal<void, std::string, std::string, std::string> type_signal_capture_taken_extended;
     type_signal_capture_taken_extended signal_capture_taken_extended() { return m_signal_capture_taken_extended; }
     
-    // Signal for when captures are saved
+    // Signal for when captures are saved to disk (filepath, type), emitted on the main loop
     typedef sigc::signal<void, std::string, std::string> type_signal_capture_saved;
     type_signal_capture_saved signal_capture_saved() { return m_signal_capture_saved; }
     
+    // Signal for skipped captures identical to the previous one of their
+    // target (previous filepath, type)
+    typedef sigc::signal<void, std::string, std::string> type_signal_capture_unchanged;
+    type_signal_capture_unchanged signal_capture_unchanged() { return m_signal_capture_unchanged; }
+    
     // Trigger a capture programmatically (e.g., from MQTT command)
     void trigger_capture();
     void trigger_capture(const std::string& trigger_type);
     
+    // Encoded image of the most recent capture, published without reading the file back
+    std::shared_ptr<const EncodedImage> last_capture() const { return last_capture_; }
+    
+    // Writing captures to the captures directory (asynchronous, on by default)
+    void set_save_to_disk(bool save);
+    bool get_save_to_disk() const;
+    
+    // Skipping captures whose tiles all match the previous capture of the
+    // same target (on by default); otherwise the previous capture is reused
+    void set_skip_unchanged(bool skip);
+    bool get_skip_unchanged() const;
+    
+    // Output format ("png", "jpeg", "webp") and quality for lossy formats
+    void set_output_format(const std::string& format, int quality);
+    std::string get_output_format() const;
+    int get_quality() const;
+    
+    // Continuous capture of the selected window or screen into a frame ring
+    void set_continuous_fps(double fps);
+    double get_continuous_fps() const;
+    ContinuousCapture& continuous_capture() { return continuous_capture_; }
+    
+    // Replay buffer of recent continuous capture frames (on by default)
+    void set_replay_enabled(bool enabled);
+    bool get_replay_enabled() const { return replay_enabled_; }
+    ReplayBuffer& replay_buffer() { return replay_buffer_; }
+    
+    // Distinct frames of the replay buffer, oldest first; also written to a
+    // replay_<time> folder under captures when saving to disk
+    std::vector<ReplayBuffer::Entry> dump_replay();
+    
+    // Size limits applied before encoding, per trigger ("window", "screen",
+    // "monitors", "replay", "manual", "keyboard", "window-double-click", ...).
+    // A trigger without limits falls back to its capture type, then "default".
+    void set_scale_limits(const std::string& trigger, const ImageScaler::Limits& limits);
+    ImageScaler::Limits get_scale_limits(const std::string& trigger) const;
+    void set_scale_filter(ImageScaler::Filter filter);
+    
+    // Saved capture regions, in desktop coordinates or relative to the first
+    // window whose title contains window_title
+    struct NamedRegion {
+        std::string name;
+        X11ScreenCapturer::CaptureRect region;
+        std::string window_title;
+        int hotkey = 0;  // Ctrl+Numpad <hotkey>, 0 for none
+    };
+    void set_regions(const std::vector<NamedRegion>& regions);
+    const std::vector<NamedRegion>& get_regions() const { return regions_; }
+    
+    // Queue a capture of a saved region by name or by its hotkey
+    bool capture_region(const std::string& name, const std::string& trigger);
+    bool capture_region_hotkey(int hotkey);
+    
+    // Most captures waiting in the queue, and what to drop when it is full
+    void set_capture_queue(size_t depth, CaptureScheduler::DropPolicy policy);
+    size_t get_capture_queue_depth() const { return capture_scheduler_.get_max_pending(); }
+    CaptureScheduler::DropPolicy get_capture_queue_policy() const { return capture_scheduler_.get_drop_policy(); }
+    
+    // Damage-tracked desktop mirror, for the main capturer and the capture
+    // threads alike
+    void set_use_mirror(bool use_mirror);
+    
+    // Signal for regions being saved or removed, so they can be persisted
+    typedef sigc::signal<void> type_signal_regions_changed;
+    type_signal_regions_changed signal_regions_changed() { return m_signal_regions_changed; }
+    
 protected:
     // Signal handlers
     void on_refresh_windows_clicked();
     void on_capture_window_clicked();
     void on_refresh_screens_clicked();
     void on_capture_screen_clicked();
+    void on_capture_monitors_clicked();
     void on_tree_view_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* column);
     void on_screens_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* column);
     bool on_window_button_press_event(GdkEventButton* button_event);
     void show_context_menu(GdkEventButton* event);
     void on_copy_window_id();
+    void on_format_changed();
+    void on_quality_changed();
+    void on_continuous_toggled();
+    void on_continuous_fps_changed();
+    void on_select_region_clicked();
+    void on_region_selected(X11ScreenCapturer::CaptureRect region);
+    void close_region_selector();
+    void on_capture_region_clicked();
+    void on_remove_region_clicked();
 
 private:
     // Helper methods
     void refresh_window_list();
     void refresh_screen_list();
-    std::string take_capture(const std::string& type, unsigned long id);
+    // Queue a capture of the selected window or screen; publish sends it to
+    // MQTT once finished
+    void take_capture(const std::string& type, unsigned long id, const std::string& trigger = "",
+                      bool publish = false);
     std::optional<X11ScreenCapturer::WindowInfo> get_selected_window();
     std::optional<X11ScreenCapturer::ScreenInfo> get_selected_screen();
     Glib::RefPtr<Gdk::Pixbuf> get_selected_screen_pixbuf();
@@ -58,6 +150,29 @@ private:
     void save_capture(Glib::RefPtr<Gdk::Pixbuf> capture, const std::string& filename, const std::string& type, unsigned long id);
     void perform_capture();
     void execute_capture(const std::string& type, unsigned long id);
+    void take_region_capture(const NamedRegion& region, const std::string& trigger);
+    // Keep a capture as the last one, write it and emit the capture signals
+    std::string finish_capture(const std::string& type, unsigned long id,
+                               const std::shared_ptr<EncodedImage>& encoded);
+    // Capture on the scheduler's thread after the capture delay, finish on
+    // the main loop; requests for a target already waiting are coalesced
+    void queue_capture(const std::string& type, unsigned long id, const std::string& target,
+                       const std::string& trigger, CaptureScheduler::CaptureJob job, bool publish = false);
+    // Hand a job to the scheduler after the capture delay and report how
+    // it was queued
+    // @return Job id, 0 if the queue was full
+    uint64_t schedule_capture(const std::string& target, const std::string& label,
+                              CaptureScheduler::CaptureJob job, CaptureScheduler::CompletionCallback done,
+                              bool* coalesced = nullptr);
+    void update_queue_status();
+    // Finish a capture compared and encoded on the capture thread; encoded
+    // is null when nothing changed and the previous capture stands in
+    std::string finish_raw_capture(const std::string& type, unsigned long id,
+                                   const std::string& target, const RawImage& raw,
+                                   const ChangeDetector::Change& change,
+                                   std::shared_ptr<EncodedImage> encoded,
+                                   const ImageScaler::Limits& limits);
+    void refresh_region_list();
     
     // Automatic refresh for window and screen lists
     sigc::connection auto_refresh_connection_;
@@ -65,6 +180,10 @@ private:
 
     // Helper for periodic refresh
     bool auto_refresh();
+    
+    // Periodic update of the continuous capture statistics
+    sigc::connection continuous_status_connection_;
+    bool update_continuous_status();
 
     // UI components
     Gtk::Frame capture_frame_;
@@ -89,6 +208,19 @@ private:
     Glib::RefPtr<Gtk::ListStore> screens_list_store_;
     Gtk::Button refresh_screens_button_;
     Gtk::Button capture_screen_button_;
+    Gtk::Button capture_monitors_button_;  // Every monitor as a separate image
+    // Reused pixel buffers, only touched on the capture thread
+    std::vector<X11ScreenCapturer::MonitorImage> monitor_images_;
+    
+    // Regions section
+    Gtk::Frame regions_frame_;
+    Gtk::Box regions_box_;
+    Gtk::ComboBoxText regions_combo_;  // Saved regions by name
+    Gtk::Entry region_name_entry_;  // Name to save the next selection under
+    Gtk::Button select_region_button_;
+    Gtk::Button capture_region_button_;
+    Gtk::Button remove_region_button_;
+    std::unique_ptr<RegionSelector> region_selector_;  // Open rubber band overlay
     
     // Capture options
     Gtk::Frame options_frame_;
@@ -96,6 +228,19 @@ private:
     Gtk::Box delay_box_;  // Capture delay container
     Gtk::Label delay_label_;  // Capture delay label
     Gtk::SpinButton delay_spin_;  // Capture delay spin button
+    Gtk::Label queue_status_label_;  // Capture queue counters
+    Gtk::CheckButton save_to_disk_check_;  // Write captures to the captures directory
+    Gtk::CheckButton skip_unchanged_check_;  // Drop captures identical to the previous one
+    Gtk::Box format_box_;  // Output format container
+    Gtk::Label format_label_;
+    Gtk::ComboBoxText format_combo_;  // PNG / JPEG / WebP
+    Gtk::Label quality_label_;
+    Gtk::SpinButton quality_spin_;  // Quality for lossy formats
+    Gtk::Box continuous_box_;  // Continuous capture container
+    Gtk::CheckButton continuous_check_;
+    Gtk::Label continuous_fps_label_;
+    Gtk::SpinButton continuous_fps_spin_;
+    Gtk::Label continuous_status_label_;  // Frames written / dropped
     
     // References to shared resources
     std::shared_ptr<X11ScreenCapturer> screen_capturer_;
@@ -105,6 +250,54 @@ private:
     type_signal_capture_taken m_signal_capture_taken;
     type_signal_capture_taken_extended m_signal_capture_taken_extended;
     type_signal_capture_saved m_signal_capture_saved;
+    type_signal_regions_changed m_signal_regions_changed;
+    type_signal_capture_unchanged m_signal_capture_unchanged;
+    
+    // Most recent capture and the background writer for the captures directory
+    std::shared_ptr<EncodedImage> last_capture_;
+    CaptureWriter capture_writer_;
+    
+    // Tile hashes and the last capture of every target ("window:<id>",
+    // "screen:<number>", "region:<name>") for skipping unchanged captures;
+    // the hashes are only used on the capture thread
+    struct PreviousCapture {
+        std::shared_ptr<EncodedImage> image;
+        std::string filepath;
+        bool saved = false;  // Whether filepath was written
+    };
+    ChangeDetector change_detector_;
+    std::map<std::string, PreviousCapture> previous_captures_;
+    
+    // Result of a queued capture, shared by every request coalesced into its
+    // job; the first completion on the main loop saves it
+    struct ProcessedCapture {
+        ImageScaler::Limits limits;  // Size limits it was encoded with
+        ChangeDetector::Change change;
+        std::shared_ptr<EncodedImage> encoded;
+        std::string filepath;
+        bool finished = false;
+    };
+    struct PendingCapture {
+        std::shared_ptr<ProcessedCapture> processed;
+        int requests = 0;  // Completions still to run
+    };
+    // By job id, main loop only
+    std::map<uint64_t, PendingCapture> pending_captures_;
+    
+    // Capture thread feeding the frame ring, and the replay buffer following it
+    ContinuousCapture continuous_capture_;
+    ReplayBuffer replay_buffer_;
+    bool replay_enabled_ = true;
+    
+    // Queue every capture goes through; declared after the continuous
+    // capture its jobs read from, so its thread stops first
+    CaptureScheduler capture_scheduler_;
+    
+    // Scale limits by trigger
+    std::map<std::string, ImageScaler::Limits> scale_limits_;
+    
+    // Saved regions, in the order they were added
+    std::vector<NamedRegion> regions_;
 };
 
 #endif // SAURON_EYE_PANEL_H
\ No newline at end of file
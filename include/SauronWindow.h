@@ -3,6 +3,12 @@
 
 #include <gtkmm.h>
 #include <gtkmm/image.h>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include "X11Connection.h"
 #include "X11ScreenCapturer.h"
 #include "MqttClient.h"
 #include "SauronEyePanel.h"
@@ -21,6 +27,8 @@ protected:
     
     // Keyboard shortcut handler
     void on_keyboard_capture_triggered();
+    void on_keyboard_replay_triggered();
+    void on_keyboard_region_triggered(int hotkey);
 
 private:
     // Debug stream buffer for redirecting cout
@@ -31,21 +39,32 @@ private:
         int_type overflow(int_type c) override;
     private:
         SauronWindow* window_;
-        std::string buffer_;
+        // Capture, encoder and MQTT threads log too: lines are buffered per
+        // thread and handed to the main loop
+        std::mutex mutex_;
+        std::map<std::thread::id, std::string> buffers_;
+        std::thread::id main_thread_;
     };
 
     // Core components
+    std::shared_ptr<X11Connection> x11_connection_;  // Shared by the capturer and keyboard controller
     std::shared_ptr<X11ScreenCapturer> capturer_;
     std::shared_ptr<MqttClient> mqtt_client_;
     SauronEyePanel sauron_eye_panel_;
     ChatPanel chat_panel_;
     KeyboardController keyboard_controller_;
     bool mqtt_connected_ = false;
+    std::vector<MqttClient::HandlerId> mqtt_handlers_;
     std::string last_capture_path_;
+    size_t replay_request_frames_ = 8;  // Frames sent to the agent from a replay
 
     // Settings persistence
     void load_settings();
     void save_settings();
+    // Saved regions live in "Region <name>" groups
+    void load_regions(const Glib::KeyFile& keyfile);
+    void store_regions(Glib::KeyFile& keyfile);
+    void save_regions();
     std::string orig_mqtt_host_;
     std::string orig_mqtt_port_;
     std::string orig_mqtt_topic_;
@@ -100,9 +119,12 @@ private:
     
     // GUI event handlers
     void on_capture_taken(const std::string& filename);
+    void on_capture_saved(const std::string& filepath, const std::string& type);
+    void on_capture_unchanged(const std::string& previous_filepath, const std::string& type);
     void on_mqtt_connect_clicked();
     void on_save_settings_clicked();
-    void on_mqtt_message(const std::string& topic, const std::string& payload);
+    // Runs on the main loop
+    void on_mqtt_message(std::string_view topic, std::string_view payload);
     void on_panel_capture(const std::string& filepath, const std::string& type, const std::string& id);
     void on_thumbnail_clicked(const std::string& filepath);
     void on_thumbnail_activated_capture(const std::string& filepath);
@@ -115,7 +137,11 @@ private:
     
     // Utility methods
     bool ensure_captures_directory();
-    void handle_capture_command();
+    void handle_capture_command(const std::string& region = "");
+    // Tell the agent which image transports we can send
+    void send_hello_to_agent();
+    // Pick the image transport the agent announced
+    void handle_agent_hello(const nlohmann::json& hello);
     void refresh_captures();
     void add_thumbnail(const std::string& filepath);
 
@@ -0,0 +1,100 @@
+#ifndef SCREEN_MIRROR_H
+#define SCREEN_MIRROR_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xdamage.h>
+#include <functional>
+#include <vector>
+
+class ShmSegmentPool;
+
+/**
+ * Incrementally updated copy of the root window.
+ * The whole desktop is grabbed once; after that XDamage reports which areas
+ * changed and only the row bands covering them are fetched again (through
+ * MIT-SHM when available). Screen captures are then served by copying out of
+ * the mirror instead of grabbing from the server.
+ */
+class ScreenMirror {
+public:
+    /**
+     * Constructor checks for the XDamage and XFixes extensions.
+     * @param display Connection shared with the capturer
+     * @param shm_pool Pool used for band grabs, may be nullptr
+     */
+    ScreenMirror(Display* display, ShmSegmentPool* shm_pool);
+
+    /**
+     * Destructor stops damage tracking and frees the mirror image.
+     */
+    ~ScreenMirror();
+
+    ScreenMirror(const ScreenMirror&) = delete;
+    ScreenMirror& operator=(const ScreenMirror&) = delete;
+
+    /**
+     * Check if the server supports the required extensions.
+     */
+    bool is_available() const { return available_; }
+
+    /**
+     * Start damage tracking and take the initial full grab.
+     */
+    bool start();
+
+    /**
+     * Stop damage tracking and drop the mirror.
+     */
+    void stop();
+
+    bool is_running() const { return damage_ != 0; }
+
+    /**
+     * Handle an event from the shared connection.
+     * @return True if it was a damage event for the mirror
+     */
+    bool handle_event(const XEvent& event);
+
+    /**
+     * Type of the damage events passed to handle_event().
+     */
+    int event_type() const;
+
+    /**
+     * Bring the mirror up to date: re-fetches damaged bands, or everything if
+     * the root window changed size.
+     * @param pump_events Dispatches queued events (including ours to
+     *        handle_event()); called after a round trip so every damage event
+     *        sent before this call has arrived
+     */
+    bool sync(const std::function<void()>& pump_events);
+
+    /**
+     * Copy an area of the mirror into a new XImage.
+     * @return Image owned by the caller (free with XDestroyImage), or nullptr
+     *         if the area is outside the mirror
+     */
+    XImage* copy_area(int x, int y, unsigned int width, unsigned int height) const;
+
+private:
+    Display* display_;
+    ShmSegmentPool* shm_pool_;
+    bool available_;
+    int damage_event_base_;
+    Damage damage_;
+    XImage* mirror_;
+    bool mirror_in_shm_;
+    bool damaged_;
+    bool needs_full_grab_;
+
+    // Damaged areas are fetched as full-width bands of this many rows, so a
+    // single pooled SHM segment size serves every update
+    static const int band_rows_ = 64;
+
+    bool grab_full();
+    bool grab_band(int y, int rows);
+    void release_mirror();
+};
+
+#endif // SCREEN_MIRROR_H
@@ -0,0 +1,71 @@
+#ifndef SCREEN_TOPOLOGY_H
+#define SCREEN_TOPOLOGY_H
+
+#include <X11/Xlib.h>
+#include <vector>
+#include <cstdint>
+#include "X11ScreenCapturer.h"
+
+/**
+ * Cached list of monitors and their geometry.
+ * The list is read with XRRGetScreenResourcesCurrent, which returns the
+ * server's current configuration without probing outputs, and is only read
+ * again after a RandR screen, CRTC or output change event. Looking up the
+ * screens for a capture therefore needs no round trips.
+ */
+class ScreenTopology {
+public:
+    /**
+     * Constructor checks for XRandR and selects change events on the root window.
+     * @param display Connection shared with the capturer
+     */
+    explicit ScreenTopology(Display* display);
+
+    ScreenTopology(const ScreenTopology&) = delete;
+    ScreenTopology& operator=(const ScreenTopology&) = delete;
+
+    /**
+     * Current screens, "All Screens" (number -1) first. Changes are only seen
+     * once the owner has passed pending events to handle_event().
+     */
+    const std::vector<X11ScreenCapturer::ScreenInfo>& screens();
+
+    /**
+     * Find a screen by number.
+     * @return Nullptr if there is no such screen
+     */
+    const X11ScreenCapturer::ScreenInfo* find(int number);
+
+    /**
+     * Handle an event read from the shared connection.
+     * @return True if it was a RandR event (the topology is then re-read on next use)
+     */
+    bool handle_event(XEvent& event);
+
+    /**
+     * Types of the RandR events passed to handle_event(), empty without RandR.
+     */
+    std::vector<int> event_types() const;
+
+    /**
+     * Force a re-read on next use.
+     */
+    void invalidate() { valid_ = false; }
+
+    /**
+     * Incremented every time the topology is re-read.
+     */
+    uint64_t generation() const { return generation_; }
+
+private:
+    Display* display_;
+    bool has_randr_;
+    int randr_event_base_;
+    bool valid_;
+    uint64_t generation_;
+    std::vector<X11ScreenCapturer::ScreenInfo> screens_;
+
+    void query();
+};
+
+#endif // SCREEN_TOPOLOGY_H
@@ -0,0 +1,88 @@
+#ifndef SHM_SEGMENT_POOL_H
+#define SHM_SEGMENT_POOL_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/**
+ * Pool of MIT-SHM backed XImages used for zero-copy captures.
+ * Segments are keyed by geometry, depth and visual, created on first use and
+ * reused by later grabs of the same size so the pixel data never goes through
+ * the X socket and no XImage is allocated per capture.
+ */
+class ShmSegmentPool {
+public:
+    /**
+     * Constructor checks for the MIT-SHM extension on the given connection.
+     */
+    explicit ShmSegmentPool(Display* display);
+
+    /**
+     * Destructor detaches and removes all shared memory segments.
+     */
+    ~ShmSegmentPool();
+
+    ShmSegmentPool(const ShmSegmentPool&) = delete;
+    ShmSegmentPool& operator=(const ShmSegmentPool&) = delete;
+
+    /**
+     * Check if shared memory captures can be used on this connection.
+     * Becomes false permanently if the server refuses to attach a segment
+     * (e.g. a remote display), so callers fall back to XGetImage.
+     */
+    bool is_available() const { return available_; }
+
+    /**
+     * Grab an area of a drawable into a pooled shared memory image.
+     * @return Pool-owned image, or nullptr if the grab failed.
+     *         Hand it back with release() instead of XDestroyImage().
+     */
+    XImage* get_image(Drawable drawable, Visual* visual, int depth,
+                      int x, int y, unsigned int width, unsigned int height);
+
+    /**
+     * Check if an image was handed out by this pool.
+     */
+    bool owns(const XImage* image) const;
+
+    /**
+     * Return an image to the pool so its segment can be reused.
+     */
+    void release(XImage* image);
+
+    /**
+     * Destroy all idle segments.
+     */
+    void clear();
+
+private:
+    struct Segment {
+        XImage* image = nullptr;
+        XShmSegmentInfo info{};
+        Visual* visual = nullptr;
+        int depth = 0;
+        bool attached = false;
+        bool in_use = false;
+        unsigned long last_used = 0;
+    };
+
+    Display* display_;
+    bool available_;
+    // Segments are heap allocated because XShmCreateImage keeps a pointer to
+    // the XShmSegmentInfo in the image
+    std::vector<std::unique_ptr<Segment>> segments_;
+    unsigned long use_counter_;
+    size_t max_idle_segments_;
+
+    Segment* acquire(Visual* visual, int depth, unsigned int width, unsigned int height);
+    bool create_segment(Segment& segment, Visual* visual, int depth,
+                        unsigned int width, unsigned int height);
+    void destroy_segment(Segment& segment);
+    void trim_idle_segments();
+};
+
+#endif // SHM_SEGMENT_POOL_H
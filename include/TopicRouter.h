@@ -0,0 +1,98 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Registry of message handlers, each registered against an MQTT topic
+ * filter ("+" matches one level, a trailing "#" any number of levels).
+ * Filters are kept in a trie of topic levels, so finding the handlers of a
+ * topic walks its levels once instead of testing every filter. Thread-safe.
+ */
+class TopicRouter {
+public:
+    using Handler = std::function<void(std::string_view topic, std::string_view payload)>;
+
+    // Where a handler runs
+    enum class Delivery {
+        NetworkThread,  // On the thread that received the message; must be quick
+        Worker,         // On a worker thread, in no particular order
+        MainLoop        // On the Glib main loop, in the order received
+    };
+
+    struct Route {
+        uint64_t id = 0;
+        std::string filter;
+        Delivery delivery = Delivery::NetworkThread;
+        Handler handler;
+        std::atomic<bool> active{true};  // Cleared on removal, for deliveries already queued
+        // Held while the handler runs and while active is cleared, so no
+        // call is in progress or starts once remove() returns. Recursive so
+        // a handler can remove itself.
+        mutable std::recursive_mutex call_mutex;
+    };
+
+    TopicRouter();
+
+    TopicRouter(const TopicRouter&) = delete;
+    TopicRouter& operator=(const TopicRouter&) = delete;
+
+    /**
+     * Register a handler.
+     * @return Id for remove(), 0 if the filter is malformed
+     */
+    uint64_t add(const std::string& filter, Delivery delivery, Handler handler);
+
+    /**
+     * Unregister a handler. Deliveries already queued for it are skipped,
+     * and a call running on another thread is waited for.
+     * @param unused_filter Set to the handler's filter if no handler is
+     *        left on it, so it can be unsubscribed, and to "" otherwise
+     * @return False if there is no such handler
+     */
+    bool remove(uint64_t id, std::string& unused_filter);
+
+    /**
+     * Handlers whose filter matches a topic.
+     */
+    std::vector<std::shared_ptr<const Route>> match(std::string_view topic) const;
+
+    /**
+     * Filters that have at least one handler.
+     */
+    std::vector<std::string> filters() const;
+
+    /**
+     * Whether a filter is well-formed: wildcards take a whole level and
+     * "#" is only the last level.
+     */
+    static bool valid_filter(const std::string& filter);
+
+private:
+    struct Node {
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+        std::vector<std::shared_ptr<Route>> routes;
+    };
+
+    Node root_;
+    std::map<uint64_t, std::shared_ptr<Route>> routes_;
+    uint64_t next_id_;
+    mutable std::shared_mutex mutex_;
+
+    static std::vector<std::string_view> split(std::string_view topic);
+    static void collect(const Node& node, const std::vector<std::string_view>& levels, size_t level,
+                        std::vector<std::shared_ptr<const Route>>& matches);
+    static bool prune(Node& node, const std::vector<std::string_view>& levels, size_t level, uint64_t id,
+                      bool& filter_unused);
+};
+
+#endif // TOPIC_ROUTER_H
@@ -0,0 +1,59 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <cstddef>
+
+/**
+ * Fixed-size pool of worker threads running queued tasks in FIFO order.
+ */
+class WorkerPool {
+public:
+    /**
+     * Constructor starts the workers.
+     * @param thread_count Number of threads, 0 for one per hardware thread
+     */
+    explicit WorkerPool(size_t thread_count = 0);
+
+    /**
+     * Destructor runs the remaining tasks and joins the workers.
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Queue a task.
+     * @return Future that becomes ready when the task has run; exceptions
+     *         thrown by the task are rethrown from get()
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    /**
+     * Number of worker threads.
+     */
+    size_t size() const { return workers_.size(); }
+
+    /**
+     * Number of hardware threads, at least 1.
+     */
+    static size_t hardware_threads();
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+
+    void run();
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,127 @@
+#ifndef X11_CONNECTION_H
+#define X11_CONNECTION_H
+
+#include <X11/Xlib.h>
+#include <glibmm/main.h>
+#include <sigc++/signal.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class X11EventSource;
+
+/**
+ * One Xlib connection shared by the components running on the main thread.
+ * It owns event reading: queued events are read once and handed to the
+ * subscribers registered for their type (and, optionally, the window they
+ * were reported on). The atoms the application needs are interned in a
+ * single request when the connection is opened.
+ *
+ * Xlib connections are not shared between threads; worker threads open
+ * their own connection.
+ */
+class X11Connection {
+public:
+    // Atoms interned at startup
+    enum AtomId {
+        NET_WM_NAME,
+        NET_CLIENT_LIST,
+        UTF8_STRING,
+        ATOM_COUNT
+    };
+
+    // Event type that matches every event (X event types start at 2)
+    static const int ANY_EVENT_TYPE = 0;
+
+    typedef std::function<void(XEvent&)> EventHandler;
+
+    /**
+     * Constructor opens the display and interns the atoms.
+     */
+    X11Connection();
+
+    /**
+     * Destructor stops dispatching and closes the display.
+     */
+    ~X11Connection();
+
+    X11Connection(const X11Connection&) = delete;
+    X11Connection& operator=(const X11Connection&) = delete;
+
+    Display* display() const { return display_; }
+    bool is_open() const { return display_ != nullptr; }
+
+    /**
+     * Get an atom interned at startup.
+     */
+    Atom atom(AtomId id) const { return atoms_[id]; }
+
+    /**
+     * Add events to those selected on a window. Selections are per
+     * connection, so components sharing it must not overwrite each
+     * other's masks with XSelectInput.
+     */
+    void select_input(Window window, long event_mask);
+
+    /**
+     * Add events to those recorded for a window without selecting them,
+     * for callers that send the selection themselves (e.g. over XCB).
+     * @param mask Set to the whole mask to select
+     * @return False if the events were already selected
+     */
+    bool merge_input(Window window, long event_mask, long& mask);
+
+    /**
+     * Register a handler for an event type.
+     * @param event_type X event type, including extension types, or ANY_EVENT_TYPE
+     * @param window Only events reported on this window (XAnyEvent::window), 0 for all
+     * @return Subscription id for unsubscribe()
+     */
+    int subscribe(int event_type, Window window, EventHandler handler);
+
+    /**
+     * Remove a handler; safe to call from inside a handler.
+     */
+    void unsubscribe(int id);
+
+    /**
+     * Read and dispatch every queued event, then emit signal_events_dispatched.
+     */
+    void dispatch_pending();
+
+    /**
+     * Dispatch events from the main loop as they arrive. Only for the
+     * connection used on the main thread.
+     */
+    void start_dispatching();
+    void stop_dispatching();
+
+    /**
+     * Signal emitted after a batch of events was dispatched, so subscribers
+     * can apply the work collected from several events at once.
+     */
+    typedef sigc::signal<void> type_signal_events_dispatched;
+    type_signal_events_dispatched signal_events_dispatched() { return m_signal_events_dispatched; }
+
+private:
+    struct Subscription {
+        int id;
+        Window window;
+        EventHandler handler;
+    };
+
+    Display* display_;
+    Atom atoms_[ATOM_COUNT];
+    std::unordered_map<Window, long> event_masks_;
+    std::unordered_map<int, std::vector<Subscription>> subscriptions_;
+    int next_subscription_id_;
+    int dispatch_depth_;     // Handlers may capture, which dispatches again
+    bool has_removed_;       // Unsubscribed entries wait until no dispatch runs
+    Glib::RefPtr<X11EventSource> event_source_;
+    type_signal_events_dispatched m_signal_events_dispatched;
+
+    void dispatch(XEvent& event, int event_type);
+    void remove_unsubscribed();
+};
+
+#endif // X11_CONNECTION_H
@@ -0,0 +1,64 @@
+#ifndef X11_ERROR_TRAP_H
+#define X11_ERROR_TRAP_H
+
+#include <X11/Xlib.h>
+
+/**
+ * Catches the X errors of requests that may legitimately fail, such as
+ * requests on a window that is being destroyed.
+ *
+ * XSetErrorHandler is process-wide, so swapping handlers around each
+ * request races as soon as captures run on more than one thread. Instead a
+ * single handler is installed once. It hands each error to the innermost
+ * trap open on the calling thread for that display. Errors with no open
+ * trap go to the handler that was installed before, as they did without
+ * any trap.
+ *
+ * Errors are only seen once their reply or a sync arrives, so requests
+ * without a reply need an XSync before the trap is checked.
+ */
+class X11ErrorTrap {
+public:
+    /**
+     * Start trapping errors on display for this thread.
+     */
+    explicit X11ErrorTrap(Display* display);
+
+    /**
+     * Stop trapping; errors arriving later are not caught.
+     */
+    ~X11ErrorTrap();
+
+    X11ErrorTrap(const X11ErrorTrap&) = delete;
+    X11ErrorTrap& operator=(const X11ErrorTrap&) = delete;
+
+    /**
+     * Whether an error arrived since the trap was opened or reset.
+     */
+    bool had_error() const { return error_code_ != Success; }
+
+    /**
+     * Code of the first error, Success if none.
+     */
+    int error_code() const { return error_code_; }
+
+    /**
+     * Forget the errors caught so far.
+     */
+    void reset() { error_code_ = Success; }
+
+    /**
+     * Install the handler. Called by the first trap; call it earlier to
+     * install from a known thread after the toolkit installed its own.
+     */
+    static void install();
+
+private:
+    Display* display_;
+    int error_code_;
+    X11ErrorTrap* outer_;  // Trap open on this thread before this one
+
+    static int handle_error(Display* display, XErrorEvent* error);
+};
+
+#endif // X11_ERROR_TRAP_H
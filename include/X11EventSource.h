@@ -0,0 +1,42 @@
+#ifndef X11_EVENT_SOURCE_H
+#define X11_EVENT_SOURCE_H
+
+#include <X11/Xlib.h>
+#include <glibmm/main.h>
+#include <sigc++/connection.h>
+
+/**
+ * Main loop source that dispatches an Xlib connection's events as they arrive.
+ * The connection's file descriptor is polled, so the loop sleeps while the
+ * connection is idle instead of waking on a timer. Events that Xlib already
+ * read into its queue while waiting for a reply (e.g. in XSync) are dispatched
+ * on the next loop iteration without waiting for more input, and pending
+ * requests are flushed before the loop goes to sleep.
+ */
+class X11EventSource : public Glib::Source {
+public:
+    /**
+     * Create a source for a connection; it still needs to be attached.
+     * @param display Connection whose events are dispatched
+     */
+    static Glib::RefPtr<X11EventSource> create(Display* display);
+
+    /**
+     * Connect the callback that reads the queued events.
+     * The callback is expected to drain the queue (XPending/XNextEvent).
+     */
+    sigc::connection connect(const sigc::slot<void>& slot);
+
+protected:
+    explicit X11EventSource(Display* display);
+
+    bool prepare(int& timeout) override;
+    bool check() override;
+    bool dispatch(sigc::slot_base* slot) override;
+
+private:
+    Display* display_;
+    Glib::PollFD poll_fd_;
+};
+
+#endif // X11_EVENT_SOURCE_H
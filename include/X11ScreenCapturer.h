@@ -5,9 +5,23 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
+#include <unordered_map>
 #include <sigc++/signal.h>
 #include <sigc++/connection.h>
 #include <glibmm/main.h>
+#include "RawImage.h"
+#include "CaptureSettings.h"
+#include "EncodedImage.h"
+#include "ImageEncoder.h"
+#include "ImageScaler.h"
+
+class ShmSegmentPool;
+class ScreenMirror;
+class CompositeWindowCache;
+class ScreenTopology;
+class XcbWindowScanner;
+class X11Connection;
 
 class X11ScreenCapturer {
 public:
@@ -27,16 +41,105 @@ public:
         unsigned int width, height;
     };
     
+    // Rectangle on the desktop, or inside a window for window-relative captures
+    struct CaptureRect {
+        int x, y;
+        unsigned int width, height;
+    };
+    
+    struct MonitorImage {
+        ScreenInfo screen;
+        RawImage raw;
+        EncodedImage encoded;  // Only filled by capture_monitors_encoded
+    };
+    
+    // Opens a connection of its own (for capture threads)
     X11ScreenCapturer();
+    // Shares the main thread's connection and its event dispatching
+    explicit X11ScreenCapturer(std::shared_ptr<X11Connection> connection);
     ~X11ScreenCapturer();
     
     std::vector<WindowInfo> list_windows();
+    bool get_window_info(Window id, WindowInfo& info);
+    // Look up a top-level window; served from the window table while window
+    // events are monitored, otherwise asks the server
+    bool find_window(Window id, WindowInfo& info);
     std::vector<ScreenInfo> detect_screens();
     bool capture_window(const WindowInfo& window, const std::string& filename);
     XImage* capture_window_image(const WindowInfo& window);
     bool capture_screen(int screen_number, const std::string& filename);
     XImage* capture_screen_image(int screen_number);
     
+    // In-memory captures: nothing is written to disk
+    bool capture_window_raw(const WindowInfo& window, RawImage& raw);
+    bool capture_screen_raw(int screen_number, RawImage& raw);
+    // Encoded captures are first scaled down to fit the limits, if any
+    bool capture_window_encoded(const WindowInfo& window, EncodedImage& encoded,
+                                const ImageScaler::Limits& limits = ImageScaler::Limits());
+    bool capture_screen_encoded(int screen_number, EncodedImage& encoded,
+                                const ImageScaler::Limits& limits = ImageScaler::Limits());
+    
+    // Region captures: only the rectangle, clipped to the desktop or to the
+    // window, is fetched from the server
+    XImage* capture_region_image(const CaptureRect& region);
+    XImage* capture_window_region_image(const WindowInfo& window, const CaptureRect& region);
+    bool capture_region_raw(const CaptureRect& region, RawImage& raw);
+    bool capture_window_region_raw(const WindowInfo& window, const CaptureRect& region, RawImage& raw);
+    bool capture_region_encoded(const CaptureRect& region, EncodedImage& encoded,
+                                const ImageScaler::Limits& limits = ImageScaler::Limits());
+    bool capture_window_region_encoded(const WindowInfo& window, const CaptureRect& region,
+                                       EncodedImage& encoded,
+                                       const ImageScaler::Limits& limits = ImageScaler::Limits());
+    
+    // Capture every connected monitor as its own image, so the dead space
+    // between outputs of different sizes is never grabbed or encoded.
+    // Grabs go out back to back; conversion and encoding run in parallel.
+    // Reusing the same vector reuses its pixel buffers.
+    bool capture_monitors_raw(std::vector<MonitorImage>& monitors);
+    bool capture_monitors_encoded(std::vector<MonitorImage>& monitors,
+                                  const ImageScaler::Limits& limits = ImageScaler::Limits());
+    
+    // Convert an XImage to ARGB32 and encode it in the output format
+    static bool to_raw_image(const XImage* image, RawImage& raw);
+    bool encode_image(const RawImage& raw, EncodedImage& encoded,
+                      const ImageScaler::Limits& limits = ImageScaler::Limits());
+    
+    // Filter for scaling encoded captures down ("area" by default)
+    void set_scale_filter(ImageScaler::Filter filter) { scale_filter_ = filter; }
+    ImageScaler::Filter get_scale_filter() const { return scale_filter_; }
+    
+    // Output format for encoded captures ("png", "jpeg", "webp") and lossy quality
+    bool set_output_format(const std::string& format);
+    std::string get_output_format() const;
+    void set_quality(int quality);
+    int get_quality() const;
+    
+    // PNG compression (parallel encoder, "balanced" preset by default)
+    void set_png_preset(PngEncoder::Preset preset);
+    void set_png_compression_level(int level);
+    PngEncoder::Preset get_png_preset() const;
+    
+    // Images returned by capture_*_image may live in shared memory,
+    // always free them with release_image() instead of XDestroyImage()
+    void release_image(XImage* image);
+    
+    // MIT-SHM capture mode (on by default, falls back to XGetImage)
+    void set_use_shm(bool use_shm);
+    bool is_using_shm() const;
+    
+    // Per-capture progress messages (on by default, errors are always logged)
+    void set_log_captures(bool log_captures) { log_captures_ = log_captures; }
+    
+    // Mirror mode (off by default): keep a damage-tracked copy of the desktop
+    // and serve screen captures from it
+    bool set_use_mirror(bool use_mirror);
+    bool is_using_mirror() const;
+    
+    // Grab and encoding settings at once, to configure capturers on other
+    // threads like this one
+    CaptureSettings get_capture_settings() const;
+    void apply_capture_settings(const CaptureSettings& settings);
+    
     // Window event monitoring functions
     bool start_window_events_monitoring();
     void stop_window_events_monitoring();
@@ -46,19 +149,76 @@ public:
     typedef sigc::signal<void> type_signal_window_list_changed;
     type_signal_window_list_changed signal_window_list_changed() { return m_signal_window_list_changed; }
     
+    // Signal for monitor configuration changes (RandR), while monitoring window events
+    typedef sigc::signal<void> type_signal_screens_changed;
+    type_signal_screens_changed signal_screens_changed() { return m_signal_screens_changed; }
+    
 private:
+    std::shared_ptr<X11Connection> connection_;
     Display* display;
     bool monitoring_window_events_;
-    sigc::connection event_check_connection_;
+    bool use_shm_;
+    bool log_captures_;
+    std::unique_ptr<ShmSegmentPool> shm_pool_;
+    std::unique_ptr<ScreenMirror> mirror_;
+    std::unique_ptr<CompositeWindowCache> composite_cache_;
+    std::unique_ptr<ScreenTopology> topology_;
+    std::unique_ptr<XcbWindowScanner> window_scanner_;
+    ImageEncoder image_encoder_;
+    ImageScaler::Filter scale_filter_;
     
-    // X11 event handling
-    bool process_x11_events();
+    // X11 event handling: the connection reads events and hands each one to
+    // the subscribed component; window list and screen changes collected
+    // from a batch are applied and signalled once it is done
+    std::vector<int> subscriptions_;
+    std::vector<int> window_event_subscriptions_;
+    int mirror_subscription_;
+    sigc::connection batch_connection_;
+    std::vector<Window> new_windows_;
+    std::vector<Window> stale_titles_;
+    bool rescan_windows_;
+    bool window_list_changed_;
+    bool screens_changed_;
+    void pump_x11_events();
     void register_for_window_events();
+    void handle_window_event(XEvent& event);
+    void finish_event_batch();
+    
+    // Top-level windows by id, kept current from window events while
+    // monitoring so listing and lookups need no round trips
+    std::unordered_map<Window, WindowInfo> window_table_;
+    bool window_table_valid_;
+    bool window_table_client_list_;  // Built from _NET_CLIENT_LIST, not the root's children
+    Atom wm_name_atom_;
+    Atom net_wm_name_atom_;
+    void rebuild_window_table();
+    bool update_window_table(const XEvent& event, std::vector<Window>& new_windows,
+                             std::vector<Window>& stale_titles, bool& rescan);
+    bool refresh_window_table(const std::vector<Window>& new_windows,
+                              const std::vector<Window>& stale_titles);
+    static bool is_listed(const WindowInfo& info);
     
     // Window list change signal
     type_signal_window_list_changed m_signal_window_list_changed;
+    type_signal_screens_changed m_signal_screens_changed;
+    
+    // Grab an area of a drawable, through MIT-SHM when possible
+    XImage* grab_image(Drawable drawable, Visual* visual, int depth,
+                       int x, int y, unsigned int width, unsigned int height);
+    
+    // Grab an area of the desktop, from the (synced) mirror if requested
+    XImage* grab_screen_area(int x, int y, unsigned int width, unsigned int height,
+                             bool from_mirror);
+    
+    // Clip a region to a width x height area at the origin
+    // @return False if nothing of it is left
+    static bool clip_region(CaptureRect& region, int width, int height);
     
-    bool save_image_to_png(XImage* image, const std::string& filename);
+    // Save in the format given by the file extension
+    bool save_image(XImage* image, const std::string& filename);
+    bool encode_captured_image(XImage* image, EncodedImage& encoded,
+                               const ImageScaler::Limits& limits = ImageScaler::Limits(),
+                               const std::string& format = "");
 };
 
 #endif // X11_SCREEN_CAPTURER_H
\ No newline at end of file
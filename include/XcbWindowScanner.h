@@ -0,0 +1,78 @@
+#ifndef XCB_WINDOW_SCANNER_H
+#define XCB_WINDOW_SCANNER_H
+
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "X11ScreenCapturer.h"
+
+class X11Connection;
+
+/**
+ * Enumerates top-level windows through XCB on the capturer's Xlib connection.
+ * Instead of several synchronous Xlib calls per window, every attribute,
+ * geometry, position and title request for all windows is sent at once and
+ * the replies are collected afterwards, so a scan costs about three round
+ * trips however many windows there are.
+ * Windows come from the window manager's _NET_CLIENT_LIST when it has one,
+ * which lists the application windows inside reparenting WM frames; the root
+ * window's children are used otherwise.
+ */
+class XcbWindowScanner {
+public:
+    /**
+     * Constructor takes the atoms used for scanning from the connection.
+     * @param connection Xlib connection to share; events selected by the
+     *        scanner are recorded in it
+     */
+    explicit XcbWindowScanner(X11Connection& connection);
+
+    XcbWindowScanner(const XcbWindowScanner&) = delete;
+    XcbWindowScanner& operator=(const XcbWindowScanner&) = delete;
+
+    bool is_available() const { return connection_ != nullptr; }
+
+    /**
+     * Scan all windows (including hidden and untitled ones).
+     * @param windows Receives the windows, in client list / stacking order
+     * @param event_mask If non-zero, added to the events selected on every
+     *        window in the same pass
+     * @return False if the root window could not be queried
+     */
+    bool scan(std::vector<X11ScreenCapturer::WindowInfo>& windows, uint32_t event_mask = 0);
+
+    /**
+     * Fetch the titles of several windows in one round trip.
+     * @param titles Receives one title per window, "[Unnamed Window]" if it
+     *               has none, empty if the window is gone
+     */
+    void fetch_titles(const std::vector<Window>& windows, std::vector<std::string>& titles);
+
+    /**
+     * Add events to those selected on several windows in one round trip.
+     * Errors for windows that are already gone are ignored.
+     */
+    void select_events(const std::vector<Window>& windows, uint32_t event_mask);
+
+    /**
+     * Check if the last scan used the window manager's client list.
+     */
+    bool used_client_list() const { return used_client_list_; }
+
+    // Interned atoms, for recognising events about them
+    xcb_atom_t client_list_atom() const { return client_list_atom_; }
+    xcb_atom_t net_wm_name_atom() const { return net_wm_name_atom_; }
+
+private:
+    X11Connection& x11_;
+    xcb_connection_t* connection_;
+    xcb_window_t root_;
+    xcb_atom_t client_list_atom_;
+    xcb_atom_t net_wm_name_atom_;
+    xcb_atom_t utf8_string_atom_;
+    bool used_client_list_;
+};
+
+#endif // XCB_WINDOW_SCANNER_H
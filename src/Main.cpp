@@ -1,8 +1,13 @@
 #include <gtkmm/application.h>
+#include <X11/Xlib.h>
 #include "../include/SauronWindow.h"
 
 int main(int argc, char *argv[])
 {
+    // Capture threads use Xlib alongside GDK, so its locking must be on
+    // before the first connection is opened
+    XInitThreads();
+
     auto app = Gtk::Application::create(argc, argv, "org.sauron.eye");
     
     SauronWindow window;
@@ -1,5 +1,6 @@
 #include "../include/OllamaBackend.h"
 #include "../include/SauronAgent.h" // For Message struct
+#include "../include/ImageFormat.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -144,7 +145,12 @@ std::string OllamaBackend::prepare_request_payload(const std::vector<Message>& m
     formatted_prompt += "Assistant: ";
     
     // Add image if provided
-    if (!image_path.empty()) {
+    // Ollama takes bare base64 images and only decodes PNG and JPEG
+    std::string image_format = ImageFormat::from_path(image_path);
+    if (!image_path.empty() && image_format == "webp") {
+        std::cout << "⚠️ Ollama does not accept " << ImageFormat::mime_type(image_format)
+                  << " images. Continuing with text only." << std::endl;
+    } else if (!image_path.empty()) {
         std::string base64_image;
         if (encode_image_base64(image_path, base64_image)) {
             // Add image data to the payload if the model supports it
@@ -1,5 +1,6 @@
 #include "../include/OpenAIBackend.h"
 #include "../include/SauronAgent.h" // For Message struct
+#include "../include/ImageFormat.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -86,7 +87,9 @@ std::string OpenAIBackend::prepare_request_payload(const std::vector<Message>& m
             if (encode_image_base64(image_path, image_url)) { // Correct function name and pass image_url by reference
                 json image_part;
                 image_part["type"] = "image_url";
-                image_part["image_url"]["url"] = "data:image/png;base64," + image_url; // Assuming PNG, adjust if needed
+                // MIME type follows the capture format (png, jpeg, webp)
+                std::string mime_type = ImageFormat::mime_type(ImageFormat::from_path(image_path));
+                image_part["image_url"]["url"] = "data:" + mime_type + ";base64," + image_url;
                 content_array.push_back(image_part);
             } else {
                  std::cerr << "Warning: Could not encode image: " << image_path << std::endl;
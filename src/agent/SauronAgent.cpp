@@ -1,12 +1,18 @@
 #include "../include/SauronAgent.h"
 #include "../include/AIBackend.h"
+#include "../include/ImageFormat.h"
+#include "../include/ImageFrame.h"
+#include "../include/MqttTopics.h"
+#include <openssl/evp.h>
 #include <iostream>
 #include <chrono>
+#include <cctype>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
 #include <nlohmann/json.hpp> // Make sure json is included
 
 using json = nlohmann::json;
@@ -20,6 +26,47 @@ std::string get_current_timestamp() {
     return ss.str();
 }
 
+// A string field of a received header, or the default if it is missing or
+// of another type; json::value() would throw for the latter
+static std::string header_string(const json& object, const std::string& key, const std::string& default_value) {
+    auto field = object.find(key);
+    return field != object.end() && field->is_string() ? field->get<std::string>() : default_value;
+}
+
+// A sender-supplied label reduced to [A-Za-z0-9_-], for use in file names
+static std::string safe_file_label(const std::string& label) {
+    std::string safe;
+    for (char c : label) {
+        if (safe.size() >= 32) {
+            break;
+        }
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
+            safe += c;
+        }
+    }
+    return safe.empty() ? "capture" : safe;
+}
+
+// Decode the base64 image_data of JSON image messages
+static bool decode_base64(const std::string& encoded, std::vector<unsigned char>& decoded) {
+    if (encoded.size() % 4 != 0) {
+        return false;
+    }
+    decoded.resize(encoded.size() / 4 * 3);
+    int length = EVP_DecodeBlock(decoded.data(), reinterpret_cast<const unsigned char*>(encoded.data()),
+                                 static_cast<int>(encoded.size()));
+    if (length < 0) {
+        return false;
+    }
+    // EVP_DecodeBlock counts padding as zero bytes
+    size_t padding = 0;
+    for (size_t i = encoded.size(); i > 0 && encoded[i - 1] == '=' && padding < 2; --i) {
+        ++padding;
+    }
+    decoded.resize(static_cast<size_t>(length) - padding);
+    return true;
+}
+
 // Message role conversion methods
 std::string Message::role_to_string() const {
     switch (role) {
@@ -54,6 +101,9 @@ SauronAgent::~SauronAgent() {
     }
     
     // Disconnect MQTT
+    if (mqtt_handler_ != 0) {
+        mqtt_client_->remove_handler(mqtt_handler_);
+    }
     if (mqtt_connected_) {
         mqtt_client_->disconnect();
     }
@@ -77,6 +127,10 @@ bool SauronAgent::initialize(int argc, char* argv[]) {
     // Load settings
     load_settings(); // Settings are loaded here
     
+    // Chunked transfers that stall are dropped
+    Glib::signal_timeout().connect_seconds(
+        sigc::mem_fun(*this, &SauronAgent::expire_chunk_transfers), 5);
+    
     add_debug_text("✅ SauronAgent initialized successfully\n");
 
     // Attempt automatic connection after initialization and loading settings
@@ -199,7 +253,7 @@ void SauronAgent::setup_ui() {
     auto mqtt_topic_box = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 5));
     auto mqtt_topic_label = Gtk::manage(new Gtk::Label("MQTT Topic:"));
     mqtt_topic_box->pack_start(*mqtt_topic_label, false, false);
-    mqtt_topic_entry_.set_text("sauron"); // Set to unified topic
+    mqtt_topic_entry_.set_text(MqttTopics::subscription("agent")); // Everything addressed to the agent
     mqtt_topic_entry_.set_editable(false); // Make it non-editable
     mqtt_topic_box->pack_start(mqtt_topic_entry_, true, true);
     config_box_.pack_start(*mqtt_topic_box, false, false);
@@ -428,20 +482,31 @@ void SauronAgent::on_mqtt_connect_clicked() {
              mqtt_client_ = std::make_shared<MqttClient>(); // Or however it's initialized
         }
 
+        // The hello goes out on every (re)connect, once the broker accepted us;
+        // the callback runs on the network thread and the hello logs to the UI
+        mqtt_client_->set_connect_callback([this]() {
+            Glib::signal_idle().connect_once([this]() { send_hello_to_ui(); });
+        });
         if (mqtt_client_->connect(host, "SauronAgent_" + std::to_string(std::time(nullptr)), port)) {
             mqtt_connected_ = true;
             mqtt_connect_button_.set_label("Disconnect");
             mqtt_status_label_.set_markup("<span foreground='green'>Connected</span>");
             add_debug_text("✅ Connected to MQTT broker\n");
             
-            // Subscribe to the unified topic
-            const std::string unified_topic = "sauron";
-            mqtt_client_->set_message_callback(
-                sigc::mem_fun(*this, &SauronAgent::on_mqtt_message));
-            if (mqtt_client_->subscribe(unified_topic)) {
-                add_debug_text("✅ Subscribed to unified topic: " + unified_topic + "\n");
-            } else {
-                add_debug_text("❌ Failed to subscribe to unified topic\n");
+            // Handle everything addressed to the agent; kept across reconnects.
+            // Handling touches the UI, the database and the spool, so it runs
+            // on the main loop rather than the network thread.
+            if (mqtt_handler_ == 0) {
+                const std::string agent_topics = MqttTopics::subscription("agent");
+                mqtt_handler_ = mqtt_client_->add_handler(
+                    agent_topics,
+                    [this](std::string_view topic, std::string_view payload) { on_mqtt_message(topic, payload); },
+                    MqttClient::Delivery::MainLoop);
+                if (mqtt_handler_ != 0) {
+                    add_debug_text("✅ Subscribed to " + agent_topics + "\n");
+                } else {
+                    add_debug_text("❌ Failed to subscribe to " + agent_topics + "\n");
+                }
             }
         } else {
             add_debug_text("❌ Failed to connect to MQTT broker\n");
@@ -459,40 +524,72 @@ void SauronAgent::on_mqtt_connect_clicked() {
     }
 }
 
-void SauronAgent::on_mqtt_message(const std::string& topic, const std::string& payload) {
-    add_debug_text("📥 Received message on topic '" + topic + "'\n"); // Payload logged below if valid
+void SauronAgent::on_mqtt_message(std::string_view topic, std::string_view payload) {
+    add_debug_text("📥 Received message on topic '" + std::string(topic) + "'\n"); // Payload logged below if valid
 
-    // 1. Check if the topic is the unified "sauron" topic
-    if (topic != "sauron") {
-        add_debug_text("   Ignoring message on non-sauron topic.\n");
+    // 1. The topic says who the message is for; the subscription should
+    // only deliver the agent's, but other clients may share the broker
+    std::string from, to, type;
+    if (!MqttTopics::parse(std::string(topic), from, to, type) || to != "agent") {
+        add_debug_text("   Ignoring message on topic not addressed to agent.\n");
         return;
     }
 
-    try {
-        json msg_json = json::parse(payload);
+    // Large messages arrive in chunks; once complete they are handled like
+    // any other message
+    if (ChunkTransfer::is_chunk(payload)) {
+        std::string message;
+        switch (chunk_assembler_.add(payload, message)) {
+            case ChunkAssembler::Result::Complete:
+                add_debug_text("📦 Reassembled " + std::to_string(message.size() / 1024) + " KB message\n");
+                on_mqtt_message(topic, message);
+                break;
+            case ChunkAssembler::Result::Rejected:
+                add_debug_text("❌ Dropped chunk of a rejected transfer\n");
+                break;
+            case ChunkAssembler::Result::Incomplete:
+                break;
+        }
+        return;
+    }
 
-        // 2. Check if the message is intended for the agent ("to": "agent")
-        if (!msg_json.contains("to") || !msg_json["to"].is_string() || msg_json["to"] != "agent") {
-            // add_debug_text("   Ignoring message not addressed to agent: " + payload + "\n"); // Optional: Log ignored messages
+    // Binary image frames only need their small header parsed
+    if (ImageFrame::is_frame(payload)) {
+        json header;
+        std::vector<ImageFrame::Image> images;
+        if (!ImageFrame::decode(payload, header, images)) {
+            add_debug_text("❌ Dropped malformed image frame (" + std::to_string(payload.size()) + " bytes)\n");
             return;
         }
+        handle_images(header, images);
+        return;
+    }
 
-        // 3. Check if the message is from the UI ("from": "ui") - optional but good practice
-        if (!msg_json.contains("from") || !msg_json["from"].is_string() || msg_json["from"] != "ui") {
-             add_debug_text("   Warning: Received message for agent but not from UI: " + payload + "\n");
+    try {
+        json msg_json = json::parse(payload);
+
+        // 2. Check if the message is from the UI - optional but good practice
+        if (from != "ui") {
+             add_debug_text("   Warning: Received message for agent but not from UI: " + std::string(payload) + "\n");
              // Decide whether to process or ignore these
              // return; // Uncomment to strictly ignore non-UI messages
         }
 
 
-        add_debug_text("   Processing message: " + payload + "\n");
+        // Images inside JSON are megabytes of base64, not worth logging
+        if (payload.size() > 1024) {
+            add_debug_text("   Processing " + msg_json.value("type", std::string("untyped")) + " message (" +
+                           std::to_string(payload.size()) + " bytes)\n");
+        } else {
+            add_debug_text("   Processing message: " + std::string(payload) + "\n");
+        }
         // Handle incoming messages from UI based on type
         handle_ui_message(msg_json); // Pass parsed JSON
 
     } catch (const json::parse_error& e) {
-        add_debug_text("❌ Error parsing incoming JSON: " + std::string(e.what()) + "\nPayload: " + payload + "\n");
+        add_debug_text("❌ Error parsing incoming JSON: " + std::string(e.what()) + "\nPayload: " + std::string(payload) + "\n");
     } catch (const json::type_error& e) {
-        add_debug_text("❌ Error accessing JSON fields: " + std::string(e.what()) + "\nPayload: " + payload + "\n");
+        add_debug_text("❌ Error accessing JSON fields: " + std::string(e.what()) + "\nPayload: " + std::string(payload) + "\n");
     } catch (const std::exception& e) {
         add_debug_text("❌ Error processing message: " + std::string(e.what()) + "\n");
     }
@@ -506,7 +603,6 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
     }
 
     std::string type = msg_json["type"];
-    const std::string unified_topic = "sauron"; // Use unified topic for all publishes
 
     try {
         // Handle both the old "user_message" format and the new "text" format
@@ -517,6 +613,9 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
             }
             std::string message = msg_json["message"];
             std::string image_path = msg_json.value("image_path", ""); // Use .value for optional fields
+            if (image_path.empty()) {
+                image_path.swap(pending_image_path_);
+            }
             add_debug_text("👤 User message (old format): " + message + (image_path.empty() ? "" : " (with image)") + "\n");
             send_message_to_ai(message, image_path);
         } else if (type == "text") {
@@ -526,8 +625,52 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
             }
             std::string message = msg_json["data"];
             std::string image_path = msg_json.value("image_path", ""); // Use .value for optional fields
+            if (image_path.empty()) {
+                image_path.swap(pending_image_path_);
+            }
             add_debug_text("👤 User message (text format): " + message + (image_path.empty() ? "" : " (with image)") + "\n");
             send_message_to_ai(message, image_path);
+        } else if (type == "image" || type == "image_sequence") {
+            // UIs that have not heard our hello send images as base64 in JSON
+            std::vector<std::vector<unsigned char>> decoded;
+            json entries = json::array();
+            if (type == "image") {
+                json entry;
+                entry["format"] = msg_json.value("format", "png");
+                entries.push_back(entry);
+                decoded.emplace_back();
+                if (!decode_base64(msg_json.value("image_data", ""), decoded.back())) {
+                    add_debug_text("❌ 'image' message with invalid image_data.\n");
+                    return;
+                }
+            } else if (msg_json.contains("images") && msg_json["images"].is_array()) {
+                for (const auto& frame : msg_json["images"]) {
+                    json entry = frame;
+                    entry.erase("image_data");
+                    entries.push_back(entry);
+                    decoded.emplace_back();
+                    if (!decode_base64(frame.value("image_data", ""), decoded.back())) {
+                        add_debug_text("❌ 'image_sequence' message with invalid image_data.\n");
+                        return;
+                    }
+                }
+            }
+
+            json header = msg_json;
+            header["images"] = entries;
+            std::vector<ImageFrame::Image> images;
+            for (size_t i = 0; i < decoded.size(); ++i) {
+                ImageFrame::Image image;
+                image.meta = &header["images"][i];
+                image.data = decoded[i].data();
+                image.size = decoded[i].size();
+                images.push_back(image);
+            }
+            handle_images(header, images);
+        } else if (type == "hello") {
+            // A UI connected; tell it which image transports we take
+            add_debug_text("🤝 UI connected\n");
+            send_hello_to_ui();
         } else if (type == "start_conversation") {
             // Start a new conversation
             Conversation conv;
@@ -557,7 +700,7 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
             response["conversation_id"] = active_conversation_id_;
             response["title"] = conv.title; // Send back the actual title
 
-            if (!mqtt_client_->publish(unified_topic, response.dump())) {
+            if (!mqtt_client_->publish(MqttTopics::make("agent", "ui", response["type"].get<std::string>()), response.dump())) {
                  add_debug_text("❌ Failed to publish conversation_created response.\n");
             } else {
                  add_debug_text("   📤 Sent conversation_created response.\n");
@@ -593,7 +736,7 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
             }
 
             response["messages"] = messages; // Add the messages array
-            if (!mqtt_client_->publish(unified_topic, response.dump())) {
+            if (!mqtt_client_->publish(MqttTopics::make("agent", "ui", response["type"].get<std::string>()), response.dump())) {
                  add_debug_text("❌ Failed to publish conversation_history response.\n");
             } else {
                  add_debug_text("   📤 Sent conversation_history response.\n");
@@ -625,7 +768,7 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
             }
 
             response["conversations"] = conversations_json;
-            if (!mqtt_client_->publish(unified_topic, response.dump())) {
+            if (!mqtt_client_->publish(MqttTopics::make("agent", "ui", response["type"].get<std::string>()), response.dump())) {
                  add_debug_text("❌ Failed to publish conversation_list response.\n");
             } else {
                  add_debug_text("   📤 Sent conversation_list response.\n");
@@ -640,6 +783,80 @@ void SauronAgent::handle_ui_message(const json& msg_json) {
     }
 }
 
+void SauronAgent::handle_images(const json& header, const std::vector<ImageFrame::Image>& images) {
+    if (images.empty()) {
+        add_debug_text("❌ Image message without images.\n");
+        return;
+    }
+
+    // Received captures are kept on disk; the latest goes with the next user message.
+    // The header comes from the network, so the file name is built from the
+    // local time and a counter, with the trigger only as a filtered label.
+    std::string trigger = header_string(header, "trigger_type", "capture");
+    std::string label = safe_file_label(trigger);
+    std::string stamp;
+    {
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::stringstream ss;
+        ss << std::put_time(std::localtime(&now), "%Y%m%d_%H%M%S");
+        stamp = ss.str();
+    }
+    std::error_code error;
+    const std::filesystem::path directory = std::filesystem::absolute("received", error);
+    std::filesystem::create_directories(directory, error);
+    if (error || directory.empty()) {
+        add_debug_text("❌ Failed to create received/: " + error.message() + "\n");
+        return;
+    }
+    const uint64_t message_number = ++received_image_messages_;
+
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        const ImageFrame::Image& image = images[i];
+        std::string format = image.meta ? header_string(*image.meta, "format", "png") : "png";
+        std::string file_name = stamp + "_" + std::to_string(message_number) + "_" + label;
+        if (images.size() > 1) {
+            file_name += "_" + std::to_string(i + 1);
+        }
+        file_name += ImageFormat::extension(format);
+        std::filesystem::path path = (directory / file_name).lexically_normal();
+        if (path.parent_path() != directory.lexically_normal()) {
+            add_debug_text("❌ Refusing to write received image outside received/: " + file_name + "\n");
+            continue;
+        }
+        std::string name = path.string();
+
+        std::ofstream file(name, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(image.data), static_cast<std::streamsize>(image.size))) {
+            add_debug_text("❌ Failed to write received image " + name + "\n");
+            continue;
+        }
+        pending_image_path_ = name;
+        total_bytes += image.size;
+    }
+
+    add_debug_text("🖼️ Received " + std::to_string(images.size()) + " image(s) from " + trigger + ", " +
+                   std::to_string(total_bytes / 1024) + " KB\n");
+}
+
+bool SauronAgent::expire_chunk_transfers() {
+    for (const auto& expired : chunk_assembler_.expire()) {
+        add_debug_text("⌛ Dropped chunked " + expired + "\n");
+    }
+    return true;
+}
+
+void SauronAgent::send_hello_to_ui() {
+    json hello;
+    hello["to"] = "ui";
+    hello["from"] = "agent";
+    hello["type"] = "hello";
+    hello["image_transport"] = {"json", "binary"};
+    if (!mqtt_client_->publish(MqttTopics::make("agent", "ui", "hello"), hello.dump())) {
+        add_debug_text("❌ Failed to publish hello.\n");
+    }
+}
+
 // Modified send_response_to_ui to add routing info and use unified topic
 void SauronAgent::send_response_to_ui(const std::string& message_content) {
     if (!mqtt_connected_ || !mqtt_client_) {
@@ -668,8 +885,8 @@ void SauronAgent::send_response_to_ui(const std::string& message_content) {
         }
     }
 
-    const std::string unified_topic = "sauron";
-    if (mqtt_client_->publish(unified_topic, response.dump())) {
+    const std::string topic = MqttTopics::make("agent", "ui", response["type"].get<std::string>());
+    if (mqtt_client_->publish(topic, response.dump())) {
         add_debug_text("📤 Sent response to UI (Type: " + response["type"].get<std::string>() + ")\n");
     } else {
         add_debug_text("❌ Failed to send response to UI\n");
@@ -0,0 +1,212 @@
+#include "../../include/CaptureScheduler.h"
+#include "../../include/X11ScreenCapturer.h"
+#include <iostream>
+#include <algorithm>
+
+CaptureScheduler::CaptureScheduler() :
+    next_id_(1),
+    max_pending_(8),
+    drop_policy_(DropPolicy::DropOldest),
+    busy_(false),
+    stopping_(false) {
+    thread_ = std::thread(&CaptureScheduler::run, this);
+}
+
+CaptureScheduler::~CaptureScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t CaptureScheduler::schedule(std::chrono::steady_clock::time_point due, const std::string& key,
+                                    CaptureJob job, CompletionCallback callback, bool* coalesced) {
+    if (coalesced) {
+        *coalesced = false;
+    }
+
+    uint64_t id = 0;
+    Job dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // A waiting job for the same target answers this request too
+        if (!key.empty()) {
+            auto waiting = std::find_if(jobs_.begin(), jobs_.end(),
+                                        [&key](const JobQueue::value_type& entry) { return entry.second.key == key; });
+            if (waiting != jobs_.end()) {
+                id = waiting->second.id;
+                if (due < waiting->first) {
+                    auto node = jobs_.extract(waiting);
+                    node.key() = due;
+                    jobs_.insert(std::move(node));
+                }
+                if (callback) {
+                    waiting->second.callbacks.push_back(std::move(callback));
+                }
+                ++stats_.coalesced;
+                if (coalesced) {
+                    *coalesced = true;
+                }
+            }
+        }
+
+        if (id == 0) {
+            if (jobs_.size() >= max_pending_) {
+                ++stats_.dropped;
+                if (drop_policy_ == DropPolicy::RejectNew || jobs_.empty()) {
+                    return 0;
+                }
+                // Ids grow with every request, the lowest waited longest
+                auto oldest = std::min_element(jobs_.begin(), jobs_.end(),
+                                               [](const JobQueue::value_type& a, const JobQueue::value_type& b) {
+                                                   return a.second.id < b.second.id;
+                                               });
+                dropped = std::move(oldest->second);
+                jobs_.erase(oldest);
+            }
+
+            id = next_id_++;
+            Job queued{id, key, std::move(job), {}};
+            if (callback) {
+                queued.callbacks.push_back(std::move(callback));
+            }
+            jobs_.emplace(due, std::move(queued));
+            ++stats_.queued;
+        }
+    }
+    // The job may be due before the one the thread waits for
+    cv_.notify_one();
+
+    for (auto& dropped_callback : dropped.callbacks) {
+        dropped_callback(dropped.id, nullptr);
+    }
+    return id;
+}
+
+bool CaptureScheduler::cancel(uint64_t id) {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(jobs_.begin(), jobs_.end(),
+                               [id](const JobQueue::value_type& entry) { return entry.second.id == id; });
+        if (it == jobs_.end()) {
+            return false;
+        }
+        job = std::move(it->second);
+        jobs_.erase(it);
+    }
+    cv_.notify_one();
+
+    for (auto& callback : job.callbacks) {
+        callback(job.id, nullptr);
+    }
+    return true;
+}
+
+void CaptureScheduler::set_max_pending(size_t max_pending) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_pending_ = std::max<size_t>(1, max_pending);
+}
+
+void CaptureScheduler::set_drop_policy(DropPolicy policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drop_policy_ = policy;
+}
+
+size_t CaptureScheduler::get_max_pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_pending_;
+}
+
+CaptureScheduler::DropPolicy CaptureScheduler::get_drop_policy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return drop_policy_;
+}
+
+void CaptureScheduler::set_capture_settings(const CaptureSettings& settings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+}
+
+CaptureSettings CaptureScheduler::get_capture_settings() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return settings_;
+}
+
+size_t CaptureScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + (busy_ ? 1 : 0);
+}
+
+CaptureScheduler::Stats CaptureScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.pending = jobs_.size() + (busy_ ? 1 : 0);
+    return stats;
+}
+
+void CaptureScheduler::run() {
+    // Xlib connections are not shared between threads: this thread gets its
+    // own, opened when it is first needed
+    std::unique_ptr<X11ScreenCapturer> capturer;
+
+    while (true) {
+        Job job;
+        CaptureSettings settings;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stopping_) {
+                if (jobs_.empty()) {
+                    cv_.wait(lock);
+                    continue;
+                }
+                auto due = jobs_.begin()->first;
+                if (std::chrono::steady_clock::now() >= due) {
+                    break;
+                }
+                cv_.wait_until(lock, due);
+            }
+            if (stopping_) {
+                break;
+            }
+            job = std::move(jobs_.begin()->second);
+            jobs_.erase(jobs_.begin());
+            settings = settings_;
+            busy_ = true;
+        }
+
+        if (!capturer) {
+            capturer = std::make_unique<X11ScreenCapturer>();
+        }
+        capturer->apply_capture_settings(settings);
+        auto raw = std::make_shared<RawImage>();
+        bool success = job.capture(*capturer, *raw);
+        if (!success) {
+            raw.reset();
+        }
+
+        {
+            // Counted before the callback, so it sees its own job finished
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++(success ? stats_.completed : stats_.failed);
+            busy_ = false;
+        }
+        // Coalesced requests share the image
+        for (auto& callback : job.callbacks) {
+            callback(job.id, raw);
+        }
+    }
+
+    // Jobs that never ran are dropped without a callback, their owner is
+    // going away
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!jobs_.empty()) {
+        std::cout << "⏱️ " << jobs_.size() << " scheduled capture(s) dropped" << std::endl;
+        jobs_.clear();
+    }
+}
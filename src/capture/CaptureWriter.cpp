@@ -0,0 +1,93 @@
+#include "../../include/CaptureWriter.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+CaptureWriter::CaptureWriter() : busy_(false), stopping_(false) {
+    thread_ = std::thread(&CaptureWriter::run, this);
+}
+
+CaptureWriter::~CaptureWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void CaptureWriter::write(const std::string& path, std::shared_ptr<const EncodedImage> image,
+                          CompletionCallback callback) {
+    if (!image) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back({path, std::move(image), std::move(callback)});
+    }
+    cv_.notify_one();
+}
+
+size_t CaptureWriter::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + (busy_ ? 1 : 0);
+}
+
+void CaptureWriter::run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            // Drain the queue before stopping so no capture is lost on exit
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            busy_ = true;
+        }
+
+        bool success = write_file(job.path, *job.image);
+        if (job.callback) {
+            job.callback(job.path, success);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_ = false;
+    }
+}
+
+bool CaptureWriter::write_file(const std::string& path, const EncodedImage& image) {
+    try {
+        std::filesystem::path target(path);
+        if (target.has_parent_path()) {
+            std::filesystem::create_directories(target.parent_path());
+        }
+
+        // Write next to the target and rename, so readers never see a partial file
+        std::filesystem::path temp = target;
+        temp += ".part";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                std::cerr << "❌ Failed to open " << temp.string() << " for writing" << std::endl;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+            if (!file) {
+                std::cerr << "❌ Failed to write " << temp.string() << std::endl;
+                return false;
+            }
+        }
+        std::filesystem::rename(temp, target);
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << "❌ Failed to save capture " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    std::cout << "✅ Capture saved: " << path << std::endl;
+    return true;
+}
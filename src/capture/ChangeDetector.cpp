@@ -0,0 +1,263 @@
+#include "../../include/ChangeDetector.h"
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHANGE_DETECTOR_X86 1
+#endif
+
+namespace {
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ull;
+
+// A tile row is read in 32-byte blocks of four 64-bit lanes
+constexpr int kBlockBytes = 32;
+constexpr int kLanes = 4;
+constexpr int kBlocksPerRow = ChangeDetector::TILE_SIZE * 4 / kBlockBytes;
+
+// One key per lane of every block in a tile row, so that moving pixels
+// within a row changes the hash; one more set scrambles each finished row
+constexpr std::array<uint64_t, (kBlocksPerRow + 1) * kLanes> make_keys() {
+    std::array<uint64_t, (kBlocksPerRow + 1) * kLanes> keys{};
+    uint64_t state = kPrime64_2;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        // splitmix64
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        keys[i] = z ^ (z >> 31);
+    }
+    return keys;
+}
+
+alignas(32) constexpr std::array<uint64_t, (kBlocksPerRow + 1) * kLanes> kKeys = make_keys();
+const uint64_t* const kRowKey = kKeys.data() + kBlocksPerRow * kLanes;
+
+uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t finish_tile(const uint64_t acc[kLanes], int tile_width, int tile_height) {
+    uint64_t h = (static_cast<uint64_t>(tile_width) << 32) | static_cast<uint32_t>(tile_height);
+    for (int i = 0; i < kLanes; ++i) {
+        h = (h ^ avalanche(acc[i])) * kPrime64_1;
+    }
+    return avalanche(h);
+}
+
+void accumulate_scalar(uint64_t acc[kLanes], const unsigned char* data, const uint64_t* key) {
+    for (int i = 0; i < kLanes; ++i) {
+        uint64_t value;
+        std::memcpy(&value, data + i * 8, 8);
+        uint64_t keyed = value ^ key[i];
+        acc[i ^ 1] += value;
+        acc[i] += (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+    }
+}
+
+void scramble_scalar(uint64_t acc[kLanes]) {
+    for (int i = 0; i < kLanes; ++i) {
+        uint64_t a = acc[i] ^ (acc[i] >> 47);
+        acc[i] = (a ^ kRowKey[i]) * kPrime32_1;
+    }
+}
+
+// Reads the last partial block of a row through a zero-padded copy
+const unsigned char* tail_block(const unsigned char* data, int bytes, unsigned char* block) {
+    std::memset(block, 0, kBlockBytes);
+    std::memcpy(block, data, bytes);
+    return block;
+}
+
+uint64_t hash_tile_scalar(const RawImage& image, int x, int y, int tile_width, int tile_height) {
+    uint64_t acc[kLanes] = { kPrime32_1, kPrime64_1, kPrime64_2, kPrime64_3 };
+    const int bytes = tile_width * 4;
+    const int blocks = bytes / kBlockBytes;
+    const int tail = bytes % kBlockBytes;
+    unsigned char block[kBlockBytes];
+
+    for (int row = 0; row < tile_height; ++row) {
+        const unsigned char* p = image.row(y + row) + static_cast<size_t>(x) * 4;
+        for (int b = 0; b < blocks; ++b) {
+            accumulate_scalar(acc, p + b * kBlockBytes, kKeys.data() + b * kLanes);
+        }
+        if (tail) {
+            accumulate_scalar(acc, tail_block(p + blocks * kBlockBytes, tail, block),
+                              kKeys.data() + blocks * kLanes);
+        }
+        scramble_scalar(acc);
+    }
+    return finish_tile(acc, tile_width, tile_height);
+}
+
+#ifdef CHANGE_DETECTOR_X86
+
+__attribute__((target("avx2")))
+inline __m256i accumulate_avx2(__m256i acc, const unsigned char* data, const uint64_t* key) {
+    __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    __m256i keyed = _mm256_xor_si256(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(key)));
+    __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+    // Lane i also takes the value of lane i ^ 1
+    __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(acc, _mm256_add_epi64(swapped, product));
+}
+
+__attribute__((target("avx2")))
+inline __m256i scramble_avx2(__m256i acc) {
+    const __m256i prime = _mm256_set1_epi64x(static_cast<long long>(kPrime32_1));
+    __m256i a = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+    a = _mm256_xor_si256(a, _mm256_load_si256(reinterpret_cast<const __m256i*>(kRowKey)));
+    // 64-bit multiply by a 32-bit constant from two 32x32 products
+    __m256i low = _mm256_mul_epu32(a, prime);
+    __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+    return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+}
+
+__attribute__((target("avx2")))
+uint64_t hash_tile_avx2(const RawImage& image, int x, int y, int tile_width, int tile_height) {
+    alignas(32) uint64_t acc[kLanes] = { kPrime32_1, kPrime64_1, kPrime64_2, kPrime64_3 };
+    __m256i state = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+    const int bytes = tile_width * 4;
+    const int blocks = bytes / kBlockBytes;
+    const int tail = bytes % kBlockBytes;
+    unsigned char block[kBlockBytes];
+
+    for (int row = 0; row < tile_height; ++row) {
+        const unsigned char* p = image.row(y + row) + static_cast<size_t>(x) * 4;
+        for (int b = 0; b < blocks; ++b) {
+            state = accumulate_avx2(state, p + b * kBlockBytes, kKeys.data() + b * kLanes);
+        }
+        if (tail) {
+            state = accumulate_avx2(state, tail_block(p + blocks * kBlockBytes, tail, block),
+                                    kKeys.data() + blocks * kLanes);
+        }
+        state = scramble_avx2(state);
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc), state);
+    return finish_tile(acc, tile_width, tile_height);
+}
+
+#endif // CHANGE_DETECTOR_X86
+
+std::atomic<bool> simd_enabled{true};
+
+bool has_avx2() {
+#ifdef CHANGE_DETECTOR_X86
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported && simd_enabled.load();
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+void ChangeDetector::hash_tiles(const RawImage& image, TileHashes& tiles) {
+    tiles.width = image.width;
+    tiles.height = image.height;
+    tiles.columns = (image.width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles.rows = (image.height + TILE_SIZE - 1) / TILE_SIZE;
+    tiles.hashes.resize(static_cast<size_t>(tiles.columns) * tiles.rows);
+    if (image.empty()) {
+        return;
+    }
+
+#ifdef CHANGE_DETECTOR_X86
+    const bool simd = has_avx2();
+#endif
+
+    for (int row = 0; row < tiles.rows; ++row) {
+        int y = row * TILE_SIZE;
+        int tile_height = std::min(TILE_SIZE, image.height - y);
+        for (int column = 0; column < tiles.columns; ++column) {
+            int x = column * TILE_SIZE;
+            int tile_width = std::min(TILE_SIZE, image.width - x);
+            uint64_t& hash = tiles.hashes[static_cast<size_t>(row) * tiles.columns + column];
+#ifdef CHANGE_DETECTOR_X86
+            if (simd) {
+                hash = hash_tile_avx2(image, x, y, tile_width, tile_height);
+                continue;
+            }
+#endif
+            hash = hash_tile_scalar(image, x, y, tile_width, tile_height);
+        }
+    }
+}
+
+ChangeDetector::Change ChangeDetector::compare(const TileHashes& previous, const TileHashes& current) {
+    Change change;
+    change.has_previous = !previous.empty();
+    change.total_tiles = static_cast<int>(current.hashes.size());
+
+    // Without a previous capture of the same size everything changed
+    if (!change.has_previous || previous.width != current.width || previous.height != current.height) {
+        change.changed_tiles = change.total_tiles;
+        change.width = current.width;
+        change.height = current.height;
+        return change;
+    }
+
+    int min_column = current.columns, min_row = current.rows;
+    int max_column = -1, max_row = -1;
+    for (int row = 0; row < current.rows; ++row) {
+        for (int column = 0; column < current.columns; ++column) {
+            size_t index = static_cast<size_t>(row) * current.columns + column;
+            if (previous.hashes[index] == current.hashes[index]) {
+                continue;
+            }
+            ++change.changed_tiles;
+            min_column = std::min(min_column, column);
+            max_column = std::max(max_column, column);
+            min_row = std::min(min_row, row);
+            max_row = std::max(max_row, row);
+        }
+    }
+
+    if (change.changed_tiles > 0) {
+        change.x = min_column * TILE_SIZE;
+        change.y = min_row * TILE_SIZE;
+        change.width = std::min((max_column + 1) * TILE_SIZE, current.width) - change.x;
+        change.height = std::min((max_row + 1) * TILE_SIZE, current.height) - change.y;
+    }
+    return change;
+}
+
+ChangeDetector::Change ChangeDetector::update(const std::string& target, const RawImage& image) {
+    // The previous hashes are replaced in place, reusing their storage
+    TileHashes& previous = previous_[target];
+    static thread_local TileHashes current;
+    hash_tiles(image, current);
+    Change change = compare(previous, current);
+    std::swap(previous, current);
+    return change;
+}
+
+void ChangeDetector::forget(const std::string& target) {
+    previous_.erase(target);
+}
+
+void ChangeDetector::clear() {
+    previous_.clear();
+}
+
+const char* ChangeDetector::kernel_name() {
+    return has_avx2() ? "avx2" : "scalar";
+}
+
+void ChangeDetector::set_simd_enabled(bool enabled) {
+    simd_enabled = enabled;
+}
@@ -0,0 +1,184 @@
+#include "../../include/CompositeWindowCache.h"
+#include "../../include/X11Connection.h"
+#include "../../include/X11ErrorTrap.h"
+#include <X11/extensions/Xcomposite.h>
+#include <iostream>
+
+CompositeWindowCache::CompositeWindowCache(X11Connection& connection) :
+    connection_(connection),
+    display_(connection.display()),
+    available_(false),
+    use_counter_(0),
+    max_windows_(8) {
+
+    if (!display_) {
+        return;
+    }
+
+    int event_base = 0, error_base = 0;
+    int major = 0, minor = 2;
+    if (XCompositeQueryExtension(display_, &event_base, &error_base) &&
+        XCompositeQueryVersion(display_, &major, &minor) && (major > 0 || minor >= 2)) {
+        available_ = true;
+    } else {
+        std::cerr << "⚠️ XComposite 0.2 not available, capturing windows from the screen" << std::endl;
+    }
+}
+
+CompositeWindowCache::~CompositeWindowCache() {
+    clear();
+}
+
+bool CompositeWindowCache::get(Window window, WindowPixmap& info) {
+    info = WindowPixmap();
+    if (!available_) {
+        return false;
+    }
+
+    auto it = windows_.find(window);
+    if (it != windows_.end() && it->second.valid) {
+        it->second.last_used = ++use_counter_;
+        info = it->second.info;
+        return info.viewable && info.pixmap;
+    }
+
+    XWindowAttributes attrs;
+    X11ErrorTrap trap(display_);
+    Status status = XGetWindowAttributes(display_, window, &attrs);
+    if (!status || trap.had_error()) {
+        if (it != windows_.end()) {
+            free_pixmap(it->second);
+            windows_.erase(it);
+        }
+        return false;
+    }
+
+    bool is_new = (it == windows_.end());
+    if (is_new) {
+        it = windows_.emplace(window, Entry()).first;
+    }
+    Entry& entry = it->second;
+    entry.last_used = ++use_counter_;
+    entry.info.exists = true;
+    entry.info.viewable = (attrs.map_state == IsViewable);
+    entry.info.visual = attrs.visual;
+    entry.info.depth = attrs.depth;
+    entry.info.width = attrs.width;
+    entry.info.height = attrs.height;
+
+    // Setup requests go out together with one sync: the window may vanish
+    // at any point, and its errors must not reach the default handler
+    free_pixmap(entry);
+    trap.reset();
+    if (is_new) {
+        // Watch the window itself for geometry and lifetime changes
+        connection_.select_input(window, StructureNotifyMask);
+        XCompositeRedirectWindow(display_, window, CompositeRedirectAutomatic);
+    }
+    Pixmap pixmap = entry.info.viewable ? XCompositeNameWindowPixmap(display_, window) : 0;
+    XSync(display_, False);
+
+    if (trap.had_error()) {
+        // The pixmap ID may never have been created, so it is not freed
+        std::cerr << "⚠️ Failed to redirect window " << window << std::endl;
+        info = entry.info;
+        return false;
+    }
+
+    entry.info.pixmap = pixmap;
+    entry.valid = true;
+    if (is_new) {
+        trim();
+    }
+    info = entry.info;
+    return info.viewable && info.pixmap;
+}
+
+void CompositeWindowCache::invalidate(Window window) {
+    auto it = windows_.find(window);
+    if (it != windows_.end()) {
+        free_pixmap(it->second);
+        it->second.valid = false;
+    }
+}
+
+void CompositeWindowCache::release(Window window) {
+    auto it = windows_.find(window);
+    if (it == windows_.end()) {
+        return;
+    }
+    free_pixmap(it->second);
+    unredirect(window);
+    windows_.erase(it);
+}
+
+void CompositeWindowCache::clear() {
+    for (auto& [window, entry] : windows_) {
+        free_pixmap(entry);
+        unredirect(window);
+    }
+    windows_.clear();
+}
+
+void CompositeWindowCache::handle_event(const XEvent& event) {
+    switch (event.type) {
+        case ConfigureNotify: {
+            auto it = windows_.find(event.xconfigure.window);
+            // Moves keep the pixmap, only a new size replaces it
+            if (it != windows_.end() &&
+                (event.xconfigure.width != it->second.info.width ||
+                 event.xconfigure.height != it->second.info.height)) {
+                invalidate(event.xconfigure.window);
+            }
+            break;
+        }
+
+        case MapNotify:
+            invalidate(event.xmap.window);
+            break;
+
+        case UnmapNotify:
+            invalidate(event.xunmap.window);
+            break;
+
+        case DestroyNotify: {
+            // The server already dropped the redirection with the window
+            auto it = windows_.find(event.xdestroywindow.window);
+            if (it != windows_.end()) {
+                free_pixmap(it->second);
+                windows_.erase(it);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void CompositeWindowCache::free_pixmap(Entry& entry) {
+    if (entry.info.pixmap) {
+        XFreePixmap(display_, entry.info.pixmap);
+        entry.info.pixmap = 0;
+    }
+}
+
+void CompositeWindowCache::unredirect(Window window) {
+    // The window may have been destroyed without us seeing the event yet
+    X11ErrorTrap trap(display_);
+    XCompositeUnredirectWindow(display_, window, CompositeRedirectAutomatic);
+    XSync(display_, False);
+}
+
+void CompositeWindowCache::trim() {
+    // Release the least recently captured windows beyond the limit
+    while (windows_.size() > max_windows_) {
+        auto oldest = windows_.begin();
+        for (auto it = windows_.begin(); it != windows_.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) {
+                oldest = it;
+            }
+        }
+        release(oldest->first);
+    }
+}
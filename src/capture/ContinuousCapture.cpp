@@ -0,0 +1,137 @@
+#include "../../include/ContinuousCapture.h"
+#include "../../include/X11ScreenCapturer.h"
+#include <iostream>
+#include <algorithm>
+
+ContinuousCapture::ContinuousCapture(size_t ring_capacity) :
+    ring_(std::make_unique<FrameRing>(ring_capacity)),
+    running_(false),
+    fps_(2.0),
+    target_(Target::Screen),
+    target_id_(0) {
+}
+
+ContinuousCapture::~ContinuousCapture() {
+    stop();
+}
+
+bool ContinuousCapture::start(Target target, unsigned long id, double fps, int width, int height) {
+    if (running_.load()) {
+        std::cerr << "⚠️ Continuous capture already running" << std::endl;
+        return false;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // Frames are allocated here rather than by the first captures; slots
+    // that already have this size keep their buffers
+    ring_->preallocate(width, height);
+
+    target_ = target;
+    target_id_ = id;
+    set_fps(fps);
+    running_ = true;
+    thread_ = std::thread(&ContinuousCapture::run, this);
+
+    std::cout << "🎥 Continuous capture started: " << (target == Target::Window ? "window " : "screen ")
+              << static_cast<long>(id) << " at " << fps_.load() << " FPS" << std::endl;
+    return true;
+}
+
+void ContinuousCapture::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.load() && !thread_.joinable()) {
+            return;
+        }
+        running_ = false;
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ring_->notify_all();
+
+    std::cout << "🎥 Continuous capture stopped (" << ring_->frames_written() << " frames, "
+              << ring_->frames_dropped() << " dropped)" << std::endl;
+}
+
+bool ContinuousCapture::is_capturing(Target target, unsigned long id) const {
+    return running_.load() && target_ == target && target_id_ == id;
+}
+
+void ContinuousCapture::set_fps(double fps) {
+    fps_ = std::clamp(fps, 0.1, 60.0);
+}
+
+void ContinuousCapture::set_frame_callback(FrameCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = std::move(callback);
+}
+
+void ContinuousCapture::set_capture_settings(const CaptureSettings& settings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+}
+
+void ContinuousCapture::run() {
+    // Xlib connections are not shared between threads: this thread gets its own
+    X11ScreenCapturer capturer;
+    capturer.set_log_captures(false);
+
+    X11ScreenCapturer::WindowInfo window{};
+    if (target_ == Target::Window && !capturer.get_window_info(target_id_, window)) {
+        std::cerr << "❌ Continuous capture: window " << target_id_ << " not found" << std::endl;
+        running_ = false;
+        return;
+    }
+
+    auto next_frame = std::chrono::steady_clock::now();
+    while (running_.load()) {
+        CaptureSettings settings;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            settings = settings_;
+        }
+        capturer.apply_capture_settings(settings);
+
+        // Pick up moves and resizes of the window before each frame
+        if (target_ == Target::Window && !capturer.get_window_info(target_id_, window)) {
+            std::cerr << "❌ Continuous capture: window " << target_id_ << " is gone" << std::endl;
+            running_ = false;
+            break;
+        }
+
+        XImage* image = (target_ == Target::Window)
+            ? capturer.capture_window_image(window)
+            : capturer.capture_screen_image(static_cast<int>(target_id_));
+
+        if (image) {
+            uint64_t sequence = ring_->write([image](RawImage& raw) {
+                return X11ScreenCapturer::to_raw_image(image, raw);
+            });
+            capturer.release_image(image);
+
+            if (sequence) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (callback_) {
+                    callback_(sequence);
+                }
+            }
+        }
+
+        // Fixed-rate schedule; if a frame took too long, skip ahead instead
+        // of trying to catch up
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps_.load()));
+        next_frame += interval;
+        auto now = std::chrono::steady_clock::now();
+        if (next_frame < now) {
+            next_frame = now;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_cv_.wait_until(lock, next_frame, [this]() { return !running_.load(); });
+    }
+}
@@ -0,0 +1,133 @@
+#include "../../include/FrameRing.h"
+
+FrameRing::FrameRing(size_t capacity, int width, int height) :
+    next_slot_(0),
+    latest_sequence_(0),
+    frames_written_(0),
+    frames_dropped_(0) {
+
+    if (capacity == 0) {
+        capacity = 1;
+    }
+    slots_.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        auto slot = std::make_unique<Slot>();
+        if (width > 0 && height > 0) {
+            slot->frame.image.resize(width, height);
+        }
+        slots_.push_back(std::move(slot));
+    }
+}
+
+void FrameRing::preallocate(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    for (auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        RawImage& image = slot->frame.image;
+        if (image.width != width || image.height != height) {
+            slot->frame.sequence = 0;
+            image.resize(width, height);
+        }
+    }
+}
+
+uint64_t FrameRing::write(const FillFunction& fill) {
+    // Take the oldest slot no consumer is reading from
+    for (size_t attempt = 0; attempt < slots_.size(); ++attempt) {
+        Slot& slot = *slots_[next_slot_];
+        next_slot_ = (next_slot_ + 1) % slots_.size();
+
+        std::unique_lock<std::mutex> lock(slot.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            continue;
+        }
+
+        // Invalidate the slot while it is being filled
+        slot.frame.sequence = 0;
+        if (!fill(slot.frame.image)) {
+            return 0;
+        }
+
+        uint64_t sequence = latest_sequence_.load(std::memory_order_relaxed) + 1;
+        slot.frame.sequence = sequence;
+        slot.frame.timestamp = std::chrono::steady_clock::now();
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> wait_lock(wait_mutex_);
+            latest_sequence_.store(sequence, std::memory_order_release);
+        }
+        frames_written_.fetch_add(1, std::memory_order_relaxed);
+        wait_cv_.notify_all();
+        return sequence;
+    }
+
+    // Every slot is being read, drop this frame rather than wait
+    frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+bool FrameRing::read_latest(Frame& frame, uint64_t after_sequence) const {
+    uint64_t latest = latest_sequence();
+    if (latest == 0 || latest <= after_sequence) {
+        return false;
+    }
+
+    // The newest frame may be overwritten while we look for it; fall back
+    // to whatever is newest among the remaining slots
+    const Slot* best = nullptr;
+    uint64_t best_sequence = after_sequence;
+    for (const auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->frame.sequence > best_sequence) {
+            best_sequence = slot->frame.sequence;
+            best = slot.get();
+        }
+    }
+    if (!best) {
+        return false;
+    }
+
+    // If the slot was overwritten in between it holds an even newer frame,
+    // or nothing if that write was discarded
+    std::lock_guard<std::mutex> lock(best->mutex);
+    if (best->frame.sequence <= after_sequence) {
+        return false;
+    }
+    copy_frame(best->frame, frame);
+    return true;
+}
+
+bool FrameRing::read(uint64_t sequence, Frame& frame) const {
+    if (sequence == 0) {
+        return false;
+    }
+    for (const auto& slot : slots_) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->frame.sequence == sequence) {
+            copy_frame(slot->frame, frame);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameRing::wait_for_frame(uint64_t after_sequence, std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    return wait_cv_.wait_for(lock, timeout, [this, after_sequence]() {
+        return latest_sequence_.load(std::memory_order_acquire) > after_sequence;
+    });
+}
+
+void FrameRing::notify_all() const {
+    // Take the lock so a consumer between its check and wait is not missed
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cv_.notify_all();
+}
+
+void FrameRing::copy_frame(const Frame& from, Frame& to) {
+    // Copy assignment keeps the destination's pixel allocation when it fits
+    to = from;
+}
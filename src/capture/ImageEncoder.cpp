@@ -0,0 +1,176 @@
+#include "../../include/ImageEncoder.h"
+#include "../../include/ImageFormat.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#ifdef HAVE_WEBP
+#include <webp/encode.h>
+#endif
+
+namespace {
+
+// libjpeg reports fatal errors through error_exit, which must not return
+struct JpegErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegErrorManager* manager = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    std::cerr << "❌ JPEG encoding failed: " << message << std::endl;
+    longjmp(manager->jump, 1);
+}
+
+} // namespace
+
+ImageEncoder::ImageEncoder() : format_("png"), quality_(85) {
+}
+
+bool ImageEncoder::set_format(const std::string& format) {
+    std::string name = ImageFormat::normalize(format);
+    if (!is_format_available(name)) {
+        std::cerr << "⚠️ Image format not available: " << format << std::endl;
+        return false;
+    }
+    format_ = name;
+    return true;
+}
+
+void ImageEncoder::set_quality(int quality) {
+    quality_ = std::clamp(quality, 1, 100);
+}
+
+bool ImageEncoder::is_format_available(const std::string& format) {
+    std::string name = ImageFormat::normalize(format);
+#ifdef HAVE_WEBP
+    return name == "png" || name == "jpeg" || name == "webp";
+#else
+    return name == "png" || name == "jpeg";
+#endif
+}
+
+bool ImageEncoder::encode(const RawImage& raw, EncodedImage& encoded) const {
+    return encode(raw, format_, encoded);
+}
+
+bool ImageEncoder::encode(const RawImage& raw, const std::string& format, EncodedImage& encoded) const {
+    if (raw.empty()) {
+        std::cerr << "❌ No image to encode" << std::endl;
+        return false;
+    }
+
+    std::string name = ImageFormat::normalize(format);
+    bool result;
+    if (name == "jpeg") {
+        result = encode_jpeg(raw, encoded);
+    } else if (name == "webp") {
+        result = encode_webp(raw, encoded);
+    } else {
+        result = png_encoder_.encode(raw, encoded);
+    }
+
+    if (!result) {
+        encoded.data.clear();
+    }
+    return result;
+}
+
+bool ImageEncoder::encode_jpeg(const RawImage& raw, EncodedImage& encoded) const {
+    jpeg_compress_struct cinfo;
+    JpegErrorManager error_manager;
+    cinfo.err = jpeg_std_error(&error_manager.base);
+    error_manager.base.error_exit = jpeg_error_exit;
+
+    // Declared before setjmp and only written by libjpeg through their
+    // address, so they are still valid after a longjmp
+    struct {
+        unsigned char* data = nullptr;
+        unsigned long size = 0;
+    } output;
+    std::vector<unsigned char> rgb_row;
+
+    if (setjmp(error_manager.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        free(output.data);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &output.data, &output.size);
+
+    cinfo.image_width = raw.width;
+    cinfo.image_height = raw.height;
+#if defined(JCS_EXTENSIONS) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // ARGB32 words are B, G, R, X bytes in memory: libjpeg-turbo reads them directly
+    cinfo.input_components = 4;
+    cinfo.in_color_space = JCS_EXT_BGRX;
+    const bool convert_rows = false;
+#else
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    const bool convert_rows = true;
+    rgb_row.resize(static_cast<size_t>(raw.width) * 3);
+#endif
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality_, TRUE);
+    cinfo.dct_method = JDCT_ISLOW;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const unsigned char* src = raw.row(cinfo.next_scanline);
+        JSAMPROW row;
+        if (convert_rows) {
+            const uint32_t* pixels = reinterpret_cast<const uint32_t*>(src);
+            for (int x = 0; x < raw.width; ++x) {
+                rgb_row[x * 3] = static_cast<unsigned char>(pixels[x] >> 16);
+                rgb_row[x * 3 + 1] = static_cast<unsigned char>(pixels[x] >> 8);
+                rgb_row[x * 3 + 2] = static_cast<unsigned char>(pixels[x]);
+            }
+            row = rgb_row.data();
+        } else {
+            row = const_cast<JSAMPROW>(src);
+        }
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    encoded.data.assign(output.data, output.data + output.size);
+    free(output.data);
+    encoded.format = "jpeg";
+    encoded.width = raw.width;
+    encoded.height = raw.height;
+    return true;
+}
+
+bool ImageEncoder::encode_webp(const RawImage& raw, EncodedImage& encoded) const {
+#ifdef HAVE_WEBP
+    uint8_t* output = nullptr;
+    // WebPEncodeBGRA expects B, G, R, A bytes, which is ARGB32 on little-endian hosts
+    size_t size = WebPEncodeBGRA(raw.pixels.data(), raw.width, raw.height, raw.stride,
+                                 static_cast<float>(quality_), &output);
+    if (size == 0 || !output) {
+        std::cerr << "❌ WebP encoding failed" << std::endl;
+        return false;
+    }
+
+    encoded.data.assign(output, output + size);
+    WebPFree(output);
+    encoded.format = "webp";
+    encoded.width = raw.width;
+    encoded.height = raw.height;
+    return true;
+#else
+    (void)raw;
+    (void)encoded;
+    std::cerr << "❌ WebP support was not compiled in" << std::endl;
+    return false;
+#endif
+}
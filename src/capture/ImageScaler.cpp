@@ -0,0 +1,355 @@
+#include "../../include/ImageScaler.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_SCALER_X86 1
+#endif
+
+namespace {
+
+constexpr uint32_t kOpaque = 0xFF000000u;
+constexpr int kPrecisionBits = 14;
+constexpr int kOne = 1 << kPrecisionBits;
+constexpr int kRound = 1 << (kPrecisionBits - 1);
+
+// Weights of the source pixels behind each output pixel along one axis.
+// Every output pixel reads `span` consecutive source pixels from `first`;
+// `taps` is the span rounded up to an even count for the pairwise kernels.
+struct Coefficients {
+    int src_size = 0;
+    int dst_size = 0;
+    ImageScaler::Filter filter = ImageScaler::Filter::Area;
+    int taps = 0;
+    int span = 0;
+    std::vector<int> first;
+    std::vector<int16_t> weights;  // taps per output pixel, summing to kOne
+};
+
+double lanczos3(double x) {
+    x = std::fabs(x);
+    if (x < 1e-9) {
+        return 1.0;
+    }
+    if (x >= 3.0) {
+        return 0.0;
+    }
+    double px = M_PI * x;
+    return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+}
+
+void make_coefficients(Coefficients& c, int src_size, int dst_size, ImageScaler::Filter filter) {
+    c.src_size = src_size;
+    c.dst_size = dst_size;
+    c.filter = filter;
+
+    const double scale = static_cast<double>(src_size) / dst_size;
+    const double filter_scale = std::max(scale, 1.0);
+    const double support = (filter == ImageScaler::Filter::Area) ? 0.5 * filter_scale : 3.0 * filter_scale;
+
+    // Source range and floating point weights per output pixel
+    std::vector<int> lo(dst_size), hi(dst_size);
+    int max_count = 1;
+    for (int x = 0; x < dst_size; ++x) {
+        double center = (x + 0.5) * scale;
+        lo[x] = std::max(0, static_cast<int>(std::floor(center - support)));
+        hi[x] = std::min(src_size, static_cast<int>(std::ceil(center + support)));
+        max_count = std::max(max_count, hi[x] - lo[x]);
+    }
+
+    c.taps = max_count + (max_count & 1);
+    c.span = std::min(c.taps, src_size);
+    c.first.assign(dst_size, 0);
+    c.weights.assign(static_cast<size_t>(dst_size) * c.taps, 0);
+
+    std::vector<double> values;
+    for (int x = 0; x < dst_size; ++x) {
+        double center = (x + 0.5) * scale;
+        values.assign(hi[x] - lo[x], 0.0);
+        double sum = 0.0;
+        for (int i = lo[x]; i < hi[x]; ++i) {
+            double w;
+            if (filter == ImageScaler::Filter::Area) {
+                // Overlap of the source pixel with the output pixel's footprint
+                double left = std::max(static_cast<double>(i), center - support);
+                double right = std::min(static_cast<double>(i + 1), center + support);
+                w = std::max(0.0, right - left);
+            } else {
+                w = lanczos3((i + 0.5 - center) / filter_scale);
+            }
+            values[i - lo[x]] = w;
+            sum += w;
+        }
+        if (sum == 0.0) {
+            values.assign(values.size(), 0.0);
+            values[0] = sum = 1.0;
+        }
+
+        // The window is shifted left at the right edge so reads stay in the image
+        int first = std::min(lo[x], src_size - c.span);
+        c.first[x] = first;
+
+        int16_t* k = &c.weights[static_cast<size_t>(x) * c.taps];
+        int total = 0;
+        int largest = lo[x] - first;
+        for (int i = lo[x]; i < hi[x]; ++i) {
+            int value = static_cast<int>(std::lround(values[i - lo[x]] / sum * kOne));
+            k[i - first] = static_cast<int16_t>(value);
+            total += value;
+            if (value > k[largest]) {
+                largest = i - first;
+            }
+        }
+        // Rounding must not change the overall brightness
+        k[largest] = static_cast<int16_t>(k[largest] + kOne - total);
+    }
+}
+
+// Tables are reused while the source and target sizes stay the same
+const Coefficients& cached_coefficients(Coefficients& cache, int src_size, int dst_size,
+                                        ImageScaler::Filter filter) {
+    if (cache.src_size != src_size || cache.dst_size != dst_size || cache.filter != filter ||
+        cache.first.empty()) {
+        make_coefficients(cache, src_size, dst_size, filter);
+    }
+    return cache;
+}
+
+inline uint8_t clamp_channel(int value) {
+    value = (value + kRound) >> kPrecisionBits;
+    return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+// ===== Scalar kernels =====
+
+void horizontal_scalar(const unsigned char* src, unsigned char* dst, const Coefficients& c) {
+    for (int x = 0; x < c.dst_size; ++x) {
+        const int16_t* k = &c.weights[static_cast<size_t>(x) * c.taps];
+        const unsigned char* p = src + static_cast<size_t>(c.first[x]) * 4;
+        int sum[3] = {0, 0, 0};
+        for (int t = 0; t < c.span; ++t) {
+            sum[0] += p[t * 4] * k[t];
+            sum[1] += p[t * 4 + 1] * k[t];
+            sum[2] += p[t * 4 + 2] * k[t];
+        }
+        uint32_t out = kOpaque | (static_cast<uint32_t>(clamp_channel(sum[2])) << 16) |
+                       (static_cast<uint32_t>(clamp_channel(sum[1])) << 8) | clamp_channel(sum[0]);
+        std::memcpy(dst + x * 4, &out, sizeof(out));
+    }
+}
+
+void vertical_scalar(const RawImage& src, unsigned char* dst, const int16_t* k, int first,
+                     int span, int begin, int bytes) {
+    for (int i = begin; i < bytes; i += 4) {
+        int sum[3] = {0, 0, 0};
+        for (int t = 0; t < span; ++t) {
+            const unsigned char* p = src.row(first + t) + i;
+            sum[0] += p[0] * k[t];
+            sum[1] += p[1] * k[t];
+            sum[2] += p[2] * k[t];
+        }
+        uint32_t out = kOpaque | (static_cast<uint32_t>(clamp_channel(sum[2])) << 16) |
+                       (static_cast<uint32_t>(clamp_channel(sum[1])) << 8) | clamp_channel(sum[0]);
+        std::memcpy(dst + i, &out, sizeof(out));
+    }
+}
+
+#ifdef IMAGE_SCALER_X86
+
+// Two 16-bit weights in one 32-bit lane, as _mm*_madd_epi16 pairs them
+inline int weight_pair(int16_t a, int16_t b) {
+    return static_cast<int>(static_cast<uint16_t>(a) | (static_cast<uint32_t>(static_cast<uint16_t>(b)) << 16));
+}
+
+// ===== AVX2 kernels =====
+
+__attribute__((target("avx2")))
+void horizontal_avx2(const unsigned char* src, unsigned char* dst, const Coefficients& c) {
+    // Interleave the channels of neighbouring pixels: b0 b1 g0 g1 r0 r1 a0 a1 ...
+    const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+    const __m128i round = _mm_set1_epi32(kRound);
+    for (int x = 0; x < c.dst_size; ++x) {
+        const int16_t* k = &c.weights[static_cast<size_t>(x) * c.taps];
+        const unsigned char* p = src + static_cast<size_t>(c.first[x]) * 4;
+        __m256i acc = _mm256_setzero_si256();
+        int t = 0;
+        for (; t + 4 <= c.taps; t += 4) {
+            __m128i pixels = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + t * 4)),
+                                              interleave);
+            __m256i weights = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_set1_epi32(weight_pair(k[t], k[t + 1]))),
+                _mm_set1_epi32(weight_pair(k[t + 2], k[t + 3])), 1);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_cvtepu8_epi16(pixels), weights));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        if (t < c.taps) {
+            // Last pair of taps
+            __m128i pixels = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + t * 4)),
+                                              interleave);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_cvtepu8_epi16(pixels),
+                                                    _mm_set1_epi32(weight_pair(k[t], k[t + 1]))));
+        }
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, round), kPrecisionBits);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum, sum), sum);
+        uint32_t out = static_cast<uint32_t>(_mm_cvtsi128_si32(packed)) | kOpaque;
+        std::memcpy(dst + x * 4, &out, sizeof(out));
+    }
+}
+
+__attribute__((target("avx2")))
+void vertical_avx2(const RawImage& src, unsigned char* dst, const int16_t* k, int first,
+                   int taps, int bytes) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(kRound);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kOpaque));
+    int i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+        for (int t = 0; t < taps; t += 2) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src.row(first + t) + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src.row(first + t + 1) + i));
+            __m256i weights = _mm256_set1_epi32(weight_pair(k[t], k[t + 1]));
+            // Pair each byte with the same byte of the next row
+            __m256i lo = _mm256_unpacklo_epi8(a, b);
+            __m256i hi = _mm256_unpackhi_epi8(a, b);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), weights));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), weights));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), weights));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), weights));
+        }
+        // Packing undoes the unpacking order within each lane
+        __m256i low = _mm256_packs_epi32(_mm256_srai_epi32(acc0, kPrecisionBits),
+                                         _mm256_srai_epi32(acc1, kPrecisionBits));
+        __m256i high = _mm256_packs_epi32(_mm256_srai_epi32(acc2, kPrecisionBits),
+                                          _mm256_srai_epi32(acc3, kPrecisionBits));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_or_si256(_mm256_packus_epi16(low, high), alpha));
+    }
+    vertical_scalar(src, dst, k, first, taps, i, bytes);
+}
+
+#endif // IMAGE_SCALER_X86
+
+std::atomic<bool> simd_enabled{true};
+
+bool has_avx2() {
+#ifdef IMAGE_SCALER_X86
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported && simd_enabled.load();
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+bool ImageScaler::fit_size(int width, int height, const Limits& limits,
+                           int& fitted_width, int& fitted_height) {
+    fitted_width = width;
+    fitted_height = height;
+    if (width <= 0 || height <= 0 || !limits.is_limited()) {
+        return false;
+    }
+
+    double factor = 1.0;
+    int long_edge = std::max(width, height);
+    if (limits.max_long_edge > 0 && long_edge > limits.max_long_edge) {
+        factor = std::min(factor, static_cast<double>(limits.max_long_edge) / long_edge);
+    }
+    double pixels = static_cast<double>(width) * height;
+    double max_pixels = limits.max_megapixels * 1e6;
+    if (limits.max_megapixels > 0.0 && pixels > max_pixels) {
+        factor = std::min(factor, std::sqrt(max_pixels / pixels));
+    }
+    if (factor >= 1.0) {
+        return false;
+    }
+
+    // Round down so the result stays within the limits
+    fitted_width = std::max(1, static_cast<int>(width * factor + 1e-6));
+    fitted_height = std::max(1, static_cast<int>(height * factor + 1e-6));
+    return fitted_width < width || fitted_height < height;
+}
+
+bool ImageScaler::scale(const RawImage& src, RawImage& dst, int width, int height, Filter filter) {
+    if (src.empty() || src.width <= 0 || src.height <= 0 || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    static thread_local Coefficients horizontal_cache;
+    static thread_local Coefficients vertical_cache;
+    const Coefficients& horizontal = cached_coefficients(horizontal_cache, src.width, width, filter);
+    const Coefficients& vertical = cached_coefficients(vertical_cache, src.height, height, filter);
+
+#ifdef IMAGE_SCALER_X86
+    // The SIMD kernels read whole tap windows, which needs at least that many pixels
+    const bool horizontal_simd = has_avx2() && horizontal.span == horizontal.taps;
+    const bool vertical_simd = has_avx2() && vertical.span == vertical.taps;
+#endif
+
+    // Horizontal pass into an intermediate image of the target width
+    static thread_local RawImage intermediate;
+    intermediate.resize(width, src.height);
+    for (int y = 0; y < src.height; ++y) {
+#ifdef IMAGE_SCALER_X86
+        if (horizontal_simd) {
+            horizontal_avx2(src.row(y), intermediate.row(y), horizontal);
+            continue;
+        }
+#endif
+        horizontal_scalar(src.row(y), intermediate.row(y), horizontal);
+    }
+
+    dst.resize(width, height);
+    for (int y = 0; y < height; ++y) {
+        const int16_t* k = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+#ifdef IMAGE_SCALER_X86
+        if (vertical_simd) {
+            vertical_avx2(intermediate, dst.row(y), k, vertical.first[y], vertical.taps, dst.stride);
+            continue;
+        }
+#endif
+        vertical_scalar(intermediate, dst.row(y), k, vertical.first[y], vertical.span, 0, dst.stride);
+    }
+    return true;
+}
+
+bool ImageScaler::scale_to_fit(const RawImage& src, RawImage& dst, const Limits& limits, Filter filter) {
+    int width = 0, height = 0;
+    if (!fit_size(src.width, src.height, limits, width, height)) {
+        return false;
+    }
+    return scale(src, dst, width, height, filter);
+}
+
+const char* ImageScaler::filter_name(Filter filter) {
+    return filter == Filter::Lanczos ? "lanczos" : "area";
+}
+
+bool ImageScaler::parse_filter(const std::string& name, Filter& filter) {
+    if (name == "area") {
+        filter = Filter::Area;
+        return true;
+    }
+    if (name == "lanczos") {
+        filter = Filter::Lanczos;
+        return true;
+    }
+    return false;
+}
+
+const char* ImageScaler::kernel_name() {
+    return has_avx2() ? "avx2" : "scalar";
+}
+
+void ImageScaler::set_simd_enabled(bool enabled) {
+    simd_enabled = enabled;
+}
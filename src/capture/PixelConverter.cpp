@@ -0,0 +1,453 @@
+#include "../../include/PixelConverter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_CONVERTER_X86 1
+#endif
+
+namespace {
+
+constexpr uint32_t kOpaque = 0xFF000000u;
+
+inline uint32_t load_u32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint16_t load_u16(const unsigned char* p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline int host_byte_order() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1 ? LSBFirst : MSBFirst;
+}
+
+// ===== Scalar kernels =====
+// Pixel layouts are named by channel order from the most significant byte
+
+inline uint32_t xbgr_to_argb(uint32_t p) {
+    return kOpaque | (p & 0x0000FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+}
+
+inline uint32_t rgb30_to_argb(uint32_t p) {
+    // Keep the top 8 of each 10-bit channel
+    return kOpaque | ((p >> 6) & 0x00FF0000u) | ((p >> 4) & 0x0000FF00u) | ((p >> 2) & 0xFFu);
+}
+
+inline uint32_t rgb565_to_argb(uint32_t p) {
+    // Expand 5/6-bit channels by bit replication
+    return kOpaque |
+           ((p & 0xF800u) << 8) | ((p & 0xE000u) << 3) |
+           ((p & 0x07E0u) << 5) | ((p & 0x0600u) >> 1) |
+           ((p & 0x001Fu) << 3) | ((p & 0x001Cu) >> 2);
+}
+
+void xrgb32_scalar(const unsigned char* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = load_u32(src + x * 4) | kOpaque;
+    }
+}
+
+void xbgr32_scalar(const unsigned char* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = xbgr_to_argb(load_u32(src + x * 4));
+    }
+}
+
+void rgb30_scalar(const unsigned char* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = rgb30_to_argb(load_u32(src + x * 4));
+    }
+}
+
+void rgb565_scalar(const unsigned char* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = rgb565_to_argb(load_u16(src + x * 2));
+    }
+}
+
+void rgb24_scalar(const unsigned char* src, uint32_t* dst, int width) {
+    // Packed 3-byte pixels, blue in the lowest byte
+    for (int x = 0; x < width; x++) {
+        const unsigned char* p = src + x * 3;
+        dst[x] = kOpaque | (static_cast<uint32_t>(p[2]) << 16) |
+                 (static_cast<uint32_t>(p[1]) << 8) | p[0];
+    }
+}
+
+#ifdef PIXEL_CONVERTER_X86
+
+// ===== SSE2 kernels =====
+
+__attribute__((target("sse2")))
+void xrgb32_sse2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(kOpaque));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(p, alpha));
+    }
+    xrgb32_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("sse2")))
+void xbgr32_sse2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(kOpaque));
+    const __m128i green = _mm_set1_epi32(0x0000FF00);
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), low);
+        __m128i b = _mm_slli_epi32(_mm_and_si128(p, low), 16);
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_and_si128(p, green), alpha), _mm_or_si128(r, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), out);
+    }
+    xbgr32_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("sse2")))
+void rgb30_sse2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(kOpaque));
+    const __m128i rmask = _mm_set1_epi32(0x00FF0000);
+    const __m128i gmask = _mm_set1_epi32(0x0000FF00);
+    const __m128i bmask = _mm_set1_epi32(0x000000FF);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 6), rmask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 4), gmask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(p, 2), bmask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                         _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, alpha)));
+    }
+    rgb30_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("sse2")))
+inline __m128i rgb565_expand_sse2(__m128i p) {
+    // p holds four 16-bit pixels zero-extended to 32 bits
+    __m128i r = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xF800)), 8),
+                             _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xE000)), 3));
+    __m128i g = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x07E0)), 5),
+                             _mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x0600)), 1));
+    __m128i b = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x001F)), 3),
+                             _mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x001C)), 2));
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(static_cast<int>(kOpaque))));
+}
+
+__attribute__((target("sse2")))
+void rgb565_sse2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), rgb565_expand_sse2(_mm_unpacklo_epi16(p, zero)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 4), rgb565_expand_sse2(_mm_unpackhi_epi16(p, zero)));
+    }
+    rgb565_scalar(src + x * 2, dst + x, width - x);
+}
+
+// ===== AVX2 kernels =====
+
+__attribute__((target("avx2")))
+void xrgb32_avx2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kOpaque));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_or_si256(p, alpha));
+    }
+    xrgb32_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("avx2")))
+void xbgr32_avx2(const unsigned char* src, uint32_t* dst, int width) {
+    // Swap red and blue bytes within each pixel
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kOpaque));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), alpha));
+    }
+    xbgr32_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("avx2")))
+void rgb30_avx2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kOpaque));
+    const __m256i rmask = _mm256_set1_epi32(0x00FF0000);
+    const __m256i gmask = _mm256_set1_epi32(0x0000FF00);
+    const __m256i bmask = _mm256_set1_epi32(0x000000FF);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 6), rmask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 4), gmask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 2), bmask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha)));
+    }
+    rgb30_scalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("avx2")))
+void rgb565_avx2(const unsigned char* src, uint32_t* dst, int width) {
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(kOpaque));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2)));
+        __m256i r = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0xF800)), 8),
+                                    _mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0xE000)), 3));
+        __m256i g = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0x07E0)), 5),
+                                    _mm256_srli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0x0600)), 1));
+        __m256i b = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0x001F)), 3),
+                                    _mm256_srli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0x001C)), 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha)));
+    }
+    rgb565_scalar(src + x * 2, dst + x, width - x);
+}
+
+#endif // PIXEL_CONVERTER_X86
+
+std::atomic<PixelConverter::Simd> max_simd{PixelConverter::Simd::AVX2};
+
+} // namespace
+
+PixelConverter::Simd PixelConverter::detected_simd() {
+#ifdef PIXEL_CONVERTER_X86
+    static const Simd level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Simd::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return Simd::SSE2;
+        }
+        return Simd::Scalar;
+    }();
+    return level;
+#else
+    return Simd::Scalar;
+#endif
+}
+
+void PixelConverter::set_max_simd(Simd simd) {
+    max_simd = simd;
+}
+
+PixelConverter::PixelConverter(const XImage* image) :
+    valid_(false),
+    kernel_(nullptr),
+    kernel_name_("none"),
+    bits_per_pixel_(0),
+    swap_bytes_(false) {
+    if (image && image->format == ZPixmap && image->data) {
+        select_kernel(image);
+    }
+}
+
+PixelConverter::Channel PixelConverter::make_channel(unsigned long mask) {
+    Channel channel;
+    channel.mask = mask;
+    if (mask == 0) {
+        return channel;
+    }
+    while (!((mask >> channel.shift) & 1)) {
+        channel.shift++;
+    }
+    while ((mask >> (channel.shift + channel.bits)) & 1) {
+        channel.bits++;
+    }
+    return channel;
+}
+
+uint32_t PixelConverter::expand_channel(unsigned long pixel, const Channel& channel) {
+    if (channel.bits == 0) {
+        return 0;
+    }
+    uint32_t value = static_cast<uint32_t>((pixel & channel.mask) >> channel.shift);
+    if (channel.bits >= 8) {
+        return value >> (channel.bits - 8);
+    }
+
+    // Replicate the high bits into the low bits so full intensity maps to 0xFF
+    uint32_t result = 0;
+    int pos = 8 - channel.bits;
+    result = value << pos;
+    while (pos > 0) {
+        pos -= channel.bits;
+        result |= pos >= 0 ? value << pos : value >> -pos;
+    }
+    return result & 0xFF;
+}
+
+uint32_t PixelConverter::pixel_to_argb(unsigned long pixel) const {
+    return kOpaque | (expand_channel(pixel, red_) << 16) |
+           (expand_channel(pixel, green_) << 8) | expand_channel(pixel, blue_);
+}
+
+void PixelConverter::select_kernel(const XImage* image) {
+    bits_per_pixel_ = image->bits_per_pixel;
+    swap_bytes_ = image->byte_order != host_byte_order();
+
+    unsigned long red_mask = image->red_mask;
+    unsigned long green_mask = image->green_mask;
+    unsigned long blue_mask = image->blue_mask;
+
+    // XGetImage on a pixmap has no visual, so the masks are empty;
+    // assume the usual TrueColor layout for the depth
+    if (red_mask == 0 && green_mask == 0 && blue_mask == 0) {
+        switch (image->depth) {
+            case 24:
+            case 32:
+                red_mask = 0xFF0000; green_mask = 0x00FF00; blue_mask = 0x0000FF;
+                break;
+            case 30:
+                red_mask = 0x3FF00000; green_mask = 0x000FFC00; blue_mask = 0x000003FF;
+                break;
+            case 16:
+                red_mask = 0xF800; green_mask = 0x07E0; blue_mask = 0x001F;
+                break;
+            case 15:
+                red_mask = 0x7C00; green_mask = 0x03E0; blue_mask = 0x001F;
+                break;
+            default:
+                return; // Palette visuals are not supported
+        }
+    }
+
+    red_ = make_channel(red_mask);
+    green_ = make_channel(green_mask);
+    blue_ = make_channel(blue_mask);
+    valid_ = true;
+    kernel_name_ = "generic";
+
+    // Fast paths need native byte order
+    if (swap_bytes_) {
+        return;
+    }
+
+    const Simd simd = std::min(detected_simd(), max_simd.load());
+    auto pick = [&](RowKernel scalar, RowKernel sse2, RowKernel avx2, const char* name) {
+        kernel_ = scalar;
+        kernel_name_ = name;
+#ifdef PIXEL_CONVERTER_X86
+        if (simd == Simd::AVX2 && avx2) {
+            kernel_ = avx2;
+        } else if (simd >= Simd::SSE2 && sse2) {
+            kernel_ = sse2;
+        }
+#else
+        (void)sse2;
+        (void)avx2;
+        (void)simd;
+#endif
+    };
+
+#ifdef PIXEL_CONVERTER_X86
+#define PIXEL_KERNELS(name) name##_scalar, name##_sse2, name##_avx2
+#else
+#define PIXEL_KERNELS(name) name##_scalar, nullptr, nullptr
+#endif
+
+    if (bits_per_pixel_ == 32 && red_mask == 0xFF0000 && green_mask == 0x00FF00 && blue_mask == 0x0000FF) {
+        pick(PIXEL_KERNELS(xrgb32), "xrgb32");
+    } else if (bits_per_pixel_ == 32 && red_mask == 0x0000FF && green_mask == 0x00FF00 && blue_mask == 0xFF0000) {
+        pick(PIXEL_KERNELS(xbgr32), "xbgr32");
+    } else if (bits_per_pixel_ == 32 && red_mask == 0x3FF00000 && green_mask == 0x000FFC00 && blue_mask == 0x000003FF) {
+        pick(PIXEL_KERNELS(rgb30), "rgb30");
+    } else if (bits_per_pixel_ == 16 && red_mask == 0xF800 && green_mask == 0x07E0 && blue_mask == 0x001F) {
+        pick(PIXEL_KERNELS(rgb565), "rgb565");
+    } else if (bits_per_pixel_ == 24 && red_mask == 0xFF0000 && green_mask == 0x00FF00 && blue_mask == 0x0000FF &&
+               host_byte_order() == LSBFirst) {
+        // Reads bytes rather than a native word, so it only fits LSB-first data
+        pick(rgb24_scalar, nullptr, nullptr, "rgb24");
+    }
+
+#undef PIXEL_KERNELS
+}
+
+void PixelConverter::convert_row_generic(const XImage* image, int row, uint32_t* dst) const {
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(image->data) +
+                               static_cast<size_t>(row) * image->bytes_per_line;
+    const bool msb_first = image->byte_order == MSBFirst;
+
+    for (int x = 0; x < image->width; x++) {
+        unsigned long pixel = 0;
+        switch (bits_per_pixel_) {
+            case 32: {
+                const unsigned char* p = src + x * 4;
+                pixel = msb_first
+                    ? (static_cast<unsigned long>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+                    : (static_cast<unsigned long>(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+                break;
+            }
+            case 24: {
+                const unsigned char* p = src + x * 3;
+                pixel = msb_first ? (p[0] << 16) | (p[1] << 8) | p[2]
+                                  : (p[2] << 16) | (p[1] << 8) | p[0];
+                break;
+            }
+            case 16: {
+                const unsigned char* p = src + x * 2;
+                pixel = msb_first ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+                break;
+            }
+            case 8:
+                pixel = src[x];
+                break;
+            default:
+                // Odd layouts, let Xlib decode them
+                pixel = XGetPixel(const_cast<XImage*>(image), x, row);
+                break;
+        }
+        dst[x] = pixel_to_argb(pixel);
+    }
+}
+
+void PixelConverter::convert_rows(const XImage* image, int first_row, int row_count,
+                                  unsigned char* dst, int dst_stride) const {
+    if (!valid_ || !image) {
+        return;
+    }
+
+    for (int y = 0; y < row_count; y++) {
+        int row = first_row + y;
+        uint32_t* out = reinterpret_cast<uint32_t*>(dst + static_cast<size_t>(y) * dst_stride);
+        if (kernel_) {
+            const unsigned char* src = reinterpret_cast<const unsigned char*>(image->data) +
+                                       static_cast<size_t>(row) * image->bytes_per_line;
+            kernel_(src, out, image->width);
+        } else {
+            convert_row_generic(image, row, out);
+        }
+    }
+}
+
+void PixelConverter::convert(const XImage* image, unsigned char* dst, int dst_stride) const {
+    if (image) {
+        convert_rows(image, 0, image->height, dst, dst_stride);
+    }
+}
+
+bool PixelConverter::convert_image(const XImage* image, unsigned char* dst, int dst_stride) {
+    PixelConverter converter(image);
+    if (!converter.is_valid()) {
+        return false;
+    }
+    converter.convert(image, dst, dst_stride);
+    return true;
+}
@@ -0,0 +1,384 @@
+#include "../../include/PngEncoder.h"
+#include "../../include/WorkerPool.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <future>
+#include <zlib.h>
+
+namespace {
+
+// Bands below this many filtered bytes are not worth a task of their own
+const size_t min_band_bytes = 256 * 1024;
+const int min_band_rows = 16;
+
+enum FilterType : unsigned char {
+    FilterNone = 0,
+    FilterSub = 1,
+    FilterUp = 2,
+    FilterAverage = 3,
+    FilterPaeth = 4
+};
+
+// Unpack one ARGB32 row (native-endian 0xAARRGGBB) to RGB bytes
+void argb_to_rgb(const unsigned char* src, unsigned char* dst, int width) {
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(src);
+    for (int x = 0; x < width; ++x) {
+        uint32_t pixel = pixels[x];
+        dst[0] = static_cast<unsigned char>(pixel >> 16);
+        dst[1] = static_cast<unsigned char>(pixel >> 8);
+        dst[2] = static_cast<unsigned char>(pixel);
+        dst += 3;
+    }
+}
+
+inline unsigned char paeth_predictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<unsigned char>(a);
+    if (pb <= pc) return static_cast<unsigned char>(b);
+    return static_cast<unsigned char>(c);
+}
+
+// Apply a filter to one row; out[0] receives the filter type byte
+void filter_row(FilterType type, const unsigned char* row, const unsigned char* prev,
+                size_t length, unsigned char* out) {
+    const size_t bpp = 3;
+    out[0] = type;
+    unsigned char* dst = out + 1;
+    switch (type) {
+        case FilterNone:
+            std::memcpy(dst, row, length);
+            break;
+        case FilterSub:
+            std::memcpy(dst, row, std::min(bpp, length));
+            for (size_t i = bpp; i < length; ++i) {
+                dst[i] = static_cast<unsigned char>(row[i] - row[i - bpp]);
+            }
+            break;
+        case FilterUp:
+            for (size_t i = 0; i < length; ++i) {
+                dst[i] = static_cast<unsigned char>(row[i] - prev[i]);
+            }
+            break;
+        case FilterAverage:
+            for (size_t i = 0; i < length; ++i) {
+                int left = i >= bpp ? row[i - bpp] : 0;
+                dst[i] = static_cast<unsigned char>(row[i] - ((left + prev[i]) >> 1));
+            }
+            break;
+        case FilterPaeth:
+            for (size_t i = 0; i < length; ++i) {
+                int left = i >= bpp ? row[i - bpp] : 0;
+                int upper_left = i >= bpp ? prev[i - bpp] : 0;
+                dst[i] = static_cast<unsigned char>(row[i] - paeth_predictor(left, prev[i], upper_left));
+            }
+            break;
+    }
+}
+
+// Sum of absolute values of the filtered bytes taken as signed, the usual
+// estimate of how well a row will compress; stops once past the best so far
+uint64_t filtered_cost(const unsigned char* filtered, size_t length, uint64_t limit) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < length; ++i) {
+        sum += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<signed char>(filtered[i]))));
+        if (sum >= limit) {
+            break;
+        }
+    }
+    return sum;
+}
+
+void write_u32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+void write_chunk(std::vector<unsigned char>& out, const char* type,
+                 const unsigned char* data, size_t length) {
+    write_u32(out, static_cast<uint32_t>(length));
+    size_t type_pos = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length > 0) {
+        out.insert(out.end(), data, data + length);
+    }
+    uLong crc = crc32(0L, out.data() + type_pos, static_cast<uInt>(4 + length));
+    write_u32(out, static_cast<uint32_t>(crc));
+}
+
+int default_level(PngEncoder::Preset preset) {
+    switch (preset) {
+        case PngEncoder::Preset::Fastest: return 1;
+        case PngEncoder::Preset::Smallest: return 9;
+        case PngEncoder::Preset::Balanced: break;
+    }
+    return 4;
+}
+
+} // namespace
+
+PngEncoder::PngEncoder(Preset preset, WorkerPool* pool) :
+    preset_(preset),
+    level_(default_level(preset)),
+    pool_(pool) {
+}
+
+void PngEncoder::set_preset(Preset preset) {
+    preset_ = preset;
+    level_ = default_level(preset);
+}
+
+void PngEncoder::set_compression_level(int level) {
+    level_ = std::clamp(level, 0, 9);
+}
+
+const char* PngEncoder::preset_name(Preset preset) {
+    switch (preset) {
+        case Preset::Fastest: return "fastest";
+        case Preset::Smallest: return "smallest";
+        case Preset::Balanced: break;
+    }
+    return "balanced";
+}
+
+bool PngEncoder::preset_from_string(const std::string& name, Preset& preset) {
+    if (name == "fastest") {
+        preset = Preset::Fastest;
+    } else if (name == "balanced") {
+        preset = Preset::Balanced;
+    } else if (name == "smallest") {
+        preset = Preset::Smallest;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+WorkerPool& PngEncoder::shared_pool() {
+    static WorkerPool pool(WorkerPool::hardware_threads());
+    return pool;
+}
+
+int PngEncoder::band_count(const RawImage& raw) const {
+    WorkerPool& pool = pool_ ? *pool_ : shared_pool();
+    size_t filtered_size = (static_cast<size_t>(raw.width) * 3 + 1) * raw.height;
+
+    size_t bands = std::min(pool.size(), filtered_size / min_band_bytes);
+    bands = std::min(bands, static_cast<size_t>(raw.height / min_band_rows));
+    return static_cast<int>(std::max<size_t>(bands, 1));
+}
+
+bool PngEncoder::encode(const RawImage& raw, EncodedImage& encoded) const {
+    if (raw.empty() || raw.width <= 0 || raw.height <= 0) {
+        std::cerr << "❌ No image to encode" << std::endl;
+        return false;
+    }
+
+    // Split rows evenly; every band but the last ends with a sync flush
+    int count = band_count(raw);
+    std::vector<Band> bands(count);
+    int rows_per_band = raw.height / count;
+    int extra_rows = raw.height % count;
+    int row = 0;
+    for (int i = 0; i < count; ++i) {
+        bands[i].first_row = row;
+        bands[i].row_count = rows_per_band + (i < extra_rows ? 1 : 0);
+        row += bands[i].row_count;
+    }
+
+    try {
+        if (count == 1) {
+            encode_band(raw, bands[0], true);
+        } else {
+            WorkerPool& pool = pool_ ? *pool_ : shared_pool();
+            std::vector<std::future<void>> pending;
+            pending.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                Band* band = &bands[i];
+                bool last = (i == count - 1);
+                pending.push_back(pool.submit([this, &raw, band, last]() {
+                    encode_band(raw, *band, last);
+                }));
+            }
+            for (auto& future : pending) {
+                future.get();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "❌ PNG encoding failed: " << e.what() << std::endl;
+        return false;
+    }
+
+    size_t compressed_size = 0;
+    for (const auto& band : bands) {
+        if (!band.ok) {
+            std::cerr << "❌ PNG encoding failed: deflate error" << std::endl;
+            return false;
+        }
+        compressed_size += band.data.size();
+    }
+
+    std::vector<unsigned char>& out = encoded.data;
+    out.clear();
+    out.reserve(compressed_size + 64);
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.insert(out.end(), signature, signature + 8);
+
+    // IHDR: 8-bit RGB, no interlacing
+    unsigned char ihdr[13];
+    ihdr[0] = static_cast<unsigned char>(raw.width >> 24);
+    ihdr[1] = static_cast<unsigned char>(raw.width >> 16);
+    ihdr[2] = static_cast<unsigned char>(raw.width >> 8);
+    ihdr[3] = static_cast<unsigned char>(raw.width);
+    ihdr[4] = static_cast<unsigned char>(raw.height >> 24);
+    ihdr[5] = static_cast<unsigned char>(raw.height >> 16);
+    ihdr[6] = static_cast<unsigned char>(raw.height >> 8);
+    ihdr[7] = static_cast<unsigned char>(raw.height);
+    ihdr[8] = 8;   // Bit depth
+    ihdr[9] = 2;   // Color type: RGB
+    ihdr[10] = 0;  // Compression
+    ihdr[11] = 0;  // Filter method
+    ihdr[12] = 0;  // Interlace
+    write_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    // IDAT: zlib header, concatenated bands, Adler-32 of all filtered rows
+    unsigned char zlib_header[2];
+    int flevel = level_ < 2 ? 0 : (level_ < 6 ? 1 : (level_ == 6 ? 2 : 3));
+    zlib_header[0] = 0x78;  // Deflate, 32K window
+    zlib_header[1] = static_cast<unsigned char>(flevel << 6);
+    zlib_header[1] += static_cast<unsigned char>(31 - ((zlib_header[0] * 256 + zlib_header[1]) % 31));
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (const auto& band : bands) {
+        adler = adler32_combine(adler, band.adler, static_cast<z_off_t>(band.filtered_size));
+    }
+    unsigned char zlib_trailer[4] = {
+        static_cast<unsigned char>(adler >> 24), static_cast<unsigned char>(adler >> 16),
+        static_cast<unsigned char>(adler >> 8), static_cast<unsigned char>(adler)
+    };
+
+    write_u32(out, static_cast<uint32_t>(sizeof(zlib_header) + compressed_size + sizeof(zlib_trailer)));
+    size_t type_pos = out.size();
+    out.insert(out.end(), {'I', 'D', 'A', 'T'});
+    out.insert(out.end(), zlib_header, zlib_header + 2);
+    uLong crc = crc32(0L, out.data() + type_pos, 6);
+    for (const auto& band : bands) {
+        out.insert(out.end(), band.data.begin(), band.data.end());
+        crc = crc32_combine(crc, band.crc, static_cast<z_off_t>(band.data.size()));
+    }
+    out.insert(out.end(), zlib_trailer, zlib_trailer + 4);
+    crc = crc32(crc, zlib_trailer, 4);
+    write_u32(out, static_cast<uint32_t>(crc));
+
+    write_chunk(out, "IEND", nullptr, 0);
+
+    encoded.format = "png";
+    encoded.width = raw.width;
+    encoded.height = raw.height;
+    return true;
+}
+
+void PngEncoder::encode_band(const RawImage& raw, Band& band, bool last) const {
+    const size_t row_bytes = static_cast<size_t>(raw.width) * 3;
+    const size_t filtered_row = row_bytes + 1;
+
+    std::vector<unsigned char> prev(row_bytes, 0);
+    std::vector<unsigned char> cur(row_bytes);
+    std::vector<unsigned char> candidate(filtered_row);
+    std::vector<unsigned char> filtered(filtered_row * band.row_count);
+
+    // The Up/Average/Paeth filters of the first row look at the row above,
+    // which belongs to the previous band
+    if (band.first_row > 0) {
+        argb_to_rgb(raw.row(band.first_row - 1), prev.data(), raw.width);
+    }
+
+    static const FilterType balanced_filters[] = {FilterNone, FilterSub, FilterUp};
+    static const FilterType smallest_filters[] = {FilterNone, FilterSub, FilterUp, FilterAverage, FilterPaeth};
+
+    for (int i = 0; i < band.row_count; ++i) {
+        int y = band.first_row + i;
+        argb_to_rgb(raw.row(y), cur.data(), raw.width);
+        unsigned char* out = filtered.data() + filtered_row * i;
+
+        // Screenshots repeat rows a lot (backgrounds, blank areas): Up turns
+        // those into zeros without trying anything else
+        if (y > 0 && std::memcmp(cur.data(), prev.data(), row_bytes) == 0) {
+            out[0] = FilterUp;
+            std::memset(out + 1, 0, row_bytes);
+        } else if (preset_ == Preset::Fastest) {
+            filter_row(FilterSub, cur.data(), prev.data(), row_bytes, out);
+        } else {
+            const FilterType* filters = preset_ == Preset::Smallest ? smallest_filters : balanced_filters;
+            size_t filter_count = preset_ == Preset::Smallest ? 5 : 3;
+
+            uint64_t best_cost = UINT64_MAX;
+            for (size_t f = 0; f < filter_count; ++f) {
+                filter_row(filters[f], cur.data(), prev.data(), row_bytes, candidate.data());
+                uint64_t cost = filtered_cost(candidate.data() + 1, row_bytes, best_cost);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    std::memcpy(out, candidate.data(), filtered_row);
+                    if (cost == 0) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        std::swap(prev, cur);
+    }
+
+    band.filtered_size = filtered.size();
+    band.adler = static_cast<uint32_t>(adler32(adler32(0L, Z_NULL, 0), filtered.data(),
+                                               static_cast<uInt>(filtered.size())));
+
+    // Raw deflate (no zlib wrapper), the header and checksum are written once
+    // for the whole image
+    z_stream stream{};
+    int strategy = preset_ == Preset::Fastest ? Z_RLE : Z_DEFAULT_STRATEGY;
+    if (deflateInit2(&stream, level_, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+        return;
+    }
+
+    band.data.resize(deflateBound(&stream, filtered.size()) + 16);
+    stream.next_in = filtered.data();
+    stream.avail_in = static_cast<uInt>(filtered.size());
+    stream.next_out = band.data.data();
+    stream.avail_out = static_cast<uInt>(band.data.size());
+
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int rc;
+    while (true) {
+        rc = deflate(&stream, flush);
+        if (rc == Z_STREAM_ERROR) {
+            break;
+        }
+        bool done = last ? (rc == Z_STREAM_END) : (stream.avail_in == 0 && stream.avail_out > 0);
+        if (done) {
+            break;
+        }
+        // Out of space, grow the buffer and continue
+        size_t used = band.data.size() - stream.avail_out;
+        band.data.resize(band.data.size() * 2);
+        stream.next_out = band.data.data() + used;
+        stream.avail_out = static_cast<uInt>(band.data.size() - used);
+    }
+
+    band.data.resize(band.data.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    if (rc == Z_STREAM_ERROR) {
+        return;
+    }
+
+    band.crc = static_cast<uint32_t>(crc32(0L, band.data.data(), static_cast<uInt>(band.data.size())));
+    band.ok = true;
+}
@@ -0,0 +1,185 @@
+#include "../../include/ReplayBuffer.h"
+#include "../../include/ImageEncoder.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+ReplayBuffer::ReplayBuffer(size_t byte_budget, double seconds) :
+    ring_(nullptr),
+    running_(false),
+    byte_budget_(byte_budget),
+    duration_(seconds),
+    quality_(70),
+    max_long_edge_(0),
+    max_megapixels_(0.0),
+    scale_filter_(ImageScaler::Filter::Area),
+    bytes_(0) {
+}
+
+ReplayBuffer::~ReplayBuffer() {
+    stop();
+}
+
+bool ReplayBuffer::start(const FrameRing& ring) {
+    if (running_.load()) {
+        return false;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    ring_ = &ring;
+    running_ = true;
+    thread_ = std::thread(&ReplayBuffer::run, this);
+
+    std::cout << "⏪ Replay buffer started (" << duration_.load() << " s, "
+              << (byte_budget_.load() / (1024 * 1024)) << " MB budget)" << std::endl;
+    return true;
+}
+
+void ReplayBuffer::stop() {
+    if (!running_.load() && !thread_.joinable()) {
+        return;
+    }
+    running_ = false;
+    if (ring_) {
+        ring_->notify_all();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ReplayBuffer::set_duration(double seconds) {
+    duration_ = std::max(seconds, 1.0);
+}
+
+void ReplayBuffer::set_byte_budget(size_t bytes) {
+    byte_budget_ = std::max<size_t>(bytes, 1024 * 1024);
+}
+
+void ReplayBuffer::set_quality(int quality) {
+    quality_ = std::clamp(quality, 1, 100);
+}
+
+void ReplayBuffer::set_scale_limits(const ImageScaler::Limits& limits, ImageScaler::Filter filter) {
+    max_long_edge_ = std::max(limits.max_long_edge, 0);
+    max_megapixels_ = std::max(limits.max_megapixels, 0.0);
+    scale_filter_ = filter;
+}
+
+std::vector<ReplayBuffer::Entry> ReplayBuffer::snapshot(double seconds) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frames_.empty()) {
+        return {};
+    }
+
+    auto first = frames_.begin();
+    if (seconds > 0) {
+        auto cutoff = frames_.back().timestamp -
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(seconds));
+        first = std::find_if(frames_.begin(), frames_.end(),
+                             [cutoff](const Entry& entry) { return entry.timestamp >= cutoff; });
+    }
+    return std::vector<Entry>(first, frames_.end());
+}
+
+void ReplayBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_.clear();
+    bytes_ = 0;
+}
+
+size_t ReplayBuffer::size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+size_t ReplayBuffer::frame_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_.size();
+}
+
+void ReplayBuffer::run() {
+    ImageEncoder encoder;
+    encoder.set_format("jpeg");
+
+    // Two frames are swapped each round so the pixel buffers are reused
+    FrameRing::Frame frame;
+    FrameRing::Frame previous;
+    RawImage scaled;
+    std::shared_ptr<const EncodedImage> previous_image;
+    uint64_t last_sequence = 0;
+
+    while (running_.load()) {
+        if (!ring_->wait_for_frame(last_sequence, std::chrono::milliseconds(250))) {
+            continue;
+        }
+        // Encoding may be slower than capturing: always take the newest frame
+        if (!ring_->read_latest(frame, last_sequence)) {
+            continue;
+        }
+        last_sequence = frame.sequence;
+
+        const RawImage& raw = frame.image;
+        const RawImage& last_raw = previous.image;
+        bool unchanged = previous_image &&
+            raw.width == last_raw.width && raw.height == last_raw.height &&
+            raw.stride == last_raw.stride && raw.pixels.size() == last_raw.pixels.size() &&
+            std::memcmp(raw.pixels.data(), last_raw.pixels.data(), raw.pixels.size()) == 0;
+
+        Entry entry;
+        entry.sequence = frame.sequence;
+        entry.timestamp = frame.timestamp;
+
+        if (unchanged) {
+            entry.image = previous_image;
+        } else {
+            auto encoded = std::make_shared<EncodedImage>();
+            encoder.set_quality(quality_.load());
+
+            ImageScaler::Limits limits;
+            limits.max_long_edge = max_long_edge_.load();
+            limits.max_megapixels = max_megapixels_.load();
+            bool is_scaled = ImageScaler::scale_to_fit(raw, scaled, limits, scale_filter_.load());
+
+            if (!encoder.encode(is_scaled ? scaled : raw, *encoded)) {
+                std::cerr << "⚠️ Replay buffer: failed to encode frame " << frame.sequence << std::endl;
+                continue;
+            }
+            entry.image = encoded;
+            previous_image = encoded;
+            std::swap(frame, previous);
+        }
+
+        push(std::move(entry), unchanged);
+    }
+}
+
+void ReplayBuffer::push(Entry entry, bool shared) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!shared) {
+        bytes_ += entry.image->data.size();
+    }
+    auto now = entry.timestamp;
+    frames_.push_back(std::move(entry));
+    trim(now);
+}
+
+void ReplayBuffer::trim(std::chrono::steady_clock::time_point now) {
+    auto cutoff = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(duration_.load()));
+    size_t budget = byte_budget_.load();
+
+    // Keep at least the newest frame
+    while (frames_.size() > 1 &&
+           (bytes_ > budget || frames_.front().timestamp < cutoff)) {
+        std::shared_ptr<const EncodedImage> image = std::move(frames_.front().image);
+        frames_.pop_front();
+        // Consecutive unchanged frames share one image, count it once
+        if (frames_.front().image != image) {
+            bytes_ -= image->data.size();
+        }
+    }
+}
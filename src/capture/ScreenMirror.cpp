@@ -0,0 +1,285 @@
+#include "../../include/ScreenMirror.h"
+#include "../../include/ShmSegmentPool.h"
+#include <X11/extensions/Xfixes.h>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+ScreenMirror::ScreenMirror(Display* display, ShmSegmentPool* shm_pool) :
+    display_(display),
+    shm_pool_(shm_pool),
+    available_(false),
+    damage_event_base_(0),
+    damage_(0),
+    mirror_(nullptr),
+    mirror_in_shm_(false),
+    damaged_(false),
+    needs_full_grab_(true) {
+
+    if (!display_) {
+        return;
+    }
+
+    // Both extensions need their version negotiated before any other request
+    int damage_error_base = 0, fixes_event_base = 0, fixes_error_base = 0;
+    int major = 0, minor = 0;
+    if (!XDamageQueryExtension(display_, &damage_event_base_, &damage_error_base) ||
+        !XDamageQueryVersion(display_, &major, &minor)) {
+        std::cout << "⚠️ XDamage not available, screen mirror disabled" << std::endl;
+        return;
+    }
+    if (!XFixesQueryExtension(display_, &fixes_event_base, &fixes_error_base) ||
+        !XFixesQueryVersion(display_, &major, &minor)) {
+        std::cout << "⚠️ XFixes not available, screen mirror disabled" << std::endl;
+        return;
+    }
+
+    available_ = true;
+}
+
+ScreenMirror::~ScreenMirror() {
+    stop();
+}
+
+bool ScreenMirror::start() {
+    if (!available_) {
+        return false;
+    }
+    if (damage_) {
+        return true;
+    }
+
+    // NonEmpty: one event when the damage region stops being empty, the
+    // region itself is collected in sync()
+    damage_ = XDamageCreate(display_, DefaultRootWindow(display_), XDamageReportNonEmpty);
+    if (!damage_) {
+        std::cerr << "❌ Failed to create damage tracker for the root window" << std::endl;
+        return false;
+    }
+
+    XDamageSubtract(display_, damage_, 0, 0);
+    if (!grab_full()) {
+        stop();
+        return false;
+    }
+
+    std::cout << "✅ Screen mirror started (" << mirror_->width << "×" << mirror_->height
+              << (mirror_in_shm_ ? ", MIT-SHM" : "") << ")" << std::endl;
+    return true;
+}
+
+void ScreenMirror::stop() {
+    if (damage_ && display_) {
+        XDamageDestroy(display_, damage_);
+        XFlush(display_);
+    }
+    damage_ = 0;
+    damaged_ = false;
+    needs_full_grab_ = true;
+    release_mirror();
+}
+
+int ScreenMirror::event_type() const {
+    return damage_event_base_ + XDamageNotify;
+}
+
+bool ScreenMirror::handle_event(const XEvent& event) {
+    if (!damage_ || event.type != damage_event_base_ + XDamageNotify) {
+        return false;
+    }
+
+    const XDamageNotifyEvent* notify = reinterpret_cast<const XDamageNotifyEvent*>(&event);
+    if (notify->damage != damage_) {
+        return false;
+    }
+
+    damaged_ = true;
+    return true;
+}
+
+bool ScreenMirror::sync(const std::function<void()>& pump_events) {
+    if (!damage_) {
+        return false;
+    }
+
+    // The geometry reply doubles as the round trip that flushes pending
+    // damage events into the queue
+    Window root_return;
+    int x, y;
+    unsigned int width, height, border, depth;
+    if (!XGetGeometry(display_, DefaultRootWindow(display_), &root_return,
+                      &x, &y, &width, &height, &border, &depth)) {
+        return false;
+    }
+    if (!mirror_ || static_cast<unsigned int>(mirror_->width) != width ||
+        static_cast<unsigned int>(mirror_->height) != height) {
+        needs_full_grab_ = true;
+    }
+
+    if (pump_events) {
+        pump_events();
+    }
+
+    if (needs_full_grab_) {
+        XDamageSubtract(display_, damage_, 0, 0);
+        return grab_full();
+    }
+
+    if (!damaged_) {
+        return true;  // Nothing changed since the last sync
+    }
+
+    // Take the damaged region and reset it in one request
+    XserverRegion region = XFixesCreateRegion(display_, nullptr, 0);
+    XDamageSubtract(display_, damage_, 0, region);
+    damaged_ = false;
+
+    int rect_count = 0;
+    XRectangle* rects = XFixesFetchRegion(display_, region, &rect_count);
+    XFixesDestroyRegion(display_, region);
+
+    // Mark the bands touched by any damaged rectangle
+    int band_count = (mirror_->height + band_rows_ - 1) / band_rows_;
+    std::vector<bool> dirty(band_count, false);
+    for (int i = 0; i < rect_count; ++i) {
+        int top = std::max(0, static_cast<int>(rects[i].y));
+        int bottom = std::min(mirror_->height, rects[i].y + static_cast<int>(rects[i].height));
+        for (int row = top; row < bottom; row = (row / band_rows_ + 1) * band_rows_) {
+            dirty[row / band_rows_] = true;
+        }
+    }
+    if (rects) {
+        XFree(rects);
+    }
+
+    for (int band = 0; band < band_count; ++band) {
+        if (dirty[band] && !grab_band(band * band_rows_, band_rows_)) {
+            // Leave the mirror consistent: start over on the next sync
+            needs_full_grab_ = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+XImage* ScreenMirror::copy_area(int x, int y, unsigned int width, unsigned int height) const {
+    if (!mirror_ || width == 0 || height == 0 || x < 0 || y < 0 ||
+        x + static_cast<int>(width) > mirror_->width ||
+        y + static_cast<int>(height) > mirror_->height ||
+        mirror_->bits_per_pixel % 8 != 0) {
+        return nullptr;
+    }
+
+    int screen = DefaultScreen(display_);
+    XImage* image = XCreateImage(display_, DefaultVisual(display_, screen), mirror_->depth, ZPixmap,
+                                 0, nullptr, width, height, mirror_->bitmap_pad, 0);
+    if (!image) {
+        return nullptr;
+    }
+
+    // Freed by XDestroyImage together with the image
+    image->data = static_cast<char*>(malloc(static_cast<size_t>(image->bytes_per_line) * height));
+    if (!image->data) {
+        XDestroyImage(image);
+        return nullptr;
+    }
+
+    size_t pixel_bytes = mirror_->bits_per_pixel / 8;
+    size_t row_bytes = pixel_bytes * width;
+    for (unsigned int row = 0; row < height; ++row) {
+        const char* src = mirror_->data + static_cast<size_t>(y + row) * mirror_->bytes_per_line + x * pixel_bytes;
+        std::memcpy(image->data + static_cast<size_t>(row) * image->bytes_per_line, src, row_bytes);
+    }
+
+    return image;
+}
+
+bool ScreenMirror::grab_full() {
+    release_mirror();
+
+    Window root = DefaultRootWindow(display_);
+    int screen = DefaultScreen(display_);
+    unsigned int width = DisplayWidth(display_, screen);
+    unsigned int height = DisplayHeight(display_, screen);
+
+    // Prefer the current geometry, DisplayWidth/Height are not updated on RandR changes
+    Window root_return;
+    int x, y;
+    unsigned int border, depth;
+    XGetGeometry(display_, root, &root_return, &x, &y, &width, &height, &border, &depth);
+
+    if (shm_pool_ && shm_pool_->is_available()) {
+        mirror_ = shm_pool_->get_image(root, DefaultVisual(display_, screen), DefaultDepth(display_, screen),
+                                       0, 0, width, height);
+        mirror_in_shm_ = (mirror_ != nullptr);
+    }
+    if (!mirror_) {
+        mirror_ = XGetImage(display_, root, 0, 0, width, height, AllPlanes, ZPixmap);
+        mirror_in_shm_ = false;
+    }
+
+    if (!mirror_) {
+        std::cerr << "❌ Failed to grab the screen for the mirror" << std::endl;
+        return false;
+    }
+
+    needs_full_grab_ = false;
+    damaged_ = false;
+    return true;
+}
+
+bool ScreenMirror::grab_band(int y, int rows) {
+    // Keep every band the same size so the pool reuses one segment; the last
+    // band overlaps the previous one instead of being shorter
+    if (mirror_->height >= rows) {
+        y = std::min(y, mirror_->height - rows);
+    } else {
+        y = 0;
+        rows = mirror_->height;
+    }
+
+    Window root = DefaultRootWindow(display_);
+    int screen = DefaultScreen(display_);
+    XImage* band = nullptr;
+    bool band_in_shm = false;
+
+    if (shm_pool_ && shm_pool_->is_available()) {
+        band = shm_pool_->get_image(root, DefaultVisual(display_, screen), DefaultDepth(display_, screen),
+                                    0, y, mirror_->width, rows);
+        band_in_shm = (band != nullptr);
+    }
+    if (!band) {
+        band = XGetImage(display_, root, 0, y, mirror_->width, rows, AllPlanes, ZPixmap);
+    }
+    if (!band) {
+        return false;
+    }
+
+    int row_bytes = std::min(band->bytes_per_line, mirror_->bytes_per_line);
+    for (int row = 0; row < rows; ++row) {
+        std::memcpy(mirror_->data + static_cast<size_t>(y + row) * mirror_->bytes_per_line,
+                    band->data + static_cast<size_t>(row) * band->bytes_per_line, row_bytes);
+    }
+
+    if (band_in_shm) {
+        shm_pool_->release(band);
+    } else {
+        XDestroyImage(band);
+    }
+    return true;
+}
+
+void ScreenMirror::release_mirror() {
+    if (!mirror_) {
+        return;
+    }
+    if (mirror_in_shm_ && shm_pool_) {
+        shm_pool_->release(mirror_);
+    } else {
+        XDestroyImage(mirror_);
+    }
+    mirror_ = nullptr;
+    mirror_in_shm_ = false;
+}
@@ -0,0 +1,134 @@
+#include "../../include/ScreenTopology.h"
+#include <X11/extensions/Xrandr.h>
+#include <iostream>
+
+ScreenTopology::ScreenTopology(Display* display) :
+    display_(display),
+    has_randr_(false),
+    randr_event_base_(0),
+    valid_(false),
+    generation_(0) {
+
+    if (!display_) {
+        return;
+    }
+
+    int error_base = 0;
+    if (XRRQueryExtension(display_, &randr_event_base_, &error_base)) {
+        has_randr_ = true;
+        XRRSelectInput(display_, DefaultRootWindow(display_),
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    }
+}
+
+const std::vector<X11ScreenCapturer::ScreenInfo>& ScreenTopology::screens() {
+    if (!valid_) {
+        query();
+    }
+    return screens_;
+}
+
+const X11ScreenCapturer::ScreenInfo* ScreenTopology::find(int number) {
+    for (const auto& screen : screens()) {
+        if (screen.number == number) {
+            return &screen;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<int> ScreenTopology::event_types() const {
+    if (!has_randr_) {
+        return {};
+    }
+    return {randr_event_base_ + RRScreenChangeNotify, randr_event_base_ + RRNotify};
+}
+
+bool ScreenTopology::handle_event(XEvent& event) {
+    if (!has_randr_) {
+        return false;
+    }
+
+    if (event.type == randr_event_base_ + RRScreenChangeNotify) {
+        // Keeps DisplayWidth/DisplayHeight up to date
+        XRRUpdateConfiguration(&event);
+        valid_ = false;
+        return true;
+    }
+    if (event.type == randr_event_base_ + RRNotify) {
+        valid_ = false;
+        return true;
+    }
+    return false;
+}
+
+void ScreenTopology::query() {
+    screens_.clear();
+    valid_ = true;
+    ++generation_;
+
+    if (!display_) {
+        return;
+    }
+
+    // Add "all screens" option
+    X11ScreenCapturer::ScreenInfo all_screens;
+    all_screens.number = -1;
+    all_screens.name = "All Screens";
+    all_screens.x = 0;
+    all_screens.y = 0;
+    all_screens.width = DisplayWidth(display_, DefaultScreen(display_));
+    all_screens.height = DisplayHeight(display_, DefaultScreen(display_));
+    screens_.push_back(all_screens);
+
+    if (!has_randr_) {
+        // Fallback if XRandR is not available - add each screen
+        int screen_count = ScreenCount(display_);
+        for (int i = 0; i < screen_count; i++) {
+            X11ScreenCapturer::ScreenInfo screen;
+            screen.number = i;
+            screen.name = "Screen " + std::to_string(i);
+            screen.x = 0;
+            screen.y = 0;
+            screen.width = DisplayWidth(display_, i);
+            screen.height = DisplayHeight(display_, i);
+            screens_.push_back(screen);
+        }
+        return;
+    }
+
+    // The current configuration, without asking the driver to probe outputs
+    XRRScreenResources* resources = XRRGetScreenResourcesCurrent(display_, DefaultRootWindow(display_));
+    if (!resources) {
+        std::cerr << "⚠️ Failed to read screen resources" << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < resources->noutput; i++) {
+        XRROutputInfo* output_info = XRRGetOutputInfo(display_, resources, resources->outputs[i]);
+        if (!output_info) {
+            continue;
+        }
+
+        // Only connected outputs driven by a CRTC show up as screens
+        if (output_info->connection == RR_Connected && output_info->crtc) {
+            XRRCrtcInfo* crtc_info = XRRGetCrtcInfo(display_, resources, output_info->crtc);
+            if (crtc_info) {
+                X11ScreenCapturer::ScreenInfo screen;
+                screen.number = i;
+                screen.name = output_info->name;
+                screen.x = crtc_info->x;
+                screen.y = crtc_info->y;
+                screen.width = crtc_info->width;
+                screen.height = crtc_info->height;
+                screens_.push_back(screen);
+
+                XRRFreeCrtcInfo(crtc_info);
+            }
+        }
+
+        XRRFreeOutputInfo(output_info);
+    }
+
+    XRRFreeScreenResources(resources);
+}
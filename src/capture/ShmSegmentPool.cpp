@@ -0,0 +1,214 @@
+#include "../../include/ShmSegmentPool.h"
+#include "../../include/X11ErrorTrap.h"
+#include <iostream>
+#include <algorithm>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+ShmSegmentPool::ShmSegmentPool(Display* display) :
+    display_(display),
+    available_(false),
+    use_counter_(0),
+    max_idle_segments_(4) {
+
+    if (!display_) {
+        return;
+    }
+
+    int major = 0, minor = 0;
+    Bool shared_pixmaps = False;
+    if (XShmQueryExtension(display_) && XShmQueryVersion(display_, &major, &minor, &shared_pixmaps)) {
+        available_ = true;
+        std::cout << "✅ MIT-SHM " << major << "." << minor << " available, using zero-copy capture" << std::endl;
+    } else {
+        std::cout << "⚠️ MIT-SHM not available, using XGetImage for captures" << std::endl;
+    }
+}
+
+ShmSegmentPool::~ShmSegmentPool() {
+    for (auto& segment : segments_) {
+        destroy_segment(*segment);
+    }
+    segments_.clear();
+}
+
+XImage* ShmSegmentPool::get_image(Drawable drawable, Visual* visual, int depth,
+                                  int x, int y, unsigned int width, unsigned int height) {
+    if (!available_ || width == 0 || height == 0) {
+        return nullptr;
+    }
+
+    Segment* segment = acquire(visual, depth, width, height);
+    if (!segment) {
+        return nullptr;
+    }
+
+    // XShmGetImage waits for a reply, so errors (e.g. BadMatch for an
+    // off-screen area) are reported before it returns
+    X11ErrorTrap trap(display_);
+    Bool ok = XShmGetImage(display_, drawable, segment->image, x, y, AllPlanes);
+
+    if (!ok || trap.had_error()) {
+        segment->in_use = false;
+        return nullptr;
+    }
+
+    return segment->image;
+}
+
+bool ShmSegmentPool::owns(const XImage* image) const {
+    if (!image) {
+        return false;
+    }
+    return std::any_of(segments_.begin(), segments_.end(),
+                       [image](const std::unique_ptr<Segment>& segment) {
+                           return segment->image == image;
+                       });
+}
+
+void ShmSegmentPool::release(XImage* image) {
+    for (auto& segment : segments_) {
+        if (segment->image == image) {
+            segment->in_use = false;
+            segment->last_used = ++use_counter_;
+            break;
+        }
+    }
+    trim_idle_segments();
+}
+
+void ShmSegmentPool::clear() {
+    auto it = segments_.begin();
+    while (it != segments_.end()) {
+        if (!(*it)->in_use) {
+            destroy_segment(**it);
+            it = segments_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+ShmSegmentPool::Segment* ShmSegmentPool::acquire(Visual* visual, int depth,
+                                                 unsigned int width, unsigned int height) {
+    // Reuse an idle segment with the same geometry
+    for (auto& segment : segments_) {
+        if (!segment->in_use && segment->depth == depth && segment->visual == visual &&
+            static_cast<unsigned int>(segment->image->width) == width &&
+            static_cast<unsigned int>(segment->image->height) == height) {
+            segment->in_use = true;
+            segment->last_used = ++use_counter_;
+            return segment.get();
+        }
+    }
+
+    auto segment = std::make_unique<Segment>();
+    if (!create_segment(*segment, visual, depth, width, height)) {
+        return nullptr;
+    }
+
+    segment->in_use = true;
+    segment->last_used = ++use_counter_;
+    segments_.push_back(std::move(segment));
+    trim_idle_segments();
+    return segments_.back().get();
+}
+
+bool ShmSegmentPool::create_segment(Segment& segment, Visual* visual, int depth,
+                                    unsigned int width, unsigned int height) {
+    segment.visual = visual;
+    segment.depth = depth;
+    segment.info.shmid = -1;
+    segment.info.shmaddr = reinterpret_cast<char*>(-1);
+
+    segment.image = XShmCreateImage(display_, visual, depth, ZPixmap, nullptr,
+                                    &segment.info, width, height);
+    if (!segment.image) {
+        std::cerr << "⚠️ XShmCreateImage failed for " << width << "×" << height << std::endl;
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(segment.image->bytes_per_line) * segment.image->height;
+    segment.info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (segment.info.shmid < 0) {
+        std::cerr << "⚠️ shmget failed for " << size << " bytes" << std::endl;
+        destroy_segment(segment);
+        return false;
+    }
+
+    segment.info.shmaddr = static_cast<char*>(shmat(segment.info.shmid, nullptr, 0));
+    if (segment.info.shmaddr == reinterpret_cast<char*>(-1)) {
+        std::cerr << "⚠️ shmat failed" << std::endl;
+        shmctl(segment.info.shmid, IPC_RMID, nullptr);
+        destroy_segment(segment);
+        return false;
+    }
+    segment.image->data = segment.info.shmaddr;
+    segment.info.readOnly = False;
+
+    // Attach errors are asynchronous, sync to find out if the server accepted it
+    Bool attached;
+    bool had_error;
+    {
+        X11ErrorTrap trap(display_);
+        attached = XShmAttach(display_, &segment.info);
+        XSync(display_, False);
+        had_error = trap.had_error();
+    }
+
+    // Mark for removal now so the segment goes away with the last detach,
+    // even if we crash
+    shmctl(segment.info.shmid, IPC_RMID, nullptr);
+
+    if (!attached || had_error) {
+        std::cerr << "⚠️ X server could not attach shared memory, disabling MIT-SHM captures" << std::endl;
+        available_ = false;
+        destroy_segment(segment);
+        return false;
+    }
+
+    segment.attached = true;
+    return true;
+}
+
+void ShmSegmentPool::destroy_segment(Segment& segment) {
+    if (segment.attached && display_) {
+        XShmDetach(display_, &segment.info);
+        XSync(display_, False);
+    }
+    if (segment.info.shmaddr && segment.info.shmaddr != reinterpret_cast<char*>(-1)) {
+        shmdt(segment.info.shmaddr);
+    }
+    if (segment.image) {
+        // The data belongs to the segment, don't let Xlib free it
+        segment.image->data = nullptr;
+        XDestroyImage(segment.image);
+    }
+    segment.image = nullptr;
+    segment.attached = false;
+    segment.info.shmid = -1;
+    segment.info.shmaddr = nullptr;
+}
+
+void ShmSegmentPool::trim_idle_segments() {
+    size_t idle = std::count_if(segments_.begin(), segments_.end(),
+                                [](const std::unique_ptr<Segment>& segment) {
+                                    return !segment->in_use;
+                                });
+
+    // Drop the least recently used idle segments beyond the limit
+    while (idle > max_idle_segments_) {
+        auto oldest = segments_.end();
+        for (auto it = segments_.begin(); it != segments_.end(); ++it) {
+            if (!(*it)->in_use && (oldest == segments_.end() || (*it)->last_used < (*oldest)->last_used)) {
+                oldest = it;
+            }
+        }
+        if (oldest == segments_.end()) {
+            break;
+        }
+        destroy_segment(**oldest);
+        segments_.erase(oldest);
+        --idle;
+    }
+}
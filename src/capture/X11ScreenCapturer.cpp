@@ -1,30 +1,94 @@
 #include "../include/X11ScreenCapturer.h"
+#include "../include/ShmSegmentPool.h"
+#include "../include/ScreenMirror.h"
+#include "../include/CompositeWindowCache.h"
+#include "../include/ScreenTopology.h"
+#include "../include/XcbWindowScanner.h"
+#include "../include/PixelConverter.h"
+#include "../include/ImageFormat.h"
+#include "../include/WorkerPool.h"
+#include "../include/X11Connection.h"
+#include "../include/X11ErrorTrap.h"
 
 #include <iostream>
-#include <X11/extensions/Xrandr.h>
 #include <X11/extensions/Xcomposite.h>
 #include <X11/Xatom.h>  // For X11 property atoms
-#include <cairo/cairo.h>
-#include <cairo/cairo-xlib.h>
 #include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <sys/stat.h>
-#include <glibmm/main.h>  // For Glib::signal_timeout
 
-X11ScreenCapturer::X11ScreenCapturer() : monitoring_window_events_(false) {
-    display = XOpenDisplay(nullptr);
+// Pool for per-monitor conversion and encoding; separate from the PNG
+// encoder's band pool, which these tasks wait on
+static WorkerPool& monitor_pool() {
+    static WorkerPool pool(WorkerPool::hardware_threads());
+    return pool;
+}
+
+X11ScreenCapturer::X11ScreenCapturer() :
+    X11ScreenCapturer(std::make_shared<X11Connection>()) {
+}
+
+X11ScreenCapturer::X11ScreenCapturer(std::shared_ptr<X11Connection> connection) :
+    connection_(std::move(connection)),
+    display(connection_->display()),
+    monitoring_window_events_(false),
+    use_shm_(true),
+    log_captures_(true),
+    scale_filter_(ImageScaler::Filter::Area),
+    mirror_subscription_(0),
+    rescan_windows_(false),
+    window_list_changed_(false),
+    screens_changed_(false),
+    window_table_valid_(false),
+    window_table_client_list_(false),
+    wm_name_atom_(XA_WM_NAME),
+    net_wm_name_atom_(connection_->atom(X11Connection::NET_WM_NAME)) {
     if (!display) {
-        std::cerr << "❌ Failed to open X display" << std::endl;
+        return;
     }
+    
+    shm_pool_ = std::make_unique<ShmSegmentPool>(display);
+    composite_cache_ = std::make_unique<CompositeWindowCache>(*connection_);
+    topology_ = std::make_unique<ScreenTopology>(display);
+    window_scanner_ = std::make_unique<XcbWindowScanner>(*connection_);
+    
+    // Monitor changes invalidate the screen topology
+    for (int type : topology_->event_types()) {
+        subscriptions_.push_back(connection_->subscribe(type, 0, [this](XEvent& event) {
+            if (topology_->handle_event(event)) {
+                screens_changed_ = true;
+            }
+        }));
+    }
+    
+    // Resizes and destroys invalidate cached window pixmaps
+    for (int type : {ConfigureNotify, MapNotify, UnmapNotify, DestroyNotify}) {
+        subscriptions_.push_back(connection_->subscribe(type, 0, [this](XEvent& event) {
+            composite_cache_->handle_event(event);
+        }));
+    }
+    
+    batch_connection_ = connection_->signal_events_dispatched().connect(
+        sigc::mem_fun(*this, &X11ScreenCapturer::finish_event_batch));
 }
 
 X11ScreenCapturer::~X11ScreenCapturer() {
-    // Stop monitoring before closing display
+    // Stop monitoring; the connection may outlive us
     stop_window_events_monitoring();
-    
-    if (display) {
-        XCloseDisplay(display);
+    set_use_mirror(false);
+    for (int id : subscriptions_) {
+        connection_->unsubscribe(id);
     }
+    batch_connection_.disconnect();
+    
+    // Shared memory segments must be detached while the display is open,
+    // the mirror holds one of them
+    mirror_.reset();
+    shm_pool_.reset();
+    
+    // Unredirect captured windows
+    composite_cache_.reset();
 }
 
 std::vector<X11ScreenCapturer::WindowInfo> X11ScreenCapturer::list_windows() {
@@ -35,6 +99,38 @@ std::vector<X11ScreenCapturer::WindowInfo> X11ScreenCapturer::list_windows() {
         return windows;
     }
     
+    // The window table is up to date while window events are monitored
+    if (window_table_valid_) {
+        for (const auto& [id, info] : window_table_) {
+            if (is_listed(info)) {
+                windows.push_back(info);
+            }
+        }
+        std::sort(windows.begin(), windows.end(),
+                 [](const WindowInfo& a, const WindowInfo& b) {
+                     return a.title < b.title;
+                 });
+        return windows;
+    }
+    
+    // One pipelined scan instead of several round trips per window
+    if (window_scanner_->is_available()) {
+        std::vector<WindowInfo> scanned;
+        if (!window_scanner_->scan(scanned)) {
+            return windows;
+        }
+        for (const auto& info : scanned) {
+            if (is_listed(info)) {
+                windows.push_back(info);
+            }
+        }
+        std::sort(windows.begin(), windows.end(),
+                 [](const WindowInfo& a, const WindowInfo& b) {
+                     return a.title < b.title;
+                 });
+        return windows;
+    }
+    
     // Get the root window
     Window root = DefaultRootWindow(display);
     
@@ -53,45 +149,16 @@ std::vector<X11ScreenCapturer::WindowInfo> X11ScreenCapturer::list_windows() {
     // Filter windows to get only those with titles
     for (unsigned int i = 0; i < num_children; i++) {
         WindowInfo info;
-        info.id = children[i];
+        if (!get_window_info(children[i], info)) {
+            continue;
+        }
         
-        // Get window attributes
-        XWindowAttributes attrs;
-        if (XGetWindowAttributes(display, info.id, &attrs)) {
-            info.width = attrs.width;
-            info.height = attrs.height;
-            info.x = attrs.x;
-            info.y = attrs.y;
-            info.is_visible = (attrs.map_state == IsViewable);
-            
-            // Skip invisible windows
-            if (!info.is_visible) {
-                continue;
-            }
-            
-            // Get window title
-            char* window_name = nullptr;
-            if (XFetchName(display, info.id, &window_name) && window_name) {
-                info.title = window_name;
-                XFree(window_name);
-            } else {
-                // Try to get WM_NAME property if XFetchName fails
-                XTextProperty text_prop;
-                if (XGetWMName(display, info.id, &text_prop) && text_prop.value) {
-                    info.title = reinterpret_cast<char*>(text_prop.value);
-                    XFree(text_prop.value);
-                } else {
-                    info.title = "[Unnamed Window]";
-                }
-            }
-            
-            // Skip windows without meaningful titles
-            if (info.title.empty() || info.title == "[Unnamed Window]") {
-                continue;
-            }
-            
-            windows.push_back(info);
+        // Skip invisible windows and windows without meaningful titles
+        if (!is_listed(info)) {
+            continue;
         }
+        
+        windows.push_back(info);
     }
     
     XFree(children);
@@ -105,78 +172,71 @@ std::vector<X11ScreenCapturer::WindowInfo> X11ScreenCapturer::list_windows() {
     return windows;
 }
 
-std::vector<X11ScreenCapturer::ScreenInfo> X11ScreenCapturer::detect_screens() {
-    std::vector<ScreenInfo> screens;
-    
+bool X11ScreenCapturer::get_window_info(Window id, WindowInfo& info) {
     if (!display) {
-        std::cerr << "❌ No X display connection" << std::endl;
-        return screens;
+        return false;
     }
     
-    // Get default screen
-    int screen_count = ScreenCount(display);
+    // Get window attributes
+    XWindowAttributes attrs;
+    if (!XGetWindowAttributes(display, id, &attrs)) {
+        return false;
+    }
     
-    // Add "all screens" option
-    ScreenInfo all_screens;
-    all_screens.number = -1;
-    all_screens.name = "All Screens";
-    all_screens.x = 0;
-    all_screens.y = 0;
-    all_screens.width = DisplayWidth(display, DefaultScreen(display));
-    all_screens.height = DisplayHeight(display, DefaultScreen(display));
-    screens.push_back(all_screens);
+    info.id = id;
+    info.width = attrs.width;
+    info.height = attrs.height;
+    info.x = attrs.x;
+    info.y = attrs.y;
+    info.is_visible = (attrs.map_state == IsViewable);
+    info.has_decorations = false;
     
-    // Get XRandR extension information for multi-monitor support
-    int xrandr_event_base, xrandr_error_base;
-    if (XRRQueryExtension(display, &xrandr_event_base, &xrandr_error_base)) {
-        // Get screen resources
-        XRRScreenResources* resources = XRRGetScreenResources(display, DefaultRootWindow(display));
-        if (resources) {
-            for (int i = 0; i < resources->noutput; i++) {
-                XRROutputInfo* output_info = XRRGetOutputInfo(display, resources, resources->outputs[i]);
-                
-                if (output_info->connection == RR_Connected) {
-                    // Find the CRTC for this output
-                    if (output_info->crtc) {
-                        XRRCrtcInfo* crtc_info = XRRGetCrtcInfo(display, resources, output_info->crtc);
-                        
-                        if (crtc_info) {
-                            ScreenInfo screen;
-                            screen.number = i;
-                            screen.name = output_info->name;
-                            screen.x = crtc_info->x;
-                            screen.y = crtc_info->y;
-                            screen.width = crtc_info->width;
-                            screen.height = crtc_info->height;
-                            
-                            screens.push_back(screen);
-                            
-                            XRRFreeCrtcInfo(crtc_info);
-                        }
-                    }
-                }
-                
-                XRRFreeOutputInfo(output_info);
-            }
-            
-            XRRFreeScreenResources(resources);
-        }
+    // Get window title
+    char* window_name = nullptr;
+    if (XFetchName(display, id, &window_name) && window_name) {
+        info.title = window_name;
+        XFree(window_name);
     } else {
-        // Fallback if XRandR is not available - add each screen
-        for (int i = 0; i < screen_count; i++) {
-            ScreenInfo screen;
-            screen.number = i;
-            screen.name = "Screen " + std::to_string(i);
-            screen.x = 0;
-            screen.y = 0;
-            screen.width = DisplayWidth(display, i);
-            screen.height = DisplayHeight(display, i);
-            
-            screens.push_back(screen);
+        // Try to get WM_NAME property if XFetchName fails
+        XTextProperty text_prop;
+        if (XGetWMName(display, id, &text_prop) && text_prop.value) {
+            info.title = reinterpret_cast<char*>(text_prop.value);
+            XFree(text_prop.value);
+        } else {
+            info.title = "[Unnamed Window]";
         }
     }
     
-    return screens;
+    return true;
+}
+
+bool X11ScreenCapturer::find_window(Window id, WindowInfo& info) {
+    if (window_table_valid_) {
+        auto it = window_table_.find(id);
+        if (it == window_table_.end()) {
+            return false;
+        }
+        info = it->second;
+        return true;
+    }
+    return get_window_info(id, info);
+}
+
+bool X11ScreenCapturer::is_listed(const WindowInfo& info) {
+    return info.is_visible && !info.title.empty() && info.title != "[Unnamed Window]";
+}
+
+std::vector<X11ScreenCapturer::ScreenInfo> X11ScreenCapturer::detect_screens() {
+    if (!display) {
+        std::cerr << "❌ No X display connection" << std::endl;
+        return {};
+    }
+    
+    // Cached until RandR reports a change; changes that arrived since the
+    // last lookup go through the connection, so the screens changed signal
+    // fires for them too
+    pump_x11_events();
+    return topology_->screens();
 }
 
 bool X11ScreenCapturer::capture_window(const WindowInfo& window, const std::string& filename) {
@@ -192,11 +252,11 @@ bool X11ScreenCapturer::capture_window(const WindowInfo& window, const std::stri
         return false;
     }
     
-    // Save to PNG using Cairo
-    bool result = save_image_to_png(image, filename);
+    // Encode and save in the format matching the file extension
+    bool result = save_image(image, filename);
     
     // Free the image
-    XDestroyImage(image);
+    release_image(image);
     
     return result;
 }
@@ -207,16 +267,26 @@ XImage* X11ScreenCapturer::capture_window_image(const WindowInfo& window) {
         return nullptr;
     }
     
-    // Get window attributes
-    XWindowAttributes attrs;
-    if (!XGetWindowAttributes(display, window.id, &attrs)) {
-        std::cerr << "❌ Failed to get window attributes" << std::endl;
-        return nullptr;
+    // Window state comes from the composite cache, which only goes to the
+    // server when the window is new, resized, mapped or unmapped. Events
+    // that arrived since the last capture reach it, and the window table,
+    // through the connection first.
+    pump_x11_events();
+    CompositeWindowCache::WindowPixmap named;
+    bool has_pixmap = composite_cache_->get(window.id, named);
+    if (!named.exists) {
+        // No XComposite, or the window is gone: ask the server directly
+        XWindowAttributes attrs;
+        if (!XGetWindowAttributes(display, window.id, &attrs)) {
+            std::cerr << "❌ Failed to get window attributes" << std::endl;
+            return nullptr;
+        }
+        named.viewable = (attrs.map_state == IsViewable);
     }
     
     // Check if window is visible or minimized
-    bool is_minimized = (attrs.map_state != IsViewable);
-    if (is_minimized) {
+    bool is_minimized = !named.viewable;
+    if (is_minimized && log_captures_) {
         std::cout << "⚠️ Window is minimized or hidden, capturing screen area instead" << std::endl;
     }
     
@@ -224,54 +294,44 @@ XImage* X11ScreenCapturer::capture_window_image(const WindowInfo& window) {
     Window root = DefaultRootWindow(display);
     
     // Log the window dimensions we're capturing
-    std::cout << "📸 Capturing window: \"" << window.title << "\" (" << window.width << "×" << window.height << ")" << std::endl;
+    if (log_captures_) {
+        std::cout << "📸 Capturing window: \"" << window.title << "\" (" << window.width << "×" << window.height << ")" << std::endl;
+    }
     
     XImage* image = nullptr;
     
-    if (!is_minimized) {
-        // First try to use XComposite for active windows, which gives better results
-        try {
-            // Use XComposite to redirect the window
-            XCompositeRedirectWindow(display, window.id, CompositeRedirectAutomatic);
-            XSync(display, False);
-            
-            // Create a Pixmap to hold the window contents
-            Pixmap pixmap = XCompositeNameWindowPixmap(display, window.id);
-            if (pixmap) {
-                // Get the window image from the pixmap
-                image = XGetImage(display, pixmap, 0, 0, attrs.width, attrs.height, AllPlanes, ZPixmap);
-                
-                // Free the pixmap as we don't need it anymore
-                XFreePixmap(display, pixmap);
-                
-                if (image) {
-                    std::cout << "✅ Successfully captured window using XComposite method" << std::endl;
-                } else {
-                    std::cerr << "⚠️ Failed to get window image from pixmap, falling back to root window method" << std::endl;
-                }
+    if (has_pixmap) {
+        // XComposite gives the window contents even when it is covered
+        image = grab_image(named.pixmap, named.visual, named.depth, 0, 0, named.width, named.height);
+        if (image) {
+            if (log_captures_) {
+                std::cout << "✅ Successfully captured window using XComposite method" << std::endl;
             }
-        } catch (const std::exception& e) {
-            std::cerr << "⚠️ Exception during XComposite capture: " << e.what() << std::endl;
+        } else {
+            // Name a fresh pixmap next time
+            composite_cache_->invalidate(window.id);
+            std::cerr << "⚠️ Failed to get window image from pixmap, falling back to root window method" << std::endl;
         }
     }
     
     // Fallback method: Capture from root window
     // This works for both visible and minimized windows (gets the area where the window is/would be)
     if (!image) {
-        image = XGetImage(display, root, 
-                         window.x, window.y, 
-                         window.width, window.height, 
-                         AllPlanes, ZPixmap);
+        int screen = DefaultScreen(display);
+        image = grab_image(root, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                           window.x, window.y, window.width, window.height);
         
         if (image) {
-            std::cout << "✅ Successfully captured " << (is_minimized ? "area where window would be" : "window") 
-                      << " using root window method" << std::endl;
+            if (log_captures_) {
+                std::cout << "✅ Successfully captured " << (is_minimized ? "area where window would be" : "window") 
+                          << " using root window method" << std::endl;
+            }
         } else {
             std::cerr << "❌ Failed to get window image using root window method" << std::endl;
         }
     }
     
-    if (image) {
+    if (image && log_captures_) {
         std::cout << "✅ Final window image dimensions: " << image->width << "×" << image->height << std::endl;
     }
     
@@ -291,11 +351,11 @@ bool X11ScreenCapturer::capture_screen(int screen_number, const std::string& fil
         return false;
     }
     
-    // Save to PNG using Cairo
-    bool result = save_image_to_png(image, filename);
+    // Encode and save in the format matching the file extension
+    bool result = save_image(image, filename);
     
     // Free the image
-    XDestroyImage(image);
+    release_image(image);
     
     return result;
 }
@@ -311,19 +371,12 @@ XImage* X11ScreenCapturer::capture_screen_image(int screen_number) {
     int width, height;
     int x_offset = 0, y_offset = 0;
     
-    // Get XRandR information for multi-monitor support
-    std::vector<ScreenInfo> screens = detect_screens();
-    
-    // Find the requested screen
+    // Find the requested screen in the cached topology, after any RandR
+    // events waiting on the connection
     const ScreenInfo* target_screen = nullptr;
     if (screen_number >= 0) {
-        // Find the specific screen
-        for (const auto& screen : screens) {
-            if (screen.number == screen_number) {
-                target_screen = &screen;
-                break;
-            }
-        }
+        pump_x11_events();
+        target_screen = topology_->find(screen_number);
         
         if (!target_screen) {
             std::cerr << "❌ Screen number " << screen_number << " not found" << std::endl;
@@ -335,14 +388,18 @@ XImage* X11ScreenCapturer::capture_screen_image(int screen_number) {
         x_offset = target_screen->x;
         y_offset = target_screen->y;
         
-        std::cout << "📸 Capturing screen " << screen_number << ": " << target_screen->name 
-                  << " at position (" << x_offset << "," << y_offset << ") with size " 
-                  << width << "x" << height << std::endl;
+        if (log_captures_) {
+            std::cout << "📸 Capturing screen " << screen_number << ": " << target_screen->name 
+                      << " at position (" << x_offset << "," << y_offset << ") with size " 
+                      << width << "x" << height << std::endl;
+        }
     } else {
         // Capture all screens (full desktop)
         width = DisplayWidth(display, DefaultScreen(display));
         height = DisplayHeight(display, DefaultScreen(display));
-        std::cout << "📸 Capturing full desktop with size " << width << "x" << height << std::endl;
+        if (log_captures_) {
+            std::cout << "📸 Capturing full desktop with size " << width << "x" << height << std::endl;
+        }
     }
     
     // Ensure valid dimensions
@@ -351,6 +408,20 @@ XImage* X11ScreenCapturer::capture_screen_image(int screen_number) {
         return nullptr;
     }
 
+    // Serve the capture from the mirror when it is running
+    if (mirror_ && mirror_->is_running()) {
+        if (mirror_->sync([this]() { pump_x11_events(); })) {
+            XImage* image = mirror_->copy_area(x_offset, y_offset, width, height);
+            if (image) {
+                if (log_captures_) {
+                    std::cout << "✅ Captured screen image from mirror" << std::endl;
+                }
+                return image;
+            }
+        }
+        std::cerr << "⚠️ Screen mirror out of date, grabbing from the server" << std::endl;
+    }
+
     // Check for permissions to capture the screen
     int xrandr_event_base, xrandr_error_base;
     if (!XCompositeQueryExtension(display, &xrandr_event_base, &xrandr_error_base)) {
@@ -361,13 +432,15 @@ XImage* X11ScreenCapturer::capture_screen_image(int screen_number) {
     // Get the screen image
     XImage* image = nullptr;
     try {
-        // Use XGetImage to capture the root window (desktop)
-        image = XGetImage(display, root, x_offset, y_offset, width, height, AllPlanes, ZPixmap);
+        // Capture the root window (desktop), through shared memory when available
+        int screen = DefaultScreen(display);
+        image = grab_image(root, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                           x_offset, y_offset, width, height);
 
         if (!image) {
             std::cerr << "❌ Failed to get screen image. Ensure the application has the necessary permissions." << std::endl;
             return nullptr;
-        } else {
+        } else if (log_captures_) {
             std::cout << "✅ Successfully captured screen image" << std::endl;
         }
     } catch (const std::exception& e) {
@@ -378,65 +451,499 @@ XImage* X11ScreenCapturer::capture_screen_image(int screen_number) {
     return image;
 }
 
-bool X11ScreenCapturer::save_image_to_png(XImage* image, const std::string& filename) {
+XImage* X11ScreenCapturer::grab_image(Drawable drawable, Visual* visual, int depth,
+                                      int x, int y, unsigned int width, unsigned int height) {
+    if (use_shm_ && shm_pool_ && shm_pool_->is_available()) {
+        XImage* image = shm_pool_->get_image(drawable, visual, depth, x, y, width, height);
+        if (image) {
+            return image;
+        }
+        std::cerr << "⚠️ MIT-SHM capture failed, falling back to XGetImage" << std::endl;
+    }
+    
+    return XGetImage(display, drawable, x, y, width, height, AllPlanes, ZPixmap);
+}
+
+void X11ScreenCapturer::release_image(XImage* image) {
     if (!image) {
-        std::cerr << "❌ No image to save" << std::endl;
+        return;
+    }
+    
+    if (shm_pool_ && shm_pool_->owns(image)) {
+        shm_pool_->release(image);
+    } else {
+        XDestroyImage(image);
+    }
+}
+
+void X11ScreenCapturer::set_use_shm(bool use_shm) {
+    use_shm_ = use_shm;
+    if (!use_shm_ && shm_pool_) {
+        shm_pool_->clear();
+    }
+}
+
+bool X11ScreenCapturer::is_using_shm() const {
+    return use_shm_ && shm_pool_ && shm_pool_->is_available();
+}
+
+bool X11ScreenCapturer::set_use_mirror(bool use_mirror) {
+    if (!use_mirror) {
+        if (mirror_) {
+            connection_->unsubscribe(mirror_subscription_);
+            mirror_subscription_ = 0;
+            mirror_.reset();
+            std::cout << "✅ Screen mirror stopped" << std::endl;
+        }
+        return true;
+    }
+    
+    if (!display) {
+        std::cerr << "❌ Cannot start screen mirror: No X display connection" << std::endl;
         return false;
     }
     
-    // Create Cairo surface
-    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, image->width, image->height);
-    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-        std::cerr << "❌ Failed to create Cairo surface: " << cairo_status_to_string(cairo_surface_status(surface)) << std::endl;
+    if (!mirror_) {
+        mirror_ = std::make_unique<ScreenMirror>(display, use_shm_ ? shm_pool_.get() : nullptr);
+    }
+    if (!mirror_->start()) {
+        mirror_.reset();
         return false;
     }
     
-    // Get Cairo surface data
-    unsigned char* data = cairo_image_surface_get_data(surface);
-    int stride = cairo_image_surface_get_stride(surface);
+    // Damage events belong to the screen mirror
+    if (!mirror_subscription_) {
+        mirror_subscription_ = connection_->subscribe(mirror_->event_type(), 0, [this](XEvent& event) {
+            mirror_->handle_event(event);
+        });
+    }
+    return true;
+}
+
+bool X11ScreenCapturer::is_using_mirror() const {
+    return mirror_ && mirror_->is_running();
+}
+
+CaptureSettings X11ScreenCapturer::get_capture_settings() const {
+    CaptureSettings settings;
+    settings.use_shm = use_shm_;
+    settings.use_mirror = is_using_mirror();
+    settings.output_format = image_encoder_.get_format();
+    settings.quality = image_encoder_.get_quality();
+    settings.png_preset = image_encoder_.png().get_preset();
+    settings.png_compression_level = image_encoder_.png().get_compression_level();
+    settings.scale_filter = scale_filter_;
+    return settings;
+}
+
+void X11ScreenCapturer::apply_capture_settings(const CaptureSettings& settings) {
+    if (settings.use_shm != use_shm_) {
+        set_use_shm(settings.use_shm);
+    }
+    if (settings.use_mirror != is_using_mirror()) {
+        set_use_mirror(settings.use_mirror);
+    }
+    if (settings.output_format != image_encoder_.get_format()) {
+        image_encoder_.set_format(settings.output_format);
+    }
+    image_encoder_.set_quality(settings.quality);
+    // A preset resets the level, so the level goes second
+    if (settings.png_preset != image_encoder_.png().get_preset()) {
+        image_encoder_.png().set_preset(settings.png_preset);
+    }
+    image_encoder_.png().set_compression_level(settings.png_compression_level);
+    scale_filter_ = settings.scale_filter;
+}
+
+bool X11ScreenCapturer::capture_window_raw(const WindowInfo& window, RawImage& raw) {
+    XImage* image = capture_window_image(window);
+    if (!image) {
+        std::cerr << "❌ Failed to capture window image" << std::endl;
+        return false;
+    }
     
-    // Copy image data to Cairo surface
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            unsigned long pixel = XGetPixel(image, x, y);
-            
-            // X11 returns pixel values in platform's native format, need to extract ARGB
-            unsigned char a = 0xFF; // Fully opaque
-            unsigned char r = (pixel >> 16) & 0xFF;
-            unsigned char g = (pixel >> 8) & 0xFF;
-            unsigned char b = pixel & 0xFF;
-            
-            // Cairo uses premultiplied alpha in ARGB format
-            unsigned char* p = data + y * stride + x * 4;
-            p[0] = b;
-            p[1] = g;
-            p[2] = r;
-            p[3] = a;
+    bool result = to_raw_image(image, raw);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_screen_raw(int screen_number, RawImage& raw) {
+    XImage* image = capture_screen_image(screen_number);
+    if (!image) {
+        std::cerr << "❌ Failed to capture screen image" << std::endl;
+        return false;
+    }
+    
+    bool result = to_raw_image(image, raw);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_window_encoded(const WindowInfo& window, EncodedImage& encoded,
+                                               const ImageScaler::Limits& limits) {
+    XImage* image = capture_window_image(window);
+    if (!image) {
+        std::cerr << "❌ Failed to capture window image" << std::endl;
+        return false;
+    }
+    
+    bool result = encode_captured_image(image, encoded, limits);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_screen_encoded(int screen_number, EncodedImage& encoded,
+                                               const ImageScaler::Limits& limits) {
+    XImage* image = capture_screen_image(screen_number);
+    if (!image) {
+        std::cerr << "❌ Failed to capture screen image" << std::endl;
+        return false;
+    }
+    
+    bool result = encode_captured_image(image, encoded, limits);
+    release_image(image);
+    return result;
+}
+
+XImage* X11ScreenCapturer::capture_region_image(const CaptureRect& region) {
+    if (!display) {
+        std::cerr << "❌ No X display connection" << std::endl;
+        return nullptr;
+    }
+    
+    int screen = DefaultScreen(display);
+    CaptureRect area = region;
+    if (!clip_region(area, DisplayWidth(display, screen), DisplayHeight(display, screen))) {
+        std::cerr << "❌ Region " << region.width << "x" << region.height << " at (" << region.x << ","
+                  << region.y << ") lies outside the desktop" << std::endl;
+        return nullptr;
+    }
+    
+    if (log_captures_) {
+        std::cout << "📸 Capturing region at (" << area.x << "," << area.y << ") with size "
+                  << area.width << "x" << area.height << std::endl;
+    }
+    
+    // Served from the mirror like screen captures when it is running
+    bool from_mirror = false;
+    if (mirror_ && mirror_->is_running()) {
+        from_mirror = mirror_->sync([this]() { pump_x11_events(); });
+        if (!from_mirror) {
+            std::cerr << "⚠️ Screen mirror out of date, grabbing from the server" << std::endl;
+        }
+    }
+    
+    XImage* image = grab_screen_area(area.x, area.y, area.width, area.height, from_mirror);
+    if (!image) {
+        std::cerr << "❌ Failed to capture region" << std::endl;
+    }
+    return image;
+}
+
+XImage* X11ScreenCapturer::capture_window_region_image(const WindowInfo& window, const CaptureRect& region) {
+    if (!display) {
+        std::cerr << "❌ No X display connection" << std::endl;
+        return nullptr;
+    }
+    
+    // The rectangle is clipped to the window's current size
+    pump_x11_events();
+    CompositeWindowCache::WindowPixmap named;
+    bool has_pixmap = composite_cache_->get(window.id, named);
+    CaptureRect area = region;
+    if (!clip_region(area, has_pixmap ? named.width : window.width,
+                     has_pixmap ? named.height : window.height)) {
+        std::cerr << "❌ Region " << region.width << "x" << region.height << " at (" << region.x << ","
+                  << region.y << ") lies outside window \"" << window.title << "\"" << std::endl;
+        return nullptr;
+    }
+    
+    if (has_pixmap) {
+        if (log_captures_) {
+            std::cout << "📸 Capturing region at (" << area.x << "," << area.y << ") with size "
+                      << area.width << "x" << area.height << " of window \"" << window.title << "\"" << std::endl;
+        }
+        
+        // Only the rectangle of the window pixmap, even when it is covered
+        XImage* image = grab_image(named.pixmap, named.visual, named.depth,
+                                   area.x, area.y, area.width, area.height);
+        if (image) {
+            return image;
         }
+        composite_cache_->invalidate(window.id);
+        std::cerr << "⚠️ Failed to get window region from pixmap, falling back to root window method" << std::endl;
     }
     
-    // Mark the surface as dirty after modification
-    cairo_surface_mark_dirty(surface);
+    // The same rectangle where the window is on the desktop
+    CaptureRect desktop_area{window.x + area.x, window.y + area.y, area.width, area.height};
+    return capture_region_image(desktop_area);
+}
+
+bool X11ScreenCapturer::capture_region_raw(const CaptureRect& region, RawImage& raw) {
+    XImage* image = capture_region_image(region);
+    if (!image) {
+        return false;
+    }
     
-    // Ensure directory exists
-    std::string dir_path = filename.substr(0, filename.find_last_of('/'));
-    if (!dir_path.empty()) {
-        std::string mkdir_cmd = "mkdir -p " + dir_path;
-        system(mkdir_cmd.c_str());
+    bool result = to_raw_image(image, raw);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_window_region_raw(const WindowInfo& window, const CaptureRect& region,
+                                                  RawImage& raw) {
+    XImage* image = capture_window_region_image(window, region);
+    if (!image) {
+        return false;
     }
     
-    // Write to PNG
-    cairo_status_t status = cairo_surface_write_to_png(surface, filename.c_str());
+    bool result = to_raw_image(image, raw);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_region_encoded(const CaptureRect& region, EncodedImage& encoded,
+                                               const ImageScaler::Limits& limits) {
+    XImage* image = capture_region_image(region);
+    if (!image) {
+        return false;
+    }
     
-    // Clean up
-    cairo_surface_destroy(surface);
+    bool result = encode_captured_image(image, encoded, limits);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::capture_window_region_encoded(const WindowInfo& window, const CaptureRect& region,
+                                                      EncodedImage& encoded,
+                                                      const ImageScaler::Limits& limits) {
+    XImage* image = capture_window_region_image(window, region);
+    if (!image) {
+        return false;
+    }
     
-    if (status != CAIRO_STATUS_SUCCESS) {
-        std::cerr << "❌ Failed to write image to PNG: " << cairo_status_to_string(status) << std::endl;
+    bool result = encode_captured_image(image, encoded, limits);
+    release_image(image);
+    return result;
+}
+
+bool X11ScreenCapturer::clip_region(CaptureRect& region, int width, int height) {
+    long left = std::max(region.x, 0);
+    long top = std::max(region.y, 0);
+    long right = std::min(static_cast<long>(region.x) + region.width, static_cast<long>(width));
+    long bottom = std::min(static_cast<long>(region.y) + region.height, static_cast<long>(height));
+    if (right <= left || bottom <= top) {
         return false;
     }
     
-    std::cout << "✅ Image saved to PNG: " << filename << std::endl;
+    region.x = static_cast<int>(left);
+    region.y = static_cast<int>(top);
+    region.width = static_cast<unsigned int>(right - left);
+    region.height = static_cast<unsigned int>(bottom - top);
+    return true;
+}
+
+bool X11ScreenCapturer::capture_monitors_raw(std::vector<MonitorImage>& monitors) {
+    if (!display) {
+        std::cerr << "❌ No X display connection" << std::endl;
+        return false;
+    }
+    
+    std::vector<ScreenInfo> screens = detect_screens();
+    screens.erase(std::remove_if(screens.begin(), screens.end(),
+                                 [](const ScreenInfo& screen) { return screen.number < 0; }),
+                  screens.end());
+    if (screens.empty()) {
+        std::cerr << "❌ No monitors found" << std::endl;
+        return false;
+    }
+    
+    bool from_mirror = false;
+    if (mirror_ && mirror_->is_running()) {
+        from_mirror = mirror_->sync([this]() { pump_x11_events(); });
+        if (!from_mirror) {
+            std::cerr << "⚠️ Screen mirror out of date, grabbing from the server" << std::endl;
+        }
+    }
+    
+    // The server handles grabs one at a time anyway, so they are issued back
+    // to back on this connection, each into its own shared memory segment
+    std::vector<XImage*> images(screens.size(), nullptr);
+    bool ok = true;
+    for (size_t i = 0; i < screens.size(); ++i) {
+        const ScreenInfo& screen = screens[i];
+        images[i] = grab_screen_area(screen.x, screen.y, screen.width, screen.height, from_mirror);
+        if (!images[i]) {
+            std::cerr << "❌ Failed to capture monitor " << screen.name << std::endl;
+            ok = false;
+            break;
+        }
+    }
+    
+    if (ok) {
+        monitors.resize(screens.size());
+        std::vector<std::future<void>> pending;
+        std::vector<char> converted(screens.size(), 0);
+        for (size_t i = 0; i < screens.size(); ++i) {
+            monitors[i].screen = screens[i];
+            monitors[i].encoded = EncodedImage();
+            pending.push_back(monitor_pool().submit([&images, &monitors, &converted, i]() {
+                converted[i] = to_raw_image(images[i], monitors[i].raw) ? 1 : 0;
+            }));
+        }
+        for (auto& task : pending) {
+            task.get();
+        }
+        ok = std::all_of(converted.begin(), converted.end(), [](char c) { return c != 0; });
+    }
+    
+    for (XImage* image : images) {
+        release_image(image);
+    }
+    
+    if (ok && log_captures_) {
+        std::cout << "✅ Captured " << monitors.size() << " monitors" << std::endl;
+    }
+    return ok;
+}
+
+bool X11ScreenCapturer::capture_monitors_encoded(std::vector<MonitorImage>& monitors,
+                                                 const ImageScaler::Limits& limits) {
+    if (!capture_monitors_raw(monitors)) {
+        return false;
+    }
+    
+    std::vector<std::future<void>> pending;
+    std::vector<char> encoded(monitors.size(), 0);
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        pending.push_back(monitor_pool().submit([this, &monitors, &encoded, &limits, i]() {
+            encoded[i] = encode_image(monitors[i].raw, monitors[i].encoded, limits) ? 1 : 0;
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+    
+    return std::all_of(encoded.begin(), encoded.end(), [](char c) { return c != 0; });
+}
+
+XImage* X11ScreenCapturer::grab_screen_area(int x, int y, unsigned int width, unsigned int height,
+                                            bool from_mirror) {
+    if (from_mirror && mirror_) {
+        XImage* image = mirror_->copy_area(x, y, width, height);
+        if (image) {
+            return image;
+        }
+    }
+    
+    int screen = DefaultScreen(display);
+    return grab_image(DefaultRootWindow(display), DefaultVisual(display, screen),
+                      DefaultDepth(display, screen), x, y, width, height);
+}
+
+bool X11ScreenCapturer::encode_captured_image(XImage* image, EncodedImage& encoded,
+                                              const ImageScaler::Limits& limits,
+                                              const std::string& format) {
+    // The raw buffer is reused between captures of the same size
+    static thread_local RawImage raw;
+    if (!to_raw_image(image, raw)) {
+        return false;
+    }
+    if (format.empty()) {
+        return encode_image(raw, encoded, limits);
+    }
+    return image_encoder_.encode(raw, format, encoded);
+}
+
+bool X11ScreenCapturer::to_raw_image(const XImage* image, RawImage& raw) {
+    if (!image) {
+        std::cerr << "❌ No image to convert" << std::endl;
+        return false;
+    }
+    
+    // Convert image data to Cairo's ARGB32 layout (opaque, so no premultiplication needed)
+    PixelConverter converter(image);
+    if (!converter.is_valid()) {
+        std::cerr << "❌ Unsupported image format: depth " << image->depth
+                  << ", " << image->bits_per_pixel << " bits per pixel" << std::endl;
+        return false;
+    }
+    
+    raw.resize(image->width, image->height);
+    converter.convert(image, raw.pixels.data(), raw.stride);
+    return true;
+}
+
+bool X11ScreenCapturer::encode_image(const RawImage& raw, EncodedImage& encoded,
+                                     const ImageScaler::Limits& limits) {
+    // The scaled buffer is reused like the raw one; monitors scale in parallel
+    static thread_local RawImage scaled;
+    if (ImageScaler::scale_to_fit(raw, scaled, limits, scale_filter_)) {
+        if (log_captures_) {
+            std::cout << "📐 Scaled " << raw.width << "x" << raw.height << " to "
+                      << scaled.width << "x" << scaled.height << " ("
+                      << ImageScaler::filter_name(scale_filter_) << ", "
+                      << ImageScaler::kernel_name() << ")" << std::endl;
+        }
+        return image_encoder_.encode(scaled, encoded);
+    }
+    return image_encoder_.encode(raw, encoded);
+}
+
+bool X11ScreenCapturer::set_output_format(const std::string& format) {
+    return image_encoder_.set_format(format);
+}
+
+std::string X11ScreenCapturer::get_output_format() const {
+    return image_encoder_.get_format();
+}
+
+void X11ScreenCapturer::set_quality(int quality) {
+    image_encoder_.set_quality(quality);
+}
+
+int X11ScreenCapturer::get_quality() const {
+    return image_encoder_.get_quality();
+}
+
+void X11ScreenCapturer::set_png_preset(PngEncoder::Preset preset) {
+    image_encoder_.png().set_preset(preset);
+}
+
+void X11ScreenCapturer::set_png_compression_level(int level) {
+    image_encoder_.png().set_compression_level(level);
+}
+
+PngEncoder::Preset X11ScreenCapturer::get_png_preset() const {
+    return image_encoder_.png().get_preset();
+}
+
+bool X11ScreenCapturer::save_image(XImage* image, const std::string& filename) {
+    // Unknown extensions get the configured output format
+    EncodedImage encoded;
+    if (!encode_captured_image(image, encoded, ImageScaler::Limits(), ImageFormat::from_path(filename))) {
+        return false;
+    }
+    
+    try {
+        // Ensure directory exists
+        std::filesystem::path target(filename);
+        if (target.has_parent_path()) {
+            std::filesystem::create_directories(target.parent_path());
+        }
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << "❌ Failed to create capture directory: " << e.what() << std::endl;
+        return false;
+    }
+    
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(encoded.data.data()), encoded.data.size());
+    if (!file) {
+        std::cerr << "❌ Failed to write image: " << filename << std::endl;
+        return false;
+    }
+    
+    std::cout << "✅ Image saved as " << encoded.format << ": " << filename << std::endl;
     return true;
 }
 
@@ -454,10 +961,8 @@ bool X11ScreenCapturer::start_window_events_monitoring() {
     // Register for window property change and structure notifications
     register_for_window_events();
     
-    // Start a timer to check for X11 events
-    event_check_connection_ = Glib::signal_timeout().connect(
-        sigc::mem_fun(*this, &X11ScreenCapturer::process_x11_events),
-        100); // Check every 100ms
+    // Handle X11 events as soon as they arrive on the connection
+    connection_->start_dispatching();
     
     monitoring_window_events_ = true;
     std::cout << "✅ Started monitoring window events" << std::endl;
@@ -470,12 +975,16 @@ void X11ScreenCapturer::stop_window_events_monitoring() {
         return;
     }
     
-    // Disconnect the event check timer
-    if (event_check_connection_.connected()) {
-        event_check_connection_.disconnect();
+    for (int id : window_event_subscriptions_) {
+        connection_->unsubscribe(id);
     }
+    window_event_subscriptions_.clear();
     
     monitoring_window_events_ = false;
+    
+    // Without events the table would go stale
+    window_table_valid_ = false;
+    window_table_.clear();
     std::cout << "✅ Stopped monitoring window events" << std::endl;
 }
 
@@ -490,74 +999,336 @@ void X11ScreenCapturer::register_for_window_events() {
     
     Window root = DefaultRootWindow(display);
     
-    // Select events on the root window
-    XSelectInput(display, root, SubstructureNotifyMask | PropertyChangeMask);
+    // Select events on the root window, next to those of the other
+    // components sharing the connection
+    connection_->select_input(root, SubstructureNotifyMask | PropertyChangeMask);
     
-    // Also select events on all existing windows
+    // Structure events come from the root and from the windows themselves,
+    // property changes from the windows
+    for (int type : {CreateNotify, DestroyNotify, ReparentNotify, MapNotify,
+                     UnmapNotify, ConfigureNotify, PropertyNotify}) {
+        window_event_subscriptions_.push_back(connection_->subscribe(type, 0, [this](XEvent& event) {
+            handle_window_event(event);
+        }));
+    }
+    
+    // Scan the existing windows once; events keep the table current from here on
+    rebuild_window_table();
+}
+
+void X11ScreenCapturer::rebuild_window_table() {
+    window_table_.clear();
+    window_table_valid_ = false;
+    window_table_client_list_ = false;
+    
+    // Title and structure events are selected on every window during the scan
+    if (window_scanner_->is_available()) {
+        std::vector<WindowInfo> scanned;
+        if (window_scanner_->scan(scanned, PropertyChangeMask | StructureNotifyMask)) {
+            for (const auto& info : scanned) {
+                window_table_[info.id] = info;
+            }
+            window_table_client_list_ = window_scanner_->used_client_list();
+            window_table_valid_ = true;
+        }
+        return;
+    }
+    
+    Window root = DefaultRootWindow(display);
     Window root_return, parent_return;
     Window* children;
     unsigned int num_children;
     
+    // Windows may disappear while they are being scanned
+    X11ErrorTrap trap(display);
+    
     if (XQueryTree(display, root, &root_return, &parent_return, &children, &num_children)) {
         for (unsigned int i = 0; i < num_children; i++) {
-            XSelectInput(display, children[i], PropertyChangeMask | StructureNotifyMask);
+            // Also select events on all existing windows (title changes)
+            connection_->select_input(children[i], PropertyChangeMask | StructureNotifyMask);
+            
+            WindowInfo info;
+            if (get_window_info(children[i], info)) {
+                window_table_[children[i]] = info;
+            }
         }
         XFree(children);
+        window_table_valid_ = true;
     }
     
-    // Flush to ensure events are registered
-    XFlush(display);
+    XSync(display, False);
 }
 
-bool X11ScreenCapturer::process_x11_events() {
-    if (!display || !monitoring_window_events_) {
-        return false;  // Stop this timer
-    }
+bool X11ScreenCapturer::update_window_table(const XEvent& event, std::vector<Window>& new_windows,
+                                            std::vector<Window>& stale_titles, bool& rescan) {
+    Window root = DefaultRootWindow(display);
     
-    bool window_list_changed = false;
+    // Structure events arrive twice for top-level windows (through the root
+    // and through the window itself). Without a client list the root copies
+    // drive the table. With one, the listed windows usually sit inside window
+    // manager frames, so their own copies are used as well; handling both
+    // copies of an event is harmless.
+    auto is_tracked = [&](Window event_window, Window window) {
+        return event_window == root || (window_table_client_list_ && event_window == window);
+    };
     
-    // Check for pending X events
-    while (XPending(display)) {
-        XEvent event;
-        XNextEvent(display, &event);
+    switch (event.type) {
+        case CreateNotify: {
+            // The window manager announces its clients through _NET_CLIENT_LIST
+            if (window_table_client_list_ || event.xcreatewindow.parent != root) {
+                return false;
+            }
+            WindowInfo info{};
+            info.id = event.xcreatewindow.window;
+            info.x = event.xcreatewindow.x;
+            info.y = event.xcreatewindow.y;
+            info.width = event.xcreatewindow.width;
+            info.height = event.xcreatewindow.height;
+            info.has_decorations = false;
+            info.is_visible = false;
+            // New windows are unmapped; the title is fetched when they are shown
+            window_table_[info.id] = info;
+            new_windows.push_back(info.id);
+            return false;
+        }
+        
+        case DestroyNotify: {
+            if (!is_tracked(event.xdestroywindow.event, event.xdestroywindow.window)) {
+                return false;
+            }
+            auto it = window_table_.find(event.xdestroywindow.window);
+            if (it == window_table_.end()) {
+                return false;
+            }
+            bool listed = is_listed(it->second);
+            window_table_.erase(it);
+            return listed;
+        }
+        
+        case ReparentNotify: {
+            // Clients stay listed when they are framed
+            if (window_table_client_list_) {
+                return false;
+            }
+            Window window = event.xreparent.window;
+            if (event.xreparent.parent == root) {
+                // Became top-level (e.g. its window manager frame went away)
+                WindowInfo info{};
+                info.id = window;
+                info.x = event.xreparent.x;
+                info.y = event.xreparent.y;
+                info.has_decorations = false;
+                info.is_visible = false;
+                window_table_[window] = info;
+                new_windows.push_back(window);
+                return false;
+            }
+            // Moved into a frame, no longer top-level
+            auto it = window_table_.find(window);
+            if (it == window_table_.end()) {
+                return false;
+            }
+            bool listed = is_listed(it->second);
+            window_table_.erase(it);
+            return listed;
+        }
+        
+        case MapNotify: {
+            if (!is_tracked(event.xmap.event, event.xmap.window)) {
+                return false;
+            }
+            auto it = window_table_.find(event.xmap.window);
+            if (it == window_table_.end()) {
+                return false;
+            }
+            it->second.is_visible = true;
+            stale_titles.push_back(event.xmap.window);
+            return is_listed(it->second);
+        }
+        
+        case UnmapNotify: {
+            if (!is_tracked(event.xunmap.event, event.xunmap.window)) {
+                return false;
+            }
+            auto it = window_table_.find(event.xunmap.window);
+            if (it == window_table_.end()) {
+                return false;
+            }
+            bool listed = is_listed(it->second);
+            it->second.is_visible = false;
+            return listed;
+        }
+        
+        case ConfigureNotify: {
+            if (!is_tracked(event.xconfigure.event, event.xconfigure.window)) {
+                return false;
+            }
+            auto it = window_table_.find(event.xconfigure.window);
+            if (it == window_table_.end()) {
+                return false;
+            }
+            WindowInfo& info = it->second;
+            bool resized = info.width != static_cast<unsigned int>(event.xconfigure.width) ||
+                           info.height != static_cast<unsigned int>(event.xconfigure.height);
+            // A framed client's own position is relative to its frame; the
+            // window manager sends a synthetic event with root coordinates
+            if (event.xconfigure.event == root || event.xconfigure.send_event) {
+                info.x = event.xconfigure.x;
+                info.y = event.xconfigure.y;
+            }
+            info.width = event.xconfigure.width;
+            info.height = event.xconfigure.height;
+            // The list shows sizes, not positions
+            return resized && is_listed(info);
+        }
         
-        // Handle different event types
-        switch (event.type) {
-            case CreateNotify:
-                std::cout << "🪟 Window created: " << event.xcreatewindow.window << std::endl;
-                window_list_changed = true;
-                break;
-                
-            case DestroyNotify:
-                std::cout << "🪟 Window destroyed: " << event.xdestroywindow.window << std::endl;
-                window_list_changed = true;
-                break;
-                
-            case PropertyNotify:
-                // Only care about property changes that would affect the window list
-                if (event.xproperty.atom == XInternAtom(display, "WM_NAME", False) ||
-                    event.xproperty.atom == XInternAtom(display, "_NET_WM_NAME", False)) {
-                    std::cout << "🪟 Window title changed" << std::endl;
-                    window_list_changed = true;
+        case PropertyNotify:
+            // The window manager added or removed clients
+            if (event.xproperty.window == root) {
+                if (event.xproperty.atom == window_scanner_->client_list_atom()) {
+                    rescan = true;
                 }
-                break;
-                
-            case MapNotify:
-                std::cout << "🪟 Window mapped (shown): " << event.xmap.window << std::endl;
-                window_list_changed = true;
-                break;
-                
-            case UnmapNotify:
-                std::cout << "🪟 Window unmapped (hidden): " << event.xunmap.window << std::endl;
-                window_list_changed = true;
-                break;
+                return false;
+            }
+            // Only care about property changes that would affect the window list
+            if ((event.xproperty.atom == wm_name_atom_ || event.xproperty.atom == net_wm_name_atom_) &&
+                window_table_.count(event.xproperty.window)) {
+                stale_titles.push_back(event.xproperty.window);
+            }
+            return false;
+            
+        default:
+            return false;
+    }
+}
+
+bool X11ScreenCapturer::refresh_window_table(const std::vector<Window>& new_windows,
+                                             const std::vector<Window>& stale_titles) {
+    if (new_windows.empty() && stale_titles.empty()) {
+        return false;
+    }
+    
+    bool changed = false;
+    
+    // Titles are fetched once per batch, however many events asked for them
+    std::vector<Window> windows(stale_titles);
+    std::sort(windows.begin(), windows.end());
+    windows.erase(std::unique(windows.begin(), windows.end()), windows.end());
+    
+    if (window_scanner_->is_available()) {
+        window_scanner_->select_events(new_windows, PropertyChangeMask | StructureNotifyMask);
+        
+        std::vector<std::string> titles;
+        window_scanner_->fetch_titles(windows, titles);
+        for (size_t i = 0; i < windows.size(); ++i) {
+            auto it = window_table_.find(windows[i]);
+            // Empty if the window is already gone again
+            if (it == window_table_.end() || titles[i].empty()) {
+                continue;
+            }
+            bool was_listed = is_listed(it->second);
+            std::string old_title = it->second.title;
+            it->second.title = titles[i];
+            if (was_listed != is_listed(it->second) ||
+                (was_listed && old_title != it->second.title)) {
+                changed = true;
+            }
         }
+        return changed;
     }
     
+    // Any of these windows may already be gone again
+    X11ErrorTrap trap(display);
+    
+    for (Window window : new_windows) {
+        connection_->select_input(window, PropertyChangeMask | StructureNotifyMask);
+    }
+    
+    for (Window window : windows) {
+        auto it = window_table_.find(window);
+        if (it == window_table_.end()) {
+            continue;
+        }
+        bool was_listed = is_listed(it->second);
+        std::string old_title = it->second.title;
+        
+        char* window_name = nullptr;
+        if (XFetchName(display, window, &window_name) && window_name) {
+            it->second.title = window_name;
+            XFree(window_name);
+        } else {
+            XTextProperty text_prop;
+            if (XGetWMName(display, window, &text_prop) && text_prop.value) {
+                it->second.title = reinterpret_cast<char*>(text_prop.value);
+                XFree(text_prop.value);
+            } else {
+                it->second.title = "[Unnamed Window]";
+            }
+        }
+        
+        if (was_listed != is_listed(it->second) ||
+            (was_listed && old_title != it->second.title)) {
+            changed = true;
+        }
+    }
+    
+    XSync(display, False);
+    return changed;
+}
+
+void X11ScreenCapturer::pump_x11_events() {
+    // Dispatches to our handlers, then finishes the batch
+    connection_->dispatch_pending();
+}
+
+void X11ScreenCapturer::handle_window_event(XEvent& event) {
+    if (window_table_valid_) {
+        if (update_window_table(event, new_windows_, stale_titles_, rescan_windows_)) {
+            window_list_changed_ = true;
+        }
+        return;
+    }
+    
+    // Without a table, any structure change may affect the list
+    switch (event.type) {
+        case CreateNotify:
+        case DestroyNotify:
+        case MapNotify:
+        case UnmapNotify:
+            window_list_changed_ = true;
+            break;
+            
+        case PropertyNotify:
+            if (event.xproperty.atom == wm_name_atom_ || event.xproperty.atom == net_wm_name_atom_) {
+                window_list_changed_ = true;
+            }
+            break;
+    }
+}
+
+void X11ScreenCapturer::finish_event_batch() {
+    // A new client list is cheaper to rescan than to diff
+    if (rescan_windows_) {
+        rebuild_window_table();
+        window_list_changed_ = true;
+    } else if (window_table_valid_ && refresh_window_table(new_windows_, stale_titles_)) {
+        // Titles and event selection for windows seen in this batch, under one sync
+        window_list_changed_ = true;
+    }
+    new_windows_.clear();
+    stale_titles_.clear();
+    rescan_windows_ = false;
+    
     // Emit signal if window list changed
-    if (window_list_changed) {
+    if (window_list_changed_) {
+        window_list_changed_ = false;
+        std::cout << "🪟 Window list changed" << std::endl;
         m_signal_window_list_changed.emit();
     }
     
-    return true;  // Continue this timer
-}
\ No newline at end of file
+    if (screens_changed_) {
+        screens_changed_ = false;
+        std::cout << "🖥️ Screen configuration changed" << std::endl;
+        m_signal_screens_changed.emit();
+    }
+}
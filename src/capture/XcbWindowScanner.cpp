@@ -0,0 +1,213 @@
+#include "../../include/XcbWindowScanner.h"
+#include "../../include/X11Connection.h"
+#include <X11/Xlib-xcb.h>
+#include <iostream>
+#include <cstdlib>
+
+XcbWindowScanner::XcbWindowScanner(X11Connection& connection) :
+    x11_(connection),
+    connection_(nullptr),
+    root_(0),
+    client_list_atom_(XCB_ATOM_NONE),
+    net_wm_name_atom_(XCB_ATOM_NONE),
+    utf8_string_atom_(XCB_ATOM_NONE),
+    used_client_list_(false) {
+
+    Display* display = connection.display();
+    if (!display) {
+        return;
+    }
+
+    connection_ = XGetXCBConnection(display);
+    if (!connection_) {
+        std::cerr << "⚠️ No XCB connection, window scans use Xlib" << std::endl;
+        return;
+    }
+    root_ = DefaultRootWindow(display);
+
+    client_list_atom_ = connection.atom(X11Connection::NET_CLIENT_LIST);
+    net_wm_name_atom_ = connection.atom(X11Connection::NET_WM_NAME);
+    utf8_string_atom_ = connection.atom(X11Connection::UTF8_STRING);
+}
+
+// Property value as a string, empty if unset
+static std::string property_string(xcb_get_property_reply_t* reply) {
+    if (!reply || reply->format != 8) {
+        return "";
+    }
+    int length = xcb_get_property_value_length(reply);
+    const char* value = static_cast<const char*>(xcb_get_property_value(reply));
+    // Some clients include the terminating NUL
+    while (length > 0 && value[length - 1] == '\0') {
+        --length;
+    }
+    return std::string(value, length);
+}
+
+bool XcbWindowScanner::scan(std::vector<X11ScreenCapturer::WindowInfo>& windows, uint32_t event_mask) {
+    windows.clear();
+    if (!connection_) {
+        return false;
+    }
+
+    // Round trip 1: the client list and the root's children together
+    xcb_get_property_cookie_t client_cookie{};
+    bool has_client_atom = client_list_atom_ != XCB_ATOM_NONE;
+    if (has_client_atom) {
+        client_cookie = xcb_get_property(connection_, 0, root_, client_list_atom_,
+                                         XCB_ATOM_WINDOW, 0, 16384);
+    }
+    xcb_query_tree_cookie_t tree_cookie = xcb_query_tree(connection_, root_);
+
+    std::vector<xcb_window_t> ids;
+    used_client_list_ = false;
+    if (has_client_atom) {
+        xcb_get_property_reply_t* reply = xcb_get_property_reply(connection_, client_cookie, nullptr);
+        if (reply && reply->format == 32 && reply->value_len > 0) {
+            auto* value = static_cast<xcb_window_t*>(xcb_get_property_value(reply));
+            ids.assign(value, value + reply->value_len);
+            used_client_list_ = true;
+        }
+        std::free(reply);
+    }
+
+    xcb_query_tree_reply_t* tree = xcb_query_tree_reply(connection_, tree_cookie, nullptr);
+    if (!tree) {
+        std::cerr << "❌ Failed to query window tree" << std::endl;
+        return false;
+    }
+    if (!used_client_list_) {
+        xcb_window_t* children = xcb_query_tree_children(tree);
+        ids.assign(children, children + xcb_query_tree_children_length(tree));
+    }
+    std::free(tree);
+
+    // Round trip 2: every request for every window, then all the replies.
+    // Errors for windows destroyed in between come back as null replies.
+    struct Pending {
+        xcb_get_window_attributes_cookie_t attributes;
+        xcb_get_geometry_cookie_t geometry;
+        xcb_translate_coordinates_cookie_t position;
+        xcb_get_property_cookie_t net_wm_name;
+        xcb_get_property_cookie_t wm_name;
+        xcb_void_cookie_t select;
+        bool selecting;
+    };
+    std::vector<Pending> pending(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        xcb_window_t id = ids[i];
+        Pending& p = pending[i];
+        p.attributes = xcb_get_window_attributes(connection_, id);
+        p.geometry = xcb_get_geometry(connection_, id);
+        p.position = xcb_translate_coordinates(connection_, id, root_, 0, 0);
+        p.net_wm_name = xcb_get_property(connection_, 0, id, net_wm_name_atom_,
+                                         utf8_string_atom_, 0, 1024);
+        p.wm_name = xcb_get_property(connection_, 0, id, XCB_ATOM_WM_NAME,
+                                     XCB_GET_PROPERTY_TYPE_ANY, 0, 1024);
+        // The request replaces the whole mask, so it carries the events
+        // other components selected too
+        long mask = 0;
+        p.selecting = event_mask && x11_.merge_input(id, event_mask, mask);
+        if (p.selecting) {
+            uint32_t value = static_cast<uint32_t>(mask);
+            p.select = xcb_change_window_attributes_checked(connection_, id, XCB_CW_EVENT_MASK, &value);
+        }
+    }
+
+    windows.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        Pending& p = pending[i];
+        xcb_get_window_attributes_reply_t* attributes =
+            xcb_get_window_attributes_reply(connection_, p.attributes, nullptr);
+        xcb_get_geometry_reply_t* geometry = xcb_get_geometry_reply(connection_, p.geometry, nullptr);
+        xcb_translate_coordinates_reply_t* position =
+            xcb_translate_coordinates_reply(connection_, p.position, nullptr);
+        xcb_get_property_reply_t* net_wm_name = xcb_get_property_reply(connection_, p.net_wm_name, nullptr);
+        xcb_get_property_reply_t* wm_name = xcb_get_property_reply(connection_, p.wm_name, nullptr);
+        if (p.selecting) {
+            // Errors for vanished windows are dropped here instead of reaching Xlib
+            std::free(xcb_request_check(connection_, p.select));
+        }
+
+        if (attributes && geometry) {
+            X11ScreenCapturer::WindowInfo info;
+            info.id = ids[i];
+            info.x = position ? position->dst_x : geometry->x;
+            info.y = position ? position->dst_y : geometry->y;
+            info.width = geometry->width;
+            info.height = geometry->height;
+            info.is_visible = (attributes->map_state == XCB_MAP_STATE_VIEWABLE);
+            info.has_decorations = false;
+
+            info.title = property_string(net_wm_name);
+            if (info.title.empty()) {
+                info.title = property_string(wm_name);
+            }
+            if (info.title.empty()) {
+                info.title = "[Unnamed Window]";
+            }
+            windows.push_back(info);
+        }
+
+        std::free(attributes);
+        std::free(geometry);
+        std::free(position);
+        std::free(net_wm_name);
+        std::free(wm_name);
+    }
+
+    return true;
+}
+
+void XcbWindowScanner::fetch_titles(const std::vector<Window>& windows, std::vector<std::string>& titles) {
+    titles.assign(windows.size(), "");
+    if (!connection_) {
+        return;
+    }
+
+    std::vector<std::pair<xcb_get_property_cookie_t, xcb_get_property_cookie_t>> pending;
+    pending.reserve(windows.size());
+    for (Window window : windows) {
+        pending.emplace_back(
+            xcb_get_property(connection_, 0, window, net_wm_name_atom_, utf8_string_atom_, 0, 1024),
+            xcb_get_property(connection_, 0, window, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, 1024));
+    }
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        xcb_generic_error_t* error = nullptr;
+        xcb_get_property_reply_t* net_wm_name = xcb_get_property_reply(connection_, pending[i].first, &error);
+        xcb_get_property_reply_t* wm_name = xcb_get_property_reply(connection_, pending[i].second, nullptr);
+        if (!error) {
+            titles[i] = property_string(net_wm_name);
+            if (titles[i].empty()) {
+                titles[i] = property_string(wm_name);
+            }
+            if (titles[i].empty()) {
+                titles[i] = "[Unnamed Window]";
+            }
+        }
+        std::free(error);
+        std::free(net_wm_name);
+        std::free(wm_name);
+    }
+}
+
+void XcbWindowScanner::select_events(const std::vector<Window>& windows, uint32_t event_mask) {
+    if (!connection_ || windows.empty()) {
+        return;
+    }
+
+    std::vector<xcb_void_cookie_t> pending;
+    pending.reserve(windows.size());
+    for (Window window : windows) {
+        long mask = 0;
+        if (x11_.merge_input(window, event_mask, mask)) {
+            uint32_t value = static_cast<uint32_t>(mask);
+            pending.push_back(xcb_change_window_attributes_checked(connection_, window,
+                                                                   XCB_CW_EVENT_MASK, &value));
+        }
+    }
+    for (auto& cookie : pending) {
+        std::free(xcb_request_check(connection_, cookie));
+    }
+}
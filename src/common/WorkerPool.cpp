@@ -0,0 +1,56 @@
+#include "../../include/WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t thread_count) : stopping_(false) {
+    if (thread_count == 0) {
+        thread_count = hardware_threads();
+    }
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+std::future<void> WorkerPool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> future = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(packaged));
+    }
+    cv_.notify_one();
+    return future;
+}
+
+size_t WorkerPool::hardware_threads() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void WorkerPool::run() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,154 @@
+#include "../../include/X11Connection.h"
+#include "../../include/X11EventSource.h"
+#include <iostream>
+#include <algorithm>
+
+X11Connection::X11Connection() :
+    display_(nullptr),
+    next_subscription_id_(1),
+    dispatch_depth_(0),
+    has_removed_(false) {
+    std::fill(atoms_, atoms_ + ATOM_COUNT, None);
+
+    display_ = XOpenDisplay(nullptr);
+    if (!display_) {
+        std::cerr << "❌ Failed to open X display" << std::endl;
+        return;
+    }
+
+    // All atoms in one request instead of a round trip each
+    char* atom_names[ATOM_COUNT] = {
+        const_cast<char*>("_NET_WM_NAME"),
+        const_cast<char*>("_NET_CLIENT_LIST"),
+        const_cast<char*>("UTF8_STRING")
+    };
+    XInternAtoms(display_, atom_names, ATOM_COUNT, False, atoms_);
+}
+
+X11Connection::~X11Connection() {
+    stop_dispatching();
+
+    if (display_) {
+        XCloseDisplay(display_);
+    }
+}
+
+void X11Connection::select_input(Window window, long event_mask) {
+    if (!display_) {
+        return;
+    }
+
+    long mask = 0;
+    if (merge_input(window, event_mask, mask)) {
+        XSelectInput(display_, window, mask);
+    }
+}
+
+bool X11Connection::merge_input(Window window, long event_mask, long& mask) {
+    long& selected = event_masks_[window];
+    mask = selected | event_mask;
+    if (mask == selected) {
+        return false;
+    }
+    selected = mask;
+    return true;
+}
+
+int X11Connection::subscribe(int event_type, Window window, EventHandler handler) {
+    int id = next_subscription_id_++;
+    subscriptions_[event_type].push_back(Subscription{id, window, std::move(handler)});
+    return id;
+}
+
+void X11Connection::unsubscribe(int id) {
+    for (auto& [type, subscriptions] : subscriptions_) {
+        for (auto& subscription : subscriptions) {
+            if (subscription.id == id) {
+                // Erased later, a dispatch may be iterating over this list
+                subscription.handler = nullptr;
+                has_removed_ = true;
+                if (dispatch_depth_ == 0) {
+                    remove_unsubscribed();
+                }
+                return;
+            }
+        }
+    }
+}
+
+void X11Connection::dispatch_pending() {
+    if (!display_) {
+        return;
+    }
+
+    ++dispatch_depth_;
+    bool dispatched = false;
+    while (XPending(display_)) {
+        XEvent event;
+        XNextEvent(display_, &event);
+        if (event.type == DestroyNotify) {
+            // The id may be reused by a window nothing is selected on
+            event_masks_.erase(event.xdestroywindow.window);
+        }
+        dispatch(event, event.type);
+        dispatch(event, ANY_EVENT_TYPE);
+        dispatched = true;
+    }
+    --dispatch_depth_;
+
+    if (dispatch_depth_ == 0 && has_removed_) {
+        remove_unsubscribed();
+    }
+
+    if (dispatched) {
+        m_signal_events_dispatched.emit();
+    }
+}
+
+void X11Connection::dispatch(XEvent& event, int event_type) {
+    auto it = subscriptions_.find(event_type);
+    if (it == subscriptions_.end()) {
+        return;
+    }
+
+    // Handlers may subscribe or unsubscribe, so entries are read by index
+    // and each handler is copied before it runs
+    std::vector<Subscription>& subscriptions = it->second;
+    for (size_t i = 0; i < subscriptions.size(); ++i) {
+        if (!subscriptions[i].handler ||
+            (subscriptions[i].window && subscriptions[i].window != event.xany.window)) {
+            continue;
+        }
+        EventHandler handler = subscriptions[i].handler;
+        handler(event);
+    }
+}
+
+void X11Connection::remove_unsubscribed() {
+    for (auto& [type, subscriptions] : subscriptions_) {
+        subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(),
+                                           [](const Subscription& subscription) {
+                                               return !subscription.handler;
+                                           }),
+                            subscriptions.end());
+    }
+    has_removed_ = false;
+}
+
+void X11Connection::start_dispatching() {
+    if (!display_ || event_source_) {
+        return;
+    }
+
+    // Events are handled as soon as they arrive on the connection
+    event_source_ = X11EventSource::create(display_);
+    event_source_->connect(sigc::mem_fun(*this, &X11Connection::dispatch_pending));
+    event_source_->attach();
+}
+
+void X11Connection::stop_dispatching() {
+    if (event_source_) {
+        event_source_->destroy();
+        event_source_.reset();
+    }
+}
@@ -0,0 +1,40 @@
+#include "../../include/X11ErrorTrap.h"
+#include <mutex>
+
+// Innermost trap open on each thread
+static thread_local X11ErrorTrap* innermost_trap = nullptr;
+
+// Handler that was installed before ours, for errors nobody trapped
+static XErrorHandler previous_handler = nullptr;
+static std::once_flag install_once;
+
+X11ErrorTrap::X11ErrorTrap(Display* display) :
+    display_(display),
+    error_code_(Success),
+    outer_(innermost_trap) {
+    install();
+    innermost_trap = this;
+}
+
+X11ErrorTrap::~X11ErrorTrap() {
+    innermost_trap = outer_;
+}
+
+void X11ErrorTrap::install() {
+    std::call_once(install_once, []() {
+        previous_handler = XSetErrorHandler(&X11ErrorTrap::handle_error);
+    });
+}
+
+int X11ErrorTrap::handle_error(Display* display, XErrorEvent* error) {
+    // Errors are read on the thread that uses the display
+    for (X11ErrorTrap* trap = innermost_trap; trap; trap = trap->outer_) {
+        if (trap->display_ == display) {
+            if (trap->error_code_ == Success) {
+                trap->error_code_ = error->error_code;
+            }
+            return 0;
+        }
+    }
+    return previous_handler ? previous_handler(display, error) : 0;
+}
@@ -0,0 +1,38 @@
+#include "../../include/X11EventSource.h"
+
+Glib::RefPtr<X11EventSource> X11EventSource::create(Display* display) {
+    return Glib::RefPtr<X11EventSource>(new X11EventSource(display));
+}
+
+X11EventSource::X11EventSource(Display* display) :
+    display_(display),
+    poll_fd_(ConnectionNumber(display), Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP) {
+    add_poll(poll_fd_);
+}
+
+sigc::connection X11EventSource::connect(const sigc::slot<void>& slot) {
+    return connect_generic(slot);
+}
+
+bool X11EventSource::prepare(int& timeout) {
+    // Only the file descriptor can wake us up
+    timeout = -1;
+
+    // Flushes queued requests and picks up events Xlib has already read
+    return XPending(display_) > 0;
+}
+
+bool X11EventSource::check() {
+    if (poll_fd_.get_revents() & (Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP)) {
+        return true;
+    }
+    return XEventsQueued(display_, QueuedAlready) > 0;
+}
+
+bool X11EventSource::dispatch(sigc::slot_base* slot) {
+    if (slot) {
+        (*static_cast<sigc::slot<void>*>(slot))();
+    }
+    // Keep the source until it is destroyed
+    return true;
+}
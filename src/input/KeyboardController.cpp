@@ -1,33 +1,25 @@
 #include "../../include/KeyboardController.h"
+#include "../../include/X11Connection.h"
+#include "../../include/X11ErrorTrap.h"
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 #include <X11/Xutil.h>
 
-// Static error handler variable to track if key grabbing fails
-static bool had_x11_error = false;
-
-// X11 error handler to catch errors without crashing
-int KeyboardController::x11_error_handler(Display* display, XErrorEvent* error) {
-    if (error->error_code == BadAccess) {
-        had_x11_error = true;
-        std::cerr << "⚠️ X11 Error: Another application has already grabbed this key" << std::endl;
-    } else {
-        char error_text[256];
-        XGetErrorText(display, error->error_code, error_text, sizeof(error_text));
-        std::cerr << "⚠️ X11 Error: " << error_text << std::endl;
-    }
-    return 0;
+KeyboardController::KeyboardController() :
+    KeyboardController(std::make_shared<X11Connection>()) {
 }
 
-KeyboardController::KeyboardController() : 
-    display_(nullptr), 
+KeyboardController::KeyboardController(std::shared_ptr<X11Connection> connection) :
+    connection_(std::move(connection)),
+    display_(connection_->display()),
+    root_window_(0),
     monitoring_(false),
+    key_subscription_(0),
     numpad_enter_keycode_(0) {
     
-    // Initialize X11 connection
-    display_ = XOpenDisplay(nullptr);
     if (!display_) {
-        std::cerr << "❌ Failed to open X display for keyboard control" << std::endl;
+        std::cerr << "❌ No X display for keyboard control" << std::endl;
         return;
     }
     
@@ -45,18 +37,26 @@ KeyboardController::KeyboardController() :
         grabbed_modifiers_.push_back(mod);
     }
     
+    // Region hotkeys only with Ctrl, so the keypad still types digits;
+    // NumLock (Mod2) changes the keysym but not the keycode
+    static const KeySym region_keysyms[] = {
+        XK_KP_1, XK_KP_2, XK_KP_3, XK_KP_4, XK_KP_5, XK_KP_6, XK_KP_7, XK_KP_8, XK_KP_9
+    };
+    for (KeySym keysym : region_keysyms) {
+        region_keycodes_.push_back(XKeysymToKeycode(display_, keysym));
+    }
+    for (int lock : {0, static_cast<int>(LockMask), static_cast<int>(Mod2Mask),
+                     static_cast<int>(LockMask | Mod2Mask)}) {
+        region_modifiers_.push_back(ControlMask | lock);
+    }
+    
     std::cout << "✅ Keyboard controller initialized" << std::endl;
 }
 
 KeyboardController::~KeyboardController() {
-    // Stop monitoring and release resources
+    // Stop monitoring and release grabbed keys; the connection closes with
+    // its last user
     stop_monitoring();
-    
-    // Close X display
-    if (display_) {
-        XCloseDisplay(display_);
-        display_ = nullptr;
-    }
 }
 
 bool KeyboardController::start_monitoring() {
@@ -70,33 +70,41 @@ bool KeyboardController::start_monitoring() {
         return true;
     }
     
-    // Set up error handler
-    had_x11_error = false;
-    XErrorHandler old_handler = XSetErrorHandler(&KeyboardController::x11_error_handler);
-    
-    // Register keyboard shortcuts
-    register_keyboard_shortcuts();
-    
-    // Sync to ensure errors are processed
-    XSync(display_, False);
+    // Trap errors of the grabs
+    int error_code;
+    {
+        X11ErrorTrap trap(display_);
+        
+        // Register keyboard shortcuts
+        register_keyboard_shortcuts();
+        
+        // Sync to ensure errors are processed
+        XSync(display_, False);
+        error_code = trap.error_code();
+    }
     
-    // Restore error handler
-    XSetErrorHandler(old_handler);
+    if (error_code != Success && error_code != BadAccess) {
+        char error_text[256];
+        XGetErrorText(display_, error_code, error_text, sizeof(error_text));
+        std::cerr << "⚠️ X11 Error: " << error_text << std::endl;
+    }
     
     // Check if we had an error during key grabbing
-    if (had_x11_error) {
+    if (error_code == BadAccess) {
+        std::cerr << "⚠️ X11 Error: Another application has already grabbed this key" << std::endl;
         unregister_keyboard_shortcuts();
         std::cerr << "❌ Failed to grab keyboard shortcuts: They may be in use by another application" << std::endl;
         return false;
     }
     
-    // Start a timer to check for X11 events
-    event_check_connection_ = Glib::signal_timeout().connect(
-        sigc::mem_fun(*this, &KeyboardController::process_x11_events),
-        100); // Check every 100ms
+    // Grabbed keys are reported on the root window; they are handled as
+    // soon as they arrive on the connection
+    key_subscription_ = connection_->subscribe(KeyPress, root_window_,
+                                               [this](XEvent& event) { handle_key_press(event); });
+    connection_->start_dispatching();
     
     monitoring_ = true;
-    std::cout << "✅ Keyboard shortcut monitoring started (Numpad Enter)" << std::endl;
+    std::cout << "✅ Keyboard shortcut monitoring started (Numpad Enter, Ctrl+Numpad 1-9)" << std::endl;
     
     return true;
 }
@@ -106,10 +114,8 @@ void KeyboardController::stop_monitoring() {
         return;
     }
     
-    // Disconnect the event check timer
-    if (event_check_connection_.connected()) {
-        event_check_connection_.disconnect();
-    }
+    connection_->unsubscribe(key_subscription_);
+    key_subscription_ = 0;
     
     // Unregister shortcuts
     unregister_keyboard_shortcuts();
@@ -127,8 +133,9 @@ void KeyboardController::register_keyboard_shortcuts() {
         return;
     }
     
-    // Select input for key events
-    XSelectInput(display_, root_window_, KeyPressMask);
+    // Select input for key events, keeping the events other components
+    // selected on the root window
+    connection_->select_input(root_window_, KeyPressMask);
     
     // Grab Numpad Enter with different modifier combinations
     for (int mod : grabbed_modifiers_) {
@@ -136,6 +143,16 @@ void KeyboardController::register_keyboard_shortcuts() {
                 True, GrabModeAsync, GrabModeAsync);
     }
     
+    // Grab the region hotkeys
+    for (unsigned int keycode : region_keycodes_) {
+        if (keycode == 0) {
+            continue;
+        }
+        for (int mod : region_modifiers_) {
+            XGrabKey(display_, keycode, mod, root_window_, True, GrabModeAsync, GrabModeAsync);
+        }
+    }
+    
     // Flush to ensure events are registered
     XFlush(display_);
 }
@@ -150,28 +167,47 @@ void KeyboardController::unregister_keyboard_shortcuts() {
         XUngrabKey(display_, numpad_enter_keycode_, mod, root_window_);
     }
     
+    for (unsigned int keycode : region_keycodes_) {
+        if (keycode == 0) {
+            continue;
+        }
+        for (int mod : region_modifiers_) {
+            XUngrabKey(display_, keycode, mod, root_window_);
+        }
+    }
+    
     // Flush to ensure events are processed
     XFlush(display_);
 }
 
-bool KeyboardController::process_x11_events() {
-    if (!display_ || !monitoring_) {
-        return false;  // Stop this timer
+void KeyboardController::handle_key_press(XEvent& event) {
+    if (!monitoring_) {
+        return;
     }
     
-    // Check for pending X events
-    while (XPending(display_)) {
-        XEvent event;
-        XNextEvent(display_, &event);
+    auto region_key = std::find(region_keycodes_.begin(), region_keycodes_.end(), event.xkey.keycode);
+    if (region_key != region_keycodes_.end() && (event.xkey.state & ControlMask)) {
+        int digit = static_cast<int>(region_key - region_keycodes_.begin()) + 1;
+        std::cout << "🔑 Ctrl+Numpad " << digit << " pressed (intercepted)" << std::endl;
         
-        // Handle key press events
-        if (event.type == KeyPress && event.xkey.keycode == numpad_enter_keycode_) {
-            std::cout << "🔑 Numpad Enter pressed (intercepted)" << std::endl;
-            
-            // Emit signal to trigger capture
-            m_signal_capture_key_pressed.emit();
-        }
+        // Emit signal to capture the region bound to the digit
+        m_signal_region_key_pressed.emit(digit);
+        return;
+    }
+    
+    if (event.xkey.keycode != numpad_enter_keycode_) {
+        return;
     }
     
-    return true;  // Continue this timer
+    if (event.xkey.state & ControlMask) {
+        std::cout << "🔑 Ctrl+Numpad Enter pressed (intercepted)" << std::endl;
+        
+        // Emit signal to dump the replay buffer
+        m_signal_replay_key_pressed.emit();
+    } else {
+        std::cout << "🔑 Numpad Enter pressed (intercepted)" << std::endl;
+        
+        // Emit signal to trigger capture
+        m_signal_capture_key_pressed.emit();
+    }
 }
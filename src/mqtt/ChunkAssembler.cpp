@@ -0,0 +1,236 @@
+#include "../../include/ChunkAssembler.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+// How many dropped transfers are remembered to ignore their late chunks
+static const size_t kDroppedHistory = 64;
+
+ChunkAssembler::ChunkAssembler(const std::string& spool_dir, size_t memory_limit, std::chrono::seconds timeout) :
+    spool_dir_(spool_dir),
+    memory_limit_(memory_limit),
+    timeout_(timeout),
+    max_message_size_(256ull * 1024 * 1024),
+    memory_in_use_(0),
+    max_spooled_transfers_(4),
+    max_spooled_bytes_(256ull * 1024 * 1024),
+    spooled_transfers_(0),
+    spooled_bytes_(0) {
+}
+
+ChunkAssembler::~ChunkAssembler() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!transfers_.empty()) {
+        drop_transfer(transfers_.begin());
+    }
+}
+
+ChunkAssembler::Result ChunkAssembler::add(std::string_view payload, std::string& message) {
+    ChunkTransfer::Chunk chunk;
+    if (!ChunkTransfer::decode(payload, chunk)) {
+        std::cerr << "❌ Malformed chunk" << std::endl;
+        return Result::Rejected;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(dropped_.begin(), dropped_.end(), chunk.transfer_id) != dropped_.end()) {
+        return Result::Rejected;
+    }
+
+    auto it = transfers_.find(chunk.transfer_id);
+    if (it == transfers_.end()) {
+        auto transfer = std::make_unique<Transfer>();
+        if (!start_transfer(chunk.transfer_id, chunk, *transfer)) {
+            dropped_.push_back(chunk.transfer_id);
+            if (dropped_.size() > kDroppedHistory) {
+                dropped_.pop_front();
+            }
+            return Result::Rejected;
+        }
+        it = transfers_.emplace(chunk.transfer_id, std::move(transfer)).first;
+    }
+
+    Transfer& transfer = *it->second;
+    if (chunk.total_size != transfer.total_size || chunk.chunk_size != transfer.chunk_size ||
+        chunk.count != transfer.received.size()) {
+        std::cerr << "❌ Chunk " << chunk.index << " does not match transfer " << std::hex
+                  << chunk.transfer_id << std::dec << std::endl;
+        return Result::Rejected;
+    }
+    transfer.last_chunk = std::chrono::steady_clock::now();
+
+    // Brokers may deliver a chunk twice
+    if (transfer.received[chunk.index]) {
+        return Result::Incomplete;
+    }
+
+    if (transfer.spool.is_open()) {
+        transfer.spool.seekp(static_cast<std::streamoff>(chunk.offset));
+        transfer.spool.write(reinterpret_cast<const char*>(chunk.data), static_cast<std::streamsize>(chunk.size));
+        if (!transfer.spool) {
+            std::cerr << "❌ Failed to write chunk to " << transfer.spool_path << std::endl;
+            drop_transfer(it);
+            return Result::Rejected;
+        }
+    } else {
+        std::copy(chunk.data, chunk.data + chunk.size, transfer.buffer.begin() + chunk.offset);
+    }
+    transfer.received[chunk.index] = true;
+    ++transfer.received_count;
+
+    if (transfer.received_count < transfer.received.size()) {
+        return Result::Incomplete;
+    }
+
+    bool complete = finish_transfer(transfer, message);
+    drop_transfer(it);
+    return complete ? Result::Complete : Result::Rejected;
+}
+
+bool ChunkAssembler::start_transfer(uint64_t id, const ChunkTransfer::Chunk& chunk, Transfer& transfer) {
+    if (chunk.total_size > max_message_size_) {
+        std::cerr << "❌ Chunked message of " << chunk.total_size / (1024 * 1024) << " MB is over the "
+                  << max_message_size_ / (1024 * 1024) << " MB limit" << std::endl;
+        return false;
+    }
+    // Every message is read into memory in the end
+    if (chunk.total_size > memory_limit_) {
+        std::cerr << "❌ Chunked message of " << chunk.total_size / (1024 * 1024) << " MB is over the "
+                  << memory_limit_ / (1024 * 1024) << " MB memory budget" << std::endl;
+        return false;
+    }
+    // decode() checks this too; the bookkeeping below is sized by count
+    if (chunk.count != ChunkTransfer::chunk_count(chunk.total_size, chunk.chunk_size)) {
+        std::cerr << "❌ Chunk count " << chunk.count << " does not match a " << chunk.total_size
+                  << " byte message" << std::endl;
+        return false;
+    }
+
+    transfer.total_size = chunk.total_size;
+    transfer.chunk_size = chunk.chunk_size;
+    transfer.received.assign(chunk.count, false);
+    transfer.last_chunk = std::chrono::steady_clock::now();
+
+    // Buffer in memory while the budget allows, spill to disk otherwise
+    if (memory_in_use_ + chunk.total_size <= memory_limit_) {
+        transfer.buffer.resize(chunk.total_size);
+        memory_in_use_ += chunk.total_size;
+        return true;
+    }
+
+    // Each spooled transfer holds a file open until it completes or expires
+    if (spooled_transfers_ >= max_spooled_transfers_ || spooled_bytes_ + chunk.total_size > max_spooled_bytes_) {
+        std::cerr << "❌ No room to spool a " << chunk.total_size / 1024 << " KB message (" << spooled_transfers_
+                  << " transfers, " << spooled_bytes_ / 1024 << " KB spooled)" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(spool_dir_, error);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.part", static_cast<unsigned long long>(id));
+    transfer.spool_path = (std::filesystem::path(spool_dir_) / name).string();
+    transfer.spool.open(transfer.spool_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!transfer.spool) {
+        std::cerr << "❌ Failed to create " << transfer.spool_path << std::endl;
+        return false;
+    }
+    ++spooled_transfers_;
+    spooled_bytes_ += chunk.total_size;
+    std::cout << "💾 Receiving " << chunk.total_size / 1024 << " KB into " << transfer.spool_path << std::endl;
+    return true;
+}
+
+bool ChunkAssembler::finish_transfer(Transfer& transfer, std::string& message) {
+    if (!transfer.spool.is_open()) {
+        message = std::move(transfer.buffer);
+        return true;
+    }
+
+    // The read-back needs the budget a buffered transfer would have used
+    if (memory_in_use_ + transfer.total_size > memory_limit_) {
+        std::cerr << "❌ No memory budget to read back " << transfer.spool_path << " ("
+                  << transfer.total_size / 1024 << " KB, " << memory_in_use_ / 1024 << " KB buffered)" << std::endl;
+        return false;
+    }
+
+    message.resize(transfer.total_size);
+    transfer.spool.seekg(0);
+    transfer.spool.read(&message[0], static_cast<std::streamsize>(message.size()));
+    if (!transfer.spool) {
+        std::cerr << "❌ Failed to read back " << transfer.spool_path << std::endl;
+        message.clear();
+        return false;
+    }
+    return true;
+}
+
+void ChunkAssembler::drop_transfer(std::map<uint64_t, std::unique_ptr<Transfer>>::iterator it) {
+    Transfer& transfer = *it->second;
+    if (transfer.spool.is_open()) {
+        transfer.spool.close();
+        std::error_code error;
+        std::filesystem::remove(transfer.spool_path, error);
+        --spooled_transfers_;
+        spooled_bytes_ -= transfer.total_size;
+    } else {
+        memory_in_use_ -= transfer.total_size;
+    }
+    transfers_.erase(it);
+}
+
+std::vector<std::string> ChunkAssembler::expire() {
+    std::vector<std::string> expired;
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = transfers_.begin(); it != transfers_.end();) {
+        const Transfer& transfer = *it->second;
+        if (now - transfer.last_chunk < timeout_) {
+            ++it;
+            continue;
+        }
+
+        char id[17];
+        std::snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(it->first));
+        size_t missing = transfer.received.size() - transfer.received_count;
+        expired.push_back(std::string("transfer ") + id + " missing " + std::to_string(missing) + " of " +
+                          std::to_string(transfer.received.size()) + " chunks");
+
+        dropped_.push_back(it->first);
+        if (dropped_.size() > kDroppedHistory) {
+            dropped_.pop_front();
+        }
+        auto next = std::next(it);
+        drop_transfer(it);
+        it = next;
+    }
+    return expired;
+}
+
+void ChunkAssembler::set_max_message_size(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_message_size_ = bytes;
+}
+
+void ChunkAssembler::set_spool_limits(size_t max_transfers, uint64_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_spooled_transfers_ = max_transfers;
+    max_spooled_bytes_ = max_bytes;
+}
+
+size_t ChunkAssembler::transfers_in_progress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return transfers_.size();
+}
+
+size_t ChunkAssembler::memory_in_use() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_in_use_;
+}
+
+size_t ChunkAssembler::spooled_transfers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spooled_transfers_;
+}
@@ -0,0 +1,94 @@
+#include "../../include/ChunkTransfer.h"
+#include <algorithm>
+#include <cstring>
+
+static const char kMagic[4] = { 'P', 'W', 'C', 'K' };
+
+static void put_number(std::string& out, uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+static uint64_t get_number(const unsigned char* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+bool ChunkTransfer::is_chunk(std::string_view payload) {
+    return payload.size() >= HEADER_SIZE && std::memcmp(payload.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+uint32_t ChunkTransfer::chunk_count(size_t message_size, size_t chunk_size) {
+    if (chunk_size == 0) {
+        return 1;
+    }
+    return static_cast<uint32_t>(std::max<size_t>(1, (message_size + chunk_size - 1) / chunk_size));
+}
+
+std::string ChunkTransfer::encode(const std::string& message, uint64_t transfer_id, uint32_t index,
+                                  size_t chunk_size) {
+    size_t offset = static_cast<size_t>(index) * chunk_size;
+    size_t size = offset < message.size() ? std::min(chunk_size, message.size() - offset) : 0;
+
+    std::string chunk;
+    chunk.reserve(HEADER_SIZE + size);
+    chunk.append(kMagic, sizeof(kMagic));
+    chunk.push_back(static_cast<char>(VERSION));
+    put_number(chunk, transfer_id, 8);
+    put_number(chunk, index, 4);
+    put_number(chunk, chunk_count(message.size(), chunk_size), 4);
+    put_number(chunk, offset, 8);
+    put_number(chunk, message.size(), 8);
+    chunk.append(message, offset, size);
+    return chunk;
+}
+
+bool ChunkTransfer::decode(std::string_view payload, Chunk& chunk) {
+    if (!is_chunk(payload)) {
+        return false;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(payload.data());
+    if (bytes[4] != VERSION) {
+        return false;
+    }
+    chunk.transfer_id = get_number(bytes + 5, 8);
+    chunk.index = static_cast<uint32_t>(get_number(bytes + 13, 4));
+    chunk.count = static_cast<uint32_t>(get_number(bytes + 17, 4));
+    chunk.offset = get_number(bytes + 21, 8);
+    chunk.total_size = get_number(bytes + 29, 8);
+    chunk.data = bytes + HEADER_SIZE;
+    chunk.size = payload.size() - HEADER_SIZE;
+
+    if (chunk.count == 0 || chunk.index >= chunk.count) {
+        return false;
+    }
+
+    // Chunk size implied by this chunk, checked against the rest below
+    if (chunk.count == 1) {
+        chunk.chunk_size = chunk.total_size;
+    } else if (chunk.index == 0) {
+        chunk.chunk_size = chunk.size;
+    } else if (chunk.offset % chunk.index == 0) {
+        chunk.chunk_size = chunk.offset / chunk.index;
+    } else {
+        return false;
+    }
+    if (chunk.count > 1 && chunk.chunk_size == 0) {
+        return false;
+    }
+
+    // The chunks have to tile the message exactly, so a forged count cannot
+    // size the receiver's bookkeeping and partial coverage cannot complete it
+    uint64_t count = chunk.count == 1 ? 1 : chunk.total_size / chunk.chunk_size +
+                                                (chunk.total_size % chunk.chunk_size != 0 ? 1 : 0);
+    if (count != chunk.count || chunk.offset != chunk.index * chunk.chunk_size ||
+        chunk.offset > chunk.total_size) {
+        return false;
+    }
+    return chunk.size == std::min<uint64_t>(chunk.chunk_size, chunk.total_size - chunk.offset);
+}
@@ -0,0 +1,140 @@
+#include "../../include/ImageFrame.h"
+#include "../../include/ImageFormat.h"
+#include <openssl/evp.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+static const char kMagic[4] = { 'P', 'W', 'I', 'M' };
+static const size_t kPreambleSize = sizeof(kMagic) + 1 + 4;
+
+bool ImageFrame::is_frame(std::string_view payload) {
+    return payload.size() >= kPreambleSize && std::memcmp(payload.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+std::string ImageFrame::encode(nlohmann::json header, const std::vector<const EncodedImage*>& images) {
+    nlohmann::json& entries = header["images"];
+    if (!entries.is_array()) {
+        entries = nlohmann::json::array();
+    }
+
+    size_t image_bytes = 0;
+    for (size_t i = 0; i < images.size(); ++i) {
+        const EncodedImage& image = *images[i];
+        if (entries.size() <= i) {
+            entries.push_back(nlohmann::json::object());
+        }
+        nlohmann::json& entry = entries[i];
+        entry["format"] = ImageFormat::normalize(image.format);
+        entry["mime_type"] = ImageFormat::mime_type(image.format);
+        entry["width"] = image.width;
+        entry["height"] = image.height;
+        entry["size"] = image.data.size();
+        entry["sha256"] = sha256(image.data.data(), image.data.size());
+        image_bytes += image.data.size();
+    }
+
+    std::string meta = header.dump();
+    uint32_t meta_size = static_cast<uint32_t>(meta.size());
+
+    std::string frame;
+    frame.reserve(kPreambleSize + meta.size() + image_bytes);
+    frame.append(kMagic, sizeof(kMagic));
+    frame.push_back(static_cast<char>(VERSION));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        frame.push_back(static_cast<char>((meta_size >> shift) & 0xFF));
+    }
+    frame.append(meta);
+    for (const EncodedImage* image : images) {
+        frame.append(reinterpret_cast<const char*>(image->data.data()), image->data.size());
+    }
+    return frame;
+}
+
+bool ImageFrame::decode(std::string_view payload, nlohmann::json& header, std::vector<Image>& images) {
+    images.clear();
+    if (!is_frame(payload)) {
+        return false;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(payload.data());
+    unsigned char version = bytes[sizeof(kMagic)];
+    if (version != VERSION) {
+        std::cerr << "❌ Unsupported image frame version " << static_cast<int>(version) << std::endl;
+        return false;
+    }
+
+    size_t meta_size = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        meta_size = (meta_size << 8) | bytes[sizeof(kMagic) + 1 + i];
+    }
+    if (meta_size > payload.size() - kPreambleSize) {
+        std::cerr << "❌ Truncated image frame header" << std::endl;
+        return false;
+    }
+
+    try {
+        header = nlohmann::json::parse(payload.begin() + kPreambleSize,
+                                       payload.begin() + kPreambleSize + meta_size);
+    } catch (const nlohmann::json::parse_error& e) {
+        std::cerr << "❌ Invalid image frame header: " << e.what() << std::endl;
+        return false;
+    }
+    if (!header.contains("images") || !header["images"].is_array()) {
+        std::cerr << "❌ Image frame header without images" << std::endl;
+        return false;
+    }
+
+    size_t offset = kPreambleSize + meta_size;
+    for (const auto& entry : header["images"]) {
+        // The header comes from the network: wrong types are rejected here
+        // rather than thrown by the accessors below
+        auto size_field = entry.is_object() ? entry.find("size") : entry.end();
+        auto hash_field = entry.is_object() ? entry.find("sha256") : entry.end();
+        if (!entry.is_object() ||
+            (size_field != entry.end() && !size_field->is_number_unsigned()) ||
+            (hash_field != entry.end() && !hash_field->is_string())) {
+            std::cerr << "❌ Malformed image entry in frame header" << std::endl;
+            images.clear();
+            return false;
+        }
+
+        uint64_t size = size_field != entry.end() ? size_field->get<uint64_t>() : 0;
+        if (size > payload.size() - offset) {
+            std::cerr << "❌ Truncated image in frame" << std::endl;
+            images.clear();
+            return false;
+        }
+
+        Image image;
+        image.meta = &entry;
+        image.data = bytes + offset;
+        image.size = static_cast<size_t>(size);
+        std::string expected = hash_field != entry.end() ? hash_field->get<std::string>() : "";
+        if (!expected.empty() && expected != sha256(image.data, image.size)) {
+            std::cerr << "❌ Image in frame does not match its hash" << std::endl;
+            images.clear();
+            return false;
+        }
+        images.push_back(image);
+        offset += size;
+    }
+    return true;
+}
+
+std::string ImageFrame::sha256(const unsigned char* data, size_t length) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_length = 0;
+    if (EVP_Digest(data, length, digest, &digest_length, EVP_sha256(), nullptr) != 1) {
+        return "";
+    }
+
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest_length * 2);
+    for (unsigned int i = 0; i < digest_length; ++i) {
+        hex.push_back(kHex[digest[i] >> 4]);
+        hex.push_back(kHex[digest[i] & 0x0F]);
+    }
+    return hex;
+}
@@ -1,4 +1,8 @@
 #include "../../include/MqttClient.h"
+#include "../../include/ImageFormat.h"
+#include "../../include/ImageFrame.h"
+#include "../../include/ChunkTransfer.h"
+#include <glibmm/main.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
 #include <openssl/buffer.h>
@@ -9,24 +13,70 @@
 #include <chrono>
 #include <ctime>
 #include <filesystem>
+#include <random>
+#include <algorithm>
 #include <nlohmann/json.hpp> // Add this include for JSON manipulation
 
-MqttClient::MqttClient() : mosq_(nullptr), connected_(false) {
+static void add_routing_info(const std::string& routing_info, nlohmann::json& msg_json) {
+    // Parse routing_info string (e.g., "to:agent,from:ui,type:image")
+    std::stringstream ss_routing(routing_info);
+    std::string segment;
+    while (std::getline(ss_routing, segment, ',')) {
+        size_t colon_pos = segment.find(':');
+        if (colon_pos != std::string::npos) {
+            std::string key = segment.substr(0, colon_pos);
+            std::string value = segment.substr(colon_pos + 1);
+            msg_json[key] = value; // Add routing info as top-level fields
+        }
+    }
+}
+
+static std::string utc_timestamp() {
+    auto now = std::chrono::system_clock::now();
+    std::time_t t = std::chrono::system_clock::to_time_t(now);
+    char tsbuf[21];
+    std::strftime(tsbuf, sizeof(tsbuf), "%FT%TZ", std::gmtime(&t));
+    return tsbuf;
+}
+
+MqttClient::MqttClient() : mosq_(nullptr), connected_(false), image_transport_(ImageTransport::Json), image_qos_(0),
+                           max_in_flight_bytes_(64 * 1024 * 1024), image_bytes_in_flight_(0),
+                           chunk_size_(256 * 1024), last_written_mid_(0),
+                           chunk_sender_stopping_(false) {
+    // Transfer ids only need to differ between senders on the same broker
+    std::random_device random;
+    next_transfer_id_ = (static_cast<uint64_t>(random()) << 32) | random();
+    
     mosquitto_lib_init();
     mosq_ = mosquitto_new(nullptr, true, this);
     if (mosq_) {
         mosquitto_connect_callback_set(mosq_, on_connect_callback);
         mosquitto_disconnect_callback_set(mosq_, on_disconnect_callback);
+        mosquitto_publish_callback_set(mosq_, on_publish_callback);
+        mosquitto_message_callback_set(mosq_, on_message_callback);
     }
+    chunk_sender_ = std::thread(&MqttClient::run_chunk_sender, this);
 }
 
 MqttClient::~MqttClient() {
+    {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        chunk_sender_stopping_ = true;
+    }
+    chunk_cv_.notify_all();
+    if (chunk_sender_.joinable()) {
+        chunk_sender_.join();
+    }
+    
     if (mosq_) {
         if (connected_) {
             mosquitto_disconnect(mosq_);
         }
+        // No more messages are dispatched once the network thread is gone
+        mosquitto_loop_stop(mosq_, true);
         mosquitto_destroy(mosq_);
     }
+    fail_in_flight("client destroyed");
     mosquitto_lib_cleanup();
 }
 
@@ -66,48 +116,144 @@ void MqttClient::disconnect() {
         mosquitto_disconnect(mosq_);
         mosquitto_loop_stop(mosq_, true);
         connected_ = false;
+        // Without the network thread nothing more is acknowledged
+        fail_in_flight("disconnected");
     }
 }
 
-void MqttClient::on_connect_callback(struct mosquitto* mosq [[maybe_unused]], void* obj, int rc) {
+void MqttClient::on_connect_callback(struct mosquitto* mosq, void* obj, int rc) {
     MqttClient* client = static_cast<MqttClient*>(obj);
     client->connected_ = (rc == 0);
+    if (rc != 0) {
+        return;
+    }
+    
+    // Subscriptions made before connecting, or lost with a reconnect
+    for (const auto& filter : client->router_.filters()) {
+        mosquitto_subscribe(mosq, nullptr, filter.c_str(), 0);
+    }
+    if (client->connect_callback_) {
+        client->connect_callback_();
+    }
 }
 
-void MqttClient::on_disconnect_callback(struct mosquitto* mosq [[maybe_unused]], void* obj, int rc [[maybe_unused]]) {
+void MqttClient::on_disconnect_callback(struct mosquitto* mosq [[maybe_unused]], void* obj, int rc) {
     MqttClient* client = static_cast<MqttClient*>(obj);
     client->connected_ = false;
+    // QoS 0 messages lost with the connection are never acknowledged; left
+    // in flight they would hold their bytes against the limit for good.
+    // Asked-for disconnects lose everything.
+    if (rc == 0) {
+        client->fail_in_flight("disconnected");
+    } else {
+        client->fail_in_flight("connection lost", 0);
+    }
+}
+
+void MqttClient::on_publish_callback(struct mosquitto* mosq [[maybe_unused]], void* obj, int mid) {
+    MqttClient* client = static_cast<MqttClient*>(obj);
+    {
+        std::lock_guard<std::mutex> lock(client->chunk_mutex_);
+        client->last_written_mid_ = mid;
+    }
+    client->chunk_cv_.notify_all();
+
+    std::shared_ptr<PendingPublish> pending;
+    {
+        std::lock_guard<std::mutex> lock(client->in_flight_mutex_);
+        auto it = client->in_flight_.find(mid);
+        if (it == client->in_flight_.end()) {
+            // mosquitto_publish() has not returned the id yet
+            client->early_mids_.push_back(mid);
+            if (client->early_mids_.size() > 64) {
+                client->early_mids_.pop_front();
+            }
+            return;
+        }
+        pending = it->second;
+        client->in_flight_.erase(it);
+    }
+    if (pending) {
+        client->complete_publish(pending, "");
+    }
 }
 
 void MqttClient::on_message_callback(struct mosquitto* mosq [[maybe_unused]], void* obj, const struct mosquitto_message* message) {
     MqttClient* client = static_cast<MqttClient*>(obj);
-    if (client && client->message_callback_) {
-        std::string topic(message->topic);
-        std::string payload(static_cast<char*>(message->payload), message->payloadlen);
-        client->message_callback_(topic, payload);
+    if (client) {
+        client->dispatch(message->topic,
+                         std::string_view(static_cast<const char*>(message->payload), message->payloadlen));
     }
 }
 
-void MqttClient::set_message_callback(MessageCallback callback) {
-    message_callback_ = callback;
-    if (mosq_) {
-        mosquitto_message_callback_set(mosq_, on_message_callback);
+void MqttClient::dispatch(std::string_view topic, std::string_view payload) {
+    auto routes = router_.match(topic);
+    if (routes.empty()) {
+        return;
+    }
+
+    // Handlers running elsewhere share one copy of the message, made only
+    // if there is such a handler; the others read mosquitto's buffer
+    std::shared_ptr<const std::pair<std::string, std::string>> copy;
+    for (const auto& route : routes) {
+        if (route->delivery == Delivery::NetworkThread) {
+            std::lock_guard<std::recursive_mutex> lock(route->call_mutex);
+            if (route->active) {
+                route->handler(topic, payload);
+            }
+            continue;
+        }
+        if (!copy) {
+            copy = std::make_shared<const std::pair<std::string, std::string>>(std::string(topic),
+                                                                               std::string(payload));
+        }
+        auto deliver = [route, copy]() {
+            std::lock_guard<std::recursive_mutex> lock(route->call_mutex);
+            if (route->active) {
+                route->handler(copy->first, copy->second);
+            }
+        };
+        if (route->delivery == Delivery::MainLoop) {
+            Glib::signal_idle().connect_once(deliver);
+        } else {
+            std::lock_guard<std::mutex> lock(handler_pool_mutex_);
+            handler_pool_->submit(deliver);
+        }
     }
 }
 
-bool MqttClient::subscribe(const std::string& topic) {
-    if (!mosq_ || !connected_) {
-        std::cerr << "Cannot subscribe: MQTT client not connected" << std::endl;
-        return false;
+MqttClient::HandlerId MqttClient::add_handler(const std::string& filter, MessageHandler handler, Delivery delivery) {
+    if (delivery == Delivery::Worker) {
+        std::lock_guard<std::mutex> lock(handler_pool_mutex_);
+        if (!handler_pool_) {
+            handler_pool_ = std::make_unique<WorkerPool>(2);
+        }
     }
-    
-    try {
-        mosquitto_subscribe(mosq_, nullptr, topic.c_str(), 0); // QoS level 0
-        std::cout << "Subscribed to topic: " << topic << std::endl;
-        return true;
-    } catch (const std::exception& exc) {
-        std::cerr << "Error subscribing to topic " << topic << ": " << exc.what() << std::endl;
-        return false;
+
+    HandlerId id = router_.add(filter, delivery, std::move(handler));
+    if (id == 0) {
+        std::cerr << "❌ Invalid MQTT topic filter: " << filter << std::endl;
+        return 0;
+    }
+    if (mosq_ && connected_) {
+        // Subscribing twice to a filter is harmless, the broker keeps one
+        int rc = mosquitto_subscribe(mosq_, nullptr, filter.c_str(), 0); // QoS level 0
+        if (rc == MOSQ_ERR_SUCCESS) {
+            std::cout << "Subscribed to topic: " << filter << std::endl;
+        } else {
+            std::cerr << "Error subscribing to topic " << filter << ": " << mosquitto_strerror(rc) << std::endl;
+        }
+    }
+    return id;
+}
+
+void MqttClient::remove_handler(HandlerId id) {
+    std::string unused_filter;
+    if (!router_.remove(id, unused_filter) || unused_filter.empty()) {
+        return;
+    }
+    if (mosq_ && connected_) {
+        mosquitto_unsubscribe(mosq_, nullptr, unused_filter.c_str());
     }
 }
 
@@ -117,21 +263,20 @@ bool MqttClient::publish(const std::string& topic, const std::string& message) {
         return false;
     }
     
-    try {
-        int rc = mosquitto_publish(mosq_, nullptr, topic.c_str(), 
-                                   message.length(), message.c_str(), 
-                                   0, false);
-        if (rc == MOSQ_ERR_SUCCESS) {
-            std::cout << "Published message to topic " << topic << std::endl;
-            return true;
-        } else {
-            std::cerr << "Error publishing to topic " << topic << ": " << mosquitto_strerror(rc) << std::endl;
-            return false;
-        }
-    } catch (const std::exception& exc) {
-        std::cerr << "Error publishing to topic " << topic << ": " << exc.what() << std::endl;
+    if (!publish_payload(topic, message, 0, std::make_shared<PendingPublish>(), false)) {
         return false;
     }
+    std::cout << "Published message to topic " << topic << std::endl;
+    return true;
+}
+
+std::future<MqttClient::PublishResult> MqttClient::publish_async(const std::string& topic, std::string message,
+                                                                 int qos, PublishCallback on_complete) {
+    auto pending = std::make_shared<PendingPublish>();
+    pending->on_complete = std::move(on_complete);
+    std::future<PublishResult> result = pending->promise.get_future();
+    publish_payload(topic, std::move(message), std::clamp(qos, 0, 2), pending, false);
+    return result;
 }
 
 bool MqttClient::publish_image(const std::string& topic, const std::string& filename,
@@ -149,63 +294,354 @@ bool MqttClient::publish_image(const std::string& topic, const std::string& file
         return false;
     }
 
-    std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file), {});
-    
-    std::string base64_payload;
-    // Always encode image data as Base64
-    BIO *bio, *b64;
-    BUF_MEM *bufferPtr;
+    EncodedImage image;
+    image.data.assign(std::istreambuf_iterator<char>(file), {});
+    image.format = ImageFormat::from_path(filename);
+    if (image.format.empty()) {
+        image.format = "png";
+    }
 
-    b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL); // Avoid newlines
-    bio = BIO_new(BIO_s_mem());
-    bio = BIO_push(b64, bio);
+    return publish_image(topic, image, filename, routing_info, trigger_type);
+}
 
-    BIO_write(bio, buffer.data(), buffer.size());
-    BIO_flush(bio);
-    BIO_get_mem_ptr(bio, &bufferPtr);
+bool MqttClient::publish_image(const std::string& topic, const EncodedImage& image,
+                             const std::string& filename, const std::string& routing_info,
+                             const std::string& trigger_type, PublishCallback on_complete) {
+    if (!mosq_ || !connected_) {
+        std::cerr << "❌ Cannot publish: MQTT client not connected" << std::endl;
+        return false;
+    }
 
-    base64_payload.assign(bufferPtr->data, bufferPtr->length);
-    BIO_free_all(bio);
+    if (image.empty()) {
+        std::cerr << "❌ Cannot publish an empty image" << std::endl;
+        return false;
+    }
 
-    // Parse routing_info string (e.g., "to:agent,from:ui,type:image")
     nlohmann::json msg_json;
-    std::stringstream ss_routing(routing_info);
-    std::string segment;
-    while (std::getline(ss_routing, segment, ',')) {
-        size_t colon_pos = segment.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string key = segment.substr(0, colon_pos);
-            std::string value = segment.substr(colon_pos + 1);
-            msg_json[key] = value; // Add routing info as top-level fields
-        }
-    }
+    add_routing_info(routing_info, msg_json);
 
     // Add metadata and image data
-    auto now = std::chrono::system_clock::now();
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
-    char tsbuf[20];
-    std::strftime(tsbuf, sizeof(tsbuf), "%FT%TZ", std::gmtime(&t));
-    
     msg_json["filename"] = std::filesystem::path(filename).filename().string();
     msg_json["trigger_type"] = trigger_type;
-    msg_json["timestamp"] = tsbuf;
-    msg_json["image_data"] = base64_payload; // Add base64 image data
+    msg_json["timestamp"] = utc_timestamp();
+    msg_json["format"] = ImageFormat::normalize(image.format);
+    msg_json["mime_type"] = ImageFormat::mime_type(image.format);
+    if (image.changed_width > 0) {
+        // Only this part differs from the previous capture of the same target
+        msg_json["changed_area"] = {
+            {"x", image.changed_x}, {"y", image.changed_y},
+            {"width", image.changed_width}, {"height", image.changed_height}
+        };
+    }
+
+    std::string message;
+    if (image_transport_ == ImageTransport::Binary) {
+        // Metadata header followed by the image bytes as they are
+        message = ImageFrame::encode(std::move(msg_json), { &image });
+    } else {
+        msg_json["image_data"] = encode_base64(image.data.data(), image.data.size());
+        message = msg_json.dump(); // Serialize the JSON object
+    }
+
+    auto pending = std::make_shared<PendingPublish>();
+    pending->on_complete = std::move(on_complete);
+    if (!publish_payload(topic, std::move(message), image_qos_, pending, true)) {
+        return false;
+    }
+
+    std::cout << "✅ Published image to topic " << topic << std::endl;
+    return true;
+}
+
+bool MqttClient::publish_images(const std::string& topic,
+                                const std::vector<std::shared_ptr<const EncodedImage>>& images,
+                                const std::vector<long>& offsets_ms, const std::string& routing_info,
+                                const std::string& trigger_type, PublishCallback on_complete) {
+    if (!mosq_ || !connected_) {
+        std::cerr << "❌ Cannot publish: MQTT client not connected" << std::endl;
+        return false;
+    }
+
+    if (images.empty()) {
+        std::cerr << "❌ Cannot publish an empty image sequence" << std::endl;
+        return false;
+    }
+
+    nlohmann::json msg_json;
+    add_routing_info(routing_info, msg_json);
+    msg_json["trigger_type"] = trigger_type;
+    msg_json["timestamp"] = utc_timestamp();
+    msg_json["frame_count"] = images.size();
+
+    const bool binary = image_transport_ == ImageTransport::Binary;
+    nlohmann::json frames = nlohmann::json::array();
+    std::vector<const EncodedImage*> frame_images;
+    for (size_t i = 0; i < images.size(); ++i) {
+        const EncodedImage& image = *images[i];
+        nlohmann::json frame;
+        frame["format"] = ImageFormat::normalize(image.format);
+        frame["mime_type"] = ImageFormat::mime_type(image.format);
+        frame["width"] = image.width;
+        frame["height"] = image.height;
+        frame["offset_ms"] = i < offsets_ms.size() ? offsets_ms[i] : 0;
+        if (binary) {
+            frame_images.push_back(&image);
+        } else {
+            frame["image_data"] = encode_base64(image.data.data(), image.data.size());
+        }
+        frames.push_back(std::move(frame));
+    }
+    msg_json["images"] = std::move(frames);
+
+    std::string message = binary ? ImageFrame::encode(std::move(msg_json), frame_images) : msg_json.dump();
+
+    auto pending = std::make_shared<PendingPublish>();
+    pending->on_complete = std::move(on_complete);
+    if (!publish_payload(topic, std::move(message), image_qos_, pending, true)) {
+        return false;
+    }
 
-    // Add a placeholder for the actual window title if needed, or remove if unused by agent
-    // msg_json["window_title"] = "Actual Window Title"; // Example if needed
+    std::cout << "✅ Published " << images.size() << " images to topic " << topic << std::endl;
+    return true;
+}
+
+void MqttClient::set_chunk_size(size_t bytes) {
+    std::lock_guard<std::mutex> lock(chunk_mutex_);
+    chunk_size_ = bytes;
+}
+
+size_t MqttClient::get_chunk_size() const {
+    std::lock_guard<std::mutex> lock(chunk_mutex_);
+    return chunk_size_;
+}
+
+void MqttClient::set_max_in_flight_bytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(in_flight_mutex_);
+    max_in_flight_bytes_ = bytes;
+}
+
+size_t MqttClient::get_max_in_flight_bytes() const {
+    std::lock_guard<std::mutex> lock(in_flight_mutex_);
+    return max_in_flight_bytes_;
+}
+
+MqttClient::PublishStats MqttClient::publish_stats() const {
+    std::lock_guard<std::mutex> lock(in_flight_mutex_);
+    return publish_stats_;
+}
+
+bool MqttClient::publish_payload(const std::string& topic, std::string message, int qos,
+                                 std::shared_ptr<PendingPublish> pending, bool image) {
+    pending->bytes = message.size();
+    pending->qos = qos;
+    pending->started = std::chrono::steady_clock::now();
+    pending->image = image;
 
-    std::string message = msg_json.dump(); // Serialize the JSON object
+    // Images are refused before taking any memory while the link is behind
+    std::string refused;
+    if (!mosq_ || !connected_) {
+        refused = "not connected";
+    } else {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        size_t in_flight_bytes = image_bytes_in_flight_;
+        if (image && max_in_flight_bytes_ > 0 && in_flight_bytes > 0 &&
+            in_flight_bytes + message.size() > max_in_flight_bytes_) {
+            refused = std::to_string(in_flight_bytes / 1024) + " KB of images already in flight";
+            ++publish_stats_.rejected;
+        } else {
+            if (image) {
+                image_bytes_in_flight_ += message.size();
+            }
+            publish_stats_.in_flight_bytes += message.size();
+            ++publish_stats_.in_flight;
+        }
+    }
+    if (!refused.empty()) {
+        std::cerr << "⚠️ Not publishing " << message.size() / 1024 << " KB to " << topic << ": " << refused << std::endl;
+        PublishResult result;
+        result.error = refused;
+        result.bytes = pending->bytes;
+        result.qos = qos;
+        pending->promise.set_value(result);
+        if (pending->on_complete) {
+            pending->on_complete(result);
+        }
+        return false;
+    }
 
-    int rc = mosquitto_publish(mosq_, nullptr, topic.c_str(), 
+    if (image) {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        if (chunk_size_ > 0 && message.size() > chunk_size_) {
+            uint32_t count = ChunkTransfer::chunk_count(message.size(), chunk_size_);
+            std::cout << "📦 Sending " << message.size() / 1024 << " KB to " << topic << " in " << count
+                      << " chunks" << std::endl;
+            outgoing_.push_back(OutgoingTransfer{topic, std::move(message), next_transfer_id_++, 0, count,
+                                                 chunk_size_, qos, pending});
+            chunk_cv_.notify_all();
+            return true;
+        }
+    }
+
+    int mid = 0;
+    int rc = mosquitto_publish(mosq_, &mid, topic.c_str(), 
                              message.length(), message.c_str(), 
-                             0, false);
-    
+                             qos, false);
     if (rc != MOSQ_ERR_SUCCESS) {
         std::cerr << "❌ Error publishing to topic " << topic << ": " << mosquitto_strerror(rc) << std::endl;
+        complete_publish(pending, mosquitto_strerror(rc));
         return false;
     }
-
-    std::cout << "✅ Published image to topic " << topic << std::endl;
+    track_publish(mid, pending);
     return true;
-}
\ No newline at end of file
+}
+
+void MqttClient::track_publish(int mid, std::shared_ptr<PendingPublish> pending) {
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        auto early = std::find(early_mids_.begin(), early_mids_.end(), mid);
+        if (early == early_mids_.end()) {
+            in_flight_[mid] = std::move(pending);
+            return;
+        }
+        early_mids_.erase(early);
+    }
+    if (pending) {
+        complete_publish(pending, "");
+    }
+}
+
+void MqttClient::complete_publish(const std::shared_ptr<PendingPublish>& pending, const std::string& error) {
+    PublishResult result;
+    result.delivered = error.empty();
+    result.error = error;
+    result.bytes = pending->bytes;
+    result.qos = pending->qos;
+    result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - pending->started);
+
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        // A chunked transfer stopped after its last chunk went out may be
+        // failed as well as delivered; the first result counts
+        if (pending->completed) {
+            return;
+        }
+        pending->completed = true;
+        publish_stats_.in_flight_bytes -= std::min(publish_stats_.in_flight_bytes, pending->bytes);
+        if (pending->image) {
+            image_bytes_in_flight_ -= std::min(image_bytes_in_flight_, pending->bytes);
+        }
+        publish_stats_.in_flight -= std::min<size_t>(publish_stats_.in_flight, 1);
+        if (result.delivered) {
+            ++publish_stats_.delivered;
+            publish_stats_.last_latency = result.latency;
+            publish_stats_.max_latency = std::max(publish_stats_.max_latency, result.latency);
+        } else {
+            ++publish_stats_.failed;
+        }
+    }
+
+    pending->promise.set_value(result);
+    if (pending->on_complete) {
+        pending->on_complete(result);
+    }
+}
+
+void MqttClient::fail_in_flight(const std::string& error, int max_qos) {
+    std::vector<std::shared_ptr<PendingPublish>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+            // Chunks without a PendingPublish have nothing to complete
+            if (it->second && it->second->qos > max_qos) {
+                ++it;
+                continue;
+            }
+            if (it->second) {
+                abandoned.push_back(std::move(it->second));
+            }
+            it = in_flight_.erase(it);
+        }
+        early_mids_.clear();
+    }
+    for (auto& pending : abandoned) {
+        complete_publish(pending, error);
+    }
+}
+
+void MqttClient::run_chunk_sender() {
+    std::unique_lock<std::mutex> lock(chunk_mutex_);
+    while (true) {
+        chunk_cv_.wait(lock, [this]() { return chunk_sender_stopping_ || !outgoing_.empty(); });
+        if (chunk_sender_stopping_) {
+            break;
+        }
+
+        OutgoingTransfer& transfer = outgoing_.front();
+        std::string chunk = ChunkTransfer::encode(transfer.message, transfer.id, transfer.next_chunk,
+                                                  transfer.chunk_size);
+        std::string topic = transfer.topic;
+        int qos = transfer.qos;
+        bool last = transfer.next_chunk + 1 == transfer.chunk_count;
+        std::shared_ptr<PendingPublish> pending = transfer.pending;
+        lock.unlock();
+
+        int mid = 0;
+        int rc = connected_ ? mosquitto_publish(mosq_, &mid, topic.c_str(), chunk.size(), chunk.data(), qos, false)
+                            : MOSQ_ERR_NO_CONN;
+        if (rc == MOSQ_ERR_SUCCESS) {
+            // The transfer is delivered with its last chunk
+            track_publish(mid, last ? pending : nullptr);
+        }
+
+        lock.lock();
+        if (rc != MOSQ_ERR_SUCCESS) {
+            std::cerr << "❌ Dropped chunked transfer to " << topic << " at chunk " << outgoing_.front().next_chunk
+                      << " of " << outgoing_.front().chunk_count << ": " << mosquitto_strerror(rc) << std::endl;
+            outgoing_.pop_front();
+            lock.unlock();
+            complete_publish(pending, mosquitto_strerror(rc));
+            lock.lock();
+            continue;
+        }
+
+        // Wait until the chunk is written before queueing the next one, so
+        // messages published meanwhile are not stuck behind the whole transfer.
+        // Messages are written in order, so any later message id means it is.
+        chunk_cv_.wait_for(lock, std::chrono::seconds(2), [this, mid]() {
+            return chunk_sender_stopping_ || static_cast<int16_t>(last_written_mid_ - mid) >= 0;
+        });
+
+        if (++outgoing_.front().next_chunk == outgoing_.front().chunk_count) {
+            outgoing_.pop_front();
+        }
+    }
+
+    if (!outgoing_.empty()) {
+        std::cout << "📦 " << outgoing_.size() << " chunked transfer(s) not sent" << std::endl;
+        std::deque<OutgoingTransfer> abandoned;
+        abandoned.swap(outgoing_);
+        lock.unlock();
+        for (auto& transfer : abandoned) {
+            complete_publish(transfer.pending, "client stopped");
+        }
+    }
+}
+
+std::string MqttClient::encode_base64(const unsigned char* data, size_t length) {
+    BIO *bio, *b64;
+    BUF_MEM *bufferPtr;
+
+    b64 = BIO_new(BIO_f_base64());
+    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL); // Avoid newlines
+    bio = BIO_new(BIO_s_mem());
+    bio = BIO_push(b64, bio);
+
+    BIO_write(bio, data, static_cast<int>(length));
+    BIO_flush(bio);
+    BIO_get_mem_ptr(bio, &bufferPtr);
+
+    std::string encoded(bufferPtr->data, bufferPtr->length);
+    BIO_free_all(bio);
+    return encoded;
+}
@@ -0,0 +1,156 @@
+#include "../../include/TopicRouter.h"
+#include <algorithm>
+#include <mutex>
+
+TopicRouter::TopicRouter() : next_id_(1) {
+}
+
+uint64_t TopicRouter::add(const std::string& filter, Delivery delivery, Handler handler) {
+    if (!valid_filter(filter) || !handler) {
+        return 0;
+    }
+
+    auto route = std::make_shared<Route>();
+    route->filter = filter;
+    route->delivery = delivery;
+    route->handler = std::move(handler);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    route->id = next_id_++;
+    Node* node = &root_;
+    for (std::string_view level : split(filter)) {
+        auto it = node->children.find(level);
+        if (it == node->children.end()) {
+            it = node->children.emplace(std::string(level), std::make_unique<Node>()).first;
+        }
+        node = it->second.get();
+    }
+    node->routes.push_back(route);
+    routes_[route->id] = route;
+    return route->id;
+}
+
+bool TopicRouter::remove(uint64_t id, std::string& unused_filter) {
+    unused_filter.clear();
+
+    std::shared_ptr<Route> route;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = routes_.find(id);
+        if (it == routes_.end()) {
+            return false;
+        }
+        route = it->second;
+        routes_.erase(it);
+
+        bool filter_unused = false;
+        prune(root_, split(route->filter), 0, id, filter_unused);
+        if (filter_unused) {
+            unused_filter = route->filter;
+        }
+    }
+
+    // Outside the router lock: a running handler may be adding handlers
+    std::lock_guard<std::recursive_mutex> call_lock(route->call_mutex);
+    route->active = false;
+    return true;
+}
+
+std::vector<std::shared_ptr<const TopicRouter::Route>> TopicRouter::match(std::string_view topic) const {
+    std::vector<std::shared_ptr<const Route>> matches;
+    std::vector<std::string_view> levels = split(topic);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    // Wildcards never match the broker's own $SYS-style topics
+    if (!topic.empty() && topic.front() == '$') {
+        auto it = root_.children.find(levels.front());
+        if (it != root_.children.end()) {
+            collect(*it->second, levels, 1, matches);
+        }
+        return matches;
+    }
+    collect(root_, levels, 0, matches);
+    return matches;
+}
+
+std::vector<std::string> TopicRouter::filters() const {
+    std::vector<std::string> filters;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& entry : routes_) {
+        if (std::find(filters.begin(), filters.end(), entry.second->filter) == filters.end()) {
+            filters.push_back(entry.second->filter);
+        }
+    }
+    return filters;
+}
+
+bool TopicRouter::valid_filter(const std::string& filter) {
+    if (filter.empty()) {
+        return false;
+    }
+    std::vector<std::string_view> levels = split(filter);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        std::string_view level = levels[i];
+        if (level.find_first_of("+#") == std::string_view::npos) {
+            continue;
+        }
+        if (level.size() != 1 || (level == "#" && i + 1 != levels.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string_view> TopicRouter::split(std::string_view topic) {
+    std::vector<std::string_view> levels;
+    size_t start = 0;
+    while (true) {
+        size_t end = topic.find('/', start);
+        if (end == std::string_view::npos) {
+            levels.push_back(topic.substr(start));
+            return levels;
+        }
+        levels.push_back(topic.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void TopicRouter::collect(const Node& node, const std::vector<std::string_view>& levels, size_t level,
+                          std::vector<std::shared_ptr<const Route>>& matches) {
+    // "#" also matches its parent level, so "a/#" takes "a"
+    auto multi = node.children.find("#");
+    if (multi != node.children.end()) {
+        matches.insert(matches.end(), multi->second->routes.begin(), multi->second->routes.end());
+    }
+
+    if (level == levels.size()) {
+        matches.insert(matches.end(), node.routes.begin(), node.routes.end());
+        return;
+    }
+
+    auto exact = node.children.find(levels[level]);
+    if (exact != node.children.end()) {
+        collect(*exact->second, levels, level + 1, matches);
+    }
+    auto single = node.children.find("+");
+    if (single != node.children.end()) {
+        collect(*single->second, levels, level + 1, matches);
+    }
+}
+
+bool TopicRouter::prune(Node& node, const std::vector<std::string_view>& levels, size_t level, uint64_t id,
+                        bool& filter_unused) {
+    if (level == levels.size()) {
+        node.routes.erase(std::remove_if(node.routes.begin(), node.routes.end(),
+                                         [id](const std::shared_ptr<Route>& route) { return route->id == id; }),
+                          node.routes.end());
+        filter_unused = node.routes.empty();
+    } else {
+        auto it = node.children.find(levels[level]);
+        if (it != node.children.end() && prune(*it->second, levels, level + 1, id, filter_unused)) {
+            node.children.erase(it);
+        }
+    }
+    // Empty nodes are dropped so the trie only holds registered filters
+    return node.routes.empty() && node.children.empty();
+}
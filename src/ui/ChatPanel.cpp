@@ -1,4 +1,5 @@
 #include "../include/ChatPanel.h"
+#include "../include/MqttTopics.h"
 #include <iostream>
 #include <chrono>
 #include <ctime>
@@ -60,18 +61,27 @@ ChatPanel::ChatPanel(std::shared_ptr<MqttClient> mqtt_client)
     setup_ui();
     
     if (mqtt_client_) {
-        mqtt_client_->set_message_callback(
-            sigc::mem_fun(*this, &ChatPanel::on_mqtt_message));
-        
-        // Subscribe to the unified topic
-        mqtt_client_->subscribe("sauron"); 
+        // Replies from the agent, handled on the main loop; the client
+        // subscribes once it connects
+        for (const char* type : {"assistant_message", "conversation_created", "conversation_history",
+                                 "conversation_list", "error"}) {
+            mqtt_handlers_.push_back(mqtt_client_->add_handler(
+                MqttTopics::subscription("ui", type),
+                [this](std::string_view topic, std::string_view payload) { on_mqtt_message(topic, payload); },
+                MqttClient::Delivery::MainLoop));
+        }
     }
     
     add_system_message("Welcome to SauronEye AI Chat. Type a message to start a conversation.");
 }
 
 ChatPanel::~ChatPanel() {
-    // Clean up any resources if needed
+    // Replies still queued for the main loop must not reach a deleted panel
+    if (mqtt_client_) {
+        for (auto id : mqtt_handlers_) {
+            mqtt_client_->remove_handler(id);
+        }
+    }
 }
 
 void ChatPanel::setup_ui() {
@@ -202,7 +212,7 @@ void ChatPanel::on_new_conversation_clicked() {
 
     std::string request_str = request_json.dump(); // Serialize JSON object to string
 
-    if (mqtt_client_->publish("sauron", request_str)) { // Use unified topic
+    if (mqtt_client_->publish(MqttTopics::make("ui", "agent", "start_conversation"), request_str)) {
         add_system_message("Starting new conversation...");
         clear_messages();
     } else {
@@ -234,7 +244,7 @@ void ChatPanel::on_load_conversation_clicked() {
 
     std::string request_str = request_json.dump();
 
-    if (mqtt_client_->publish("sauron", request_str)) { // Use unified topic
+    if (mqtt_client_->publish(MqttTopics::make("ui", "agent", "list_conversations"), request_str)) {
         add_system_message("Requesting conversation list..."); // Changed message
     } else {
         add_system_message("Failed to request conversation list."); // Changed message
@@ -293,7 +303,7 @@ void ChatPanel::load_conversation_list_dialog(const nlohmann::json& conversation
 
         std::string request_str = request_json.dump();
 
-        if (mqtt_client_->publish("sauron", request_str)) { // Use unified topic
+        if (mqtt_client_->publish(MqttTopics::make("ui", "agent", "load_conversation"), request_str)) {
             add_system_message("Loading conversation " + selected_id_str + "...");
             clear_messages(); // Clear messages while waiting for history
         } else {
@@ -344,7 +354,7 @@ void ChatPanel::send_message() {
     std::string message_str = message_json.dump();
 
     std::cout << "DEBUG: Attempting to send message directly: " << message_str << std::endl;
-    if (mqtt_client_->publish("sauron", message_str)) { // Use unified topic
+    if (mqtt_client_->publish(MqttTopics::make("ui", "agent", "text"), message_str)) {
         std::cout << "DEBUG: Successfully published message" << std::endl;
         selected_image_path_ = "";
     } else {
@@ -353,30 +363,17 @@ void ChatPanel::send_message() {
     }
 }
 
-void ChatPanel::on_mqtt_message(const std::string& topic, const std::string& payload) {
-    // Only process messages on the unified topic
-    if (topic != "sauron") {
+void ChatPanel::on_mqtt_message(std::string_view topic, std::string_view payload) {
+    // Only process messages addressed to the UI
+    std::string from, to, type;
+    if (!MqttTopics::parse(std::string(topic), from, to, type) || to != "ui") {
         return;
     }
     
     try {
-        // Parse the payload using nlohmann::json
+        // Parse the payload using nlohmann::json; the topic already gave its type
         auto json_payload = nlohmann::json::parse(payload);
 
-        // Check if the message is intended for the UI
-        if (!json_payload.contains("to") || json_payload["to"] != "ui") {
-            // std::cout << "Ignoring message not for UI: " << payload << std::endl; // Optional debug
-            return;
-        }
-
-        // Check if 'type' field exists
-        if (!json_payload.contains("type") || !json_payload["type"].is_string()) { // Check type is string
-             std::cerr << "Received message without string 'type' field: " << payload << std::endl;
-             return;
-        }
-
-        std::string type = json_payload["type"];
-
         // Helper lambda to safely get string value
         auto get_string = [&](const nlohmann::json& obj, const std::string& key, const std::string& default_val = "") -> std::string {
             return obj.contains(key) && obj[key].is_string() ? obj[key].get<std::string>() : default_val;
@@ -395,78 +392,62 @@ void ChatPanel::on_mqtt_message(const std::string& topic, const std::string& pay
         };
 
 
+        // Already on the main loop, so the UI is updated directly
         if (type == "assistant_message") {
             std::string message = get_string(json_payload, "message");
             int conv_id = get_int(json_payload, "conversation_id");
             if (conv_id >= 0) active_conversation_id_ = conv_id; // Update active ID if provided
 
-            Glib::signal_idle().connect_once([this, message]() {
-                add_assistant_message(message);
-            });
+            add_assistant_message(message);
         } else if (type == "conversation_created") {
             active_conversation_id_ = get_int(json_payload, "conversation_id");
             std::string title = get_string(json_payload, "title");
 
-            Glib::signal_idle().connect_once([this, title]() {
-                add_system_message("New conversation started: " + title);
-                // Optionally update conversation combo box here if needed
-            });
+            add_system_message("New conversation started: " + title);
+            // Optionally update conversation combo box here if needed
         } else if (type == "conversation_history") {
              active_conversation_id_ = get_int(json_payload, "conversation_id");
              std::string title = get_string(json_payload, "title");
 
              // Clear existing messages and add history
-             // Capture necessary variables by reference [&]
-             Glib::signal_idle().connect_once([&, this, title, json_payload]() {
-                 clear_messages();
-                 add_system_message("Loaded conversation: " + title);
-                 if (json_payload.contains("messages") && json_payload["messages"].is_array()) {
-                     for (const auto& msg_json : json_payload["messages"]) {
-                         std::string msg_text = get_string(msg_json, "content");
-                         std::string msg_role = get_string(msg_json, "role");
-                         std::string img_path = get_string(msg_json, "image_path");
-
-                         if (msg_role == "user") {
-                             add_user_message(msg_text, img_path);
-                         } else if (msg_role == "assistant") {
-                             add_assistant_message(msg_text);
-                         }
-                         // Ignore system messages in history for now? Or add them?
+             clear_messages();
+             add_system_message("Loaded conversation: " + title);
+             if (json_payload.contains("messages") && json_payload["messages"].is_array()) {
+                 for (const auto& msg_json : json_payload["messages"]) {
+                     std::string msg_text = get_string(msg_json, "content");
+                     std::string msg_role = get_string(msg_json, "role");
+                     std::string img_path = get_string(msg_json, "image_path");
+
+                     if (msg_role == "user") {
+                         add_user_message(msg_text, img_path);
+                     } else if (msg_role == "assistant") {
+                         add_assistant_message(msg_text);
                      }
+                     // Ignore system messages in history for now? Or add them?
                  }
-             });
+             }
 
         } else if (type == "conversation_list") {
-             Glib::signal_idle().connect_once([this, json_payload]() {
-                 if (json_payload.contains("conversations")) {
-                     // Call the function to show the dialog with the received list
-                     load_conversation_list_dialog(json_payload["conversations"]);
-                 } else {
-                      add_system_message("Received empty or invalid conversation list data.");
-                 }
-             });
+             if (json_payload.contains("conversations")) {
+                 // Call the function to show the dialog with the received list
+                 load_conversation_list_dialog(json_payload["conversations"]);
+             } else {
+                  add_system_message("Received empty or invalid conversation list data.");
+             }
         } else if (type == "error") {
             std::string error_message = get_string(json_payload, "message", "Unknown error from agent.");
-            Glib::signal_idle().connect_once([this, error_message]() {
-                add_system_message("Error from agent: " + error_message);
-            });
+            add_system_message("Error from agent: " + error_message);
         } else {
              std::cerr << "Received unknown message type: " << type << std::endl;
-             Glib::signal_idle().connect_once([this, type]() {
-                 add_system_message("Received unhandled message type from agent: " + type);
-             });
+             add_system_message("Received unhandled message type from agent: " + type);
         }
     } catch (const nlohmann::json::parse_error& e) {
         std::cerr << "Error parsing incoming JSON (nlohmann): " << e.what() << std::endl;
         std::cerr << "Payload: " << payload << std::endl;
-        Glib::signal_idle().connect_once([this]() {
-            add_system_message("Error parsing message from agent.");
-        });
+        add_system_message("Error parsing message from agent.");
     } catch (const std::exception& e) {
         std::cerr << "Error processing MQTT message: " << e.what() << std::endl;
-         Glib::signal_idle().connect_once([this]() {
-            add_system_message("Error processing message from agent.");
-        });
+        add_system_message("Error processing message from agent.");
     }
 }
 
@@ -625,7 +606,7 @@ void ChatPanel::add_capture_message(const std::string& filepath) {
 
         std::string message_str = message_json.dump();
 
-        if (mqtt_client_->publish("sauron", message_str)) { // Use unified topic
+        if (mqtt_client_->publish(MqttTopics::make("ui", "agent", "user_message"), message_str)) {
             // Optionally add a system message confirming send
             // add_system_message("Capture sent to agent.");
         } else {
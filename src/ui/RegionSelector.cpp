@@ -0,0 +1,163 @@
+#include "../../include/RegionSelector.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+// Smaller selections are taken for a click and cancel
+static const unsigned int MIN_SELECTION_SIZE = 4;
+
+RegionSelector::RegionSelector(RawImage desktop) :
+    Gtk::Window(Gtk::WINDOW_POPUP),
+    desktop_(std::move(desktop)),
+    dragging_(false),
+    start_x_(0), start_y_(0),
+    end_x_(0), end_y_(0) {
+    // The still is drawn straight from the capture buffer
+    desktop_surface_ = Cairo::ImageSurface::create(desktop_.pixels.data(), Cairo::FORMAT_ARGB32,
+                                                   desktop_.width, desktop_.height, desktop_.stride);
+
+    set_app_paintable(true);
+    add_events(Gdk::BUTTON_PRESS_MASK | Gdk::BUTTON_RELEASE_MASK |
+               Gdk::POINTER_MOTION_MASK | Gdk::KEY_PRESS_MASK);
+
+    // A popup is not managed, so it can cover every monitor
+    move(0, 0);
+    resize(desktop_.width, desktop_.height);
+}
+
+RegionSelector::~RegionSelector() {
+    selected_timeout_.disconnect();
+}
+
+bool RegionSelector::on_map_event(GdkEventAny* event) {
+    // Pointer and keyboard belong to the overlay until the selection is done
+    auto seat = get_display()->get_default_seat();
+    if (seat) {
+        seat->grab(get_window(), Gdk::SEAT_CAPABILITY_ALL, false,
+                   Gdk::Cursor::create(get_display(), Gdk::CROSSHAIR));
+    }
+    return Gtk::Window::on_map_event(event);
+}
+
+bool RegionSelector::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
+    cr->set_source(desktop_surface_, 0, 0);
+    cr->paint();
+
+    // Dim everything outside the selection
+    X11ScreenCapturer::CaptureRect region = selection();
+    cr->set_fill_rule(Cairo::FILL_RULE_EVEN_ODD);
+    cr->rectangle(0, 0, desktop_.width, desktop_.height);
+    if (dragging_) {
+        cr->rectangle(region.x, region.y, region.width, region.height);
+    }
+    cr->set_source_rgba(0.0, 0.0, 0.0, 0.5);
+    cr->fill();
+
+    if (dragging_) {
+        cr->set_source_rgb(0.2, 0.6, 1.0);
+        cr->set_line_width(1.0);
+        cr->rectangle(region.x + 0.5, region.y + 0.5, region.width, region.height);
+        cr->stroke();
+
+        // Size above the selection, or inside it at the top of the desktop
+        std::string size = std::to_string(region.width) + "x" + std::to_string(region.height);
+        cr->set_font_size(14.0);
+        cr->move_to(region.x + 4, region.y >= 20 ? region.y - 6 : region.y + 18);
+        cr->show_text(size);
+    }
+    return true;
+}
+
+bool RegionSelector::on_button_press_event(GdkEventButton* event) {
+    if (event->button == 3) {
+        cancel();
+        return true;
+    }
+
+    if (event->button == 1) {
+        dragging_ = true;
+        start_x_ = end_x_ = event->x;
+        start_y_ = end_y_ = event->y;
+        queue_draw();
+    }
+    return true;
+}
+
+bool RegionSelector::on_motion_notify_event(GdkEventMotion* event) {
+    if (dragging_) {
+        end_x_ = event->x;
+        end_y_ = event->y;
+        queue_draw();
+    }
+    return true;
+}
+
+bool RegionSelector::on_button_release_event(GdkEventButton* event) {
+    if (event->button != 1 || !dragging_) {
+        return true;
+    }
+
+    end_x_ = event->x;
+    end_y_ = event->y;
+    X11ScreenCapturer::CaptureRect region = selection();
+
+    // Window coordinates to desktop coordinates
+    int origin_x = 0, origin_y = 0;
+    get_window()->get_origin(origin_x, origin_y);
+    region.x += origin_x;
+    region.y += origin_y;
+
+    if (region.width < MIN_SELECTION_SIZE || region.height < MIN_SELECTION_SIZE) {
+        cancel();
+        return true;
+    }
+    close_overlay();
+
+    // Give the compositor time to repaint the area the overlay covered
+    // before anything captures it
+    selected_timeout_ = Glib::signal_timeout().connect_once([this, region]() {
+        m_signal_region_selected.emit(region);
+    }, 150);
+    return true;
+}
+
+bool RegionSelector::on_key_press_event(GdkEventKey* event) {
+    if (event->keyval == GDK_KEY_Escape) {
+        cancel();
+        return true;
+    }
+    return Gtk::Window::on_key_press_event(event);
+}
+
+bool RegionSelector::on_delete_event(GdkEventAny* /* event */) {
+    cancel();
+    return true;
+}
+
+X11ScreenCapturer::CaptureRect RegionSelector::selection() const {
+    double left = std::min(start_x_, end_x_);
+    double top = std::min(start_y_, end_y_);
+    X11ScreenCapturer::CaptureRect region;
+    region.x = static_cast<int>(std::floor(left));
+    region.y = static_cast<int>(std::floor(top));
+    region.width = static_cast<unsigned int>(std::ceil(std::max(start_x_, end_x_)) - region.x);
+    region.height = static_cast<unsigned int>(std::ceil(std::max(start_y_, end_y_)) - region.y);
+    return region;
+}
+
+void RegionSelector::close_overlay() {
+    dragging_ = false;
+
+    auto seat = get_display()->get_default_seat();
+    if (seat) {
+        seat->ungrab();
+    }
+    hide();
+}
+
+void RegionSelector::cancel() {
+    std::cout << "✖️ Region selection cancelled" << std::endl;
+    close_overlay();
+    m_signal_cancelled.emit();
+}
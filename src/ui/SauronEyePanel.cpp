@@ -1,13 +1,25 @@
 #include "../include/SauronEyePanel.h"
+#include "../include/ImageFormat.h"
+#include "../include/MqttTopics.h"
 #include <iostream>
-#include <thread>
 #include <chrono>
 #include <filesystem>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 #include <gtkmm/icontheme.h>
 #include <glibmm/main.h>
 
+// Local time stamp used in capture file and folder names
+static std::string capture_timestamp() {
+    auto time_t_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm = *std::localtime(&time_t_now);
+    std::stringstream ss;
+    ss << std::put_time(&tm, "%Y%m%d_%H%M%S");
+    return ss.str();
+}
+
 SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer, 
                              std::shared_ptr<MqttClient> mqtt_client)
     : Gtk::Box(Gtk::ORIENTATION_VERTICAL, 5),
@@ -126,11 +138,18 @@ SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer,
     capture_screen_button_.signal_clicked().connect(
         sigc::mem_fun(*this, &SauronEyePanel::on_capture_screen_clicked));
     
+    capture_monitors_button_.set_label("Capture Monitors");
+    capture_monitors_button_.set_image_from_icon_name("video-display");
+    capture_monitors_button_.set_tooltip_text("Capture each monitor as its own image");
+    capture_monitors_button_.signal_clicked().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_capture_monitors_clicked));
+    
     // Create button box
     Gtk::Box* screen_button_box = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL));
     screen_button_box->set_spacing(5);
     screen_button_box->pack_start(refresh_screens_button_, Gtk::PACK_SHRINK);
     screen_button_box->pack_end(capture_screen_button_, Gtk::PACK_SHRINK);
+    screen_button_box->pack_end(capture_monitors_button_, Gtk::PACK_SHRINK);
     
     // Add components to screens box
     screens_box_.pack_start(screens_scrolled_window_, Gtk::PACK_EXPAND_WIDGET);
@@ -139,6 +158,50 @@ SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer,
     // Add screens box to frame
     screens_frame_.add(screens_box_);
     
+    // ===== Regions Section =====
+    regions_frame_.set_label(" Regions ");
+    regions_frame_.set_label_align(Gtk::ALIGN_START);
+    regions_frame_.set_shadow_type(Gtk::SHADOW_ETCHED_IN);
+    
+    regions_box_.set_orientation(Gtk::ORIENTATION_HORIZONTAL);
+    regions_box_.set_spacing(5);
+    regions_box_.set_margin_top(10);
+    regions_box_.set_margin_bottom(10);
+    regions_box_.set_margin_start(10);
+    regions_box_.set_margin_end(10);
+    
+    regions_combo_.set_tooltip_text("Saved regions, Ctrl+Numpad 1-9 captures them");
+    
+    capture_region_button_.set_label("Capture");
+    capture_region_button_.set_image_from_icon_name("camera-photo");
+    capture_region_button_.signal_clicked().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_capture_region_clicked));
+    
+    remove_region_button_.set_label("Remove");
+    remove_region_button_.set_image_from_icon_name("list-remove");
+    remove_region_button_.signal_clicked().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_remove_region_clicked));
+    
+    region_name_entry_.set_placeholder_text("Save as...");
+    region_name_entry_.set_width_chars(12);
+    region_name_entry_.set_tooltip_text("Name to save the next selected region under");
+    
+    select_region_button_.set_label("Select Region");
+    select_region_button_.set_image_from_icon_name("edit-select-all");
+    select_region_button_.set_tooltip_text("Drag a rectangle on the desktop and capture it; "
+                                           "inside the selected window it follows the window");
+    select_region_button_.signal_clicked().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_select_region_clicked));
+    
+    regions_box_.pack_start(regions_combo_, Gtk::PACK_EXPAND_WIDGET);
+    regions_box_.pack_start(capture_region_button_, Gtk::PACK_SHRINK);
+    regions_box_.pack_start(remove_region_button_, Gtk::PACK_SHRINK);
+    regions_box_.pack_end(select_region_button_, Gtk::PACK_SHRINK);
+    regions_box_.pack_end(region_name_entry_, Gtk::PACK_SHRINK);
+    
+    regions_frame_.add(regions_box_);
+    refresh_region_list();
+    
     // ===== Options Section =====
     options_frame_.set_label(" Options ");
     options_frame_.set_label_align(Gtk::ALIGN_START);
@@ -164,9 +227,77 @@ SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer,
     
     delay_box_.pack_start(delay_label_, Gtk::PACK_SHRINK);
     delay_box_.pack_start(delay_spin_, Gtk::PACK_SHRINK);
+    delay_box_.pack_start(queue_status_label_, Gtk::PACK_SHRINK);
+    
+    // Configure save option
+    save_to_disk_check_.set_label("Save captures to disk");
+    save_to_disk_check_.set_active(true);
     
-    // Add delay option to options box
+    // Configure change detection
+    skip_unchanged_check_.set_label("Skip unchanged captures");
+    skip_unchanged_check_.set_tooltip_text("Do not encode, save or send a capture identical to the previous "
+                                           "capture of the same window, screen or region; when off the "
+                                           "previous capture is sent again");
+    skip_unchanged_check_.set_active(true);
+    
+    // Configure output format options
+    format_box_.set_orientation(Gtk::ORIENTATION_HORIZONTAL);
+    format_box_.set_spacing(5);
+    
+    format_label_.set_text("Format:");
+    format_label_.set_halign(Gtk::ALIGN_START);
+    
+    format_combo_.append("png", "PNG");
+    format_combo_.append("jpeg", "JPEG");
+    if (ImageEncoder::is_format_available("webp")) {
+        format_combo_.append("webp", "WebP");
+    }
+    format_combo_.set_active_id(screen_capturer_->get_output_format());
+    format_combo_.signal_changed().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_format_changed));
+    
+    quality_label_.set_text("Quality:");
+    quality_spin_.set_range(1, 100);
+    quality_spin_.set_increments(5, 10);
+    quality_spin_.set_value(screen_capturer_->get_quality());
+    quality_spin_.set_sensitive(screen_capturer_->get_output_format() != "png");
+    quality_spin_.signal_value_changed().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_quality_changed));
+    
+    format_box_.pack_start(format_label_, Gtk::PACK_SHRINK);
+    format_box_.pack_start(format_combo_, Gtk::PACK_SHRINK);
+    format_box_.pack_start(quality_label_, Gtk::PACK_SHRINK);
+    format_box_.pack_start(quality_spin_, Gtk::PACK_SHRINK);
+    
+    // Configure continuous capture options
+    continuous_box_.set_orientation(Gtk::ORIENTATION_HORIZONTAL);
+    continuous_box_.set_spacing(5);
+    
+    continuous_check_.set_label("Continuous capture");
+    continuous_check_.set_tooltip_text("Capture the selected window or screen in the background; "
+                                       "captures then use the latest frame");
+    continuous_check_.signal_toggled().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_continuous_toggled));
+    
+    continuous_fps_label_.set_text("FPS:");
+    continuous_fps_spin_.set_digits(1);
+    continuous_fps_spin_.set_range(0.5, 30);
+    continuous_fps_spin_.set_increments(0.5, 5);
+    continuous_fps_spin_.set_value(continuous_capture_.get_fps());
+    continuous_fps_spin_.signal_value_changed().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_continuous_fps_changed));
+    
+    continuous_box_.pack_start(continuous_check_, Gtk::PACK_SHRINK);
+    continuous_box_.pack_start(continuous_fps_label_, Gtk::PACK_SHRINK);
+    continuous_box_.pack_start(continuous_fps_spin_, Gtk::PACK_SHRINK);
+    continuous_box_.pack_start(continuous_status_label_, Gtk::PACK_SHRINK);
+    
+    // Add delay, format, save and continuous options to options box
     options_box_.pack_start(delay_box_, Gtk::PACK_SHRINK);
+    options_box_.pack_start(format_box_, Gtk::PACK_SHRINK);
+    options_box_.pack_start(save_to_disk_check_, Gtk::PACK_SHRINK);
+    options_box_.pack_start(skip_unchanged_check_, Gtk::PACK_SHRINK);
+    options_box_.pack_start(continuous_box_, Gtk::PACK_SHRINK);
     
     // Add options box to frame
     options_frame_.add(options_box_);
@@ -174,6 +305,7 @@ SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer,
     // Add all sections to main box
     pack_start(windows_frame_, Gtk::PACK_EXPAND_WIDGET);
     pack_start(screens_frame_, Gtk::PACK_EXPAND_WIDGET);
+    pack_start(regions_frame_, Gtk::PACK_SHRINK);
     pack_start(options_frame_, Gtk::PACK_SHRINK);
     
     // Populate initial data
@@ -185,6 +317,8 @@ SauronEyePanel::SauronEyePanel(std::shared_ptr<X11ScreenCapturer> capturer,
         // Connect to the window list changed signal
         screen_capturer_->signal_window_list_changed().connect(
             sigc::mem_fun(*this, &SauronEyePanel::refresh_window_list));
+        screen_capturer_->signal_screens_changed().connect(
+            sigc::mem_fun(*this, &SauronEyePanel::refresh_screen_list));
         std::cout << "✅ Connected to window events for automatic refresh" << std::endl;
     } else {
         std::cout << "⚠️ Automatic window list refresh not available" << std::endl;
@@ -203,6 +337,12 @@ SauronEyePanel::~SauronEyePanel() {
         auto_refresh_connection_.disconnect();
     }
     
+    if (continuous_status_connection_.connected()) {
+        continuous_status_connection_.disconnect();
+    }
+    replay_buffer_.stop();
+    continuous_capture_.stop();
+    
     // Stop window event monitoring
     if (screen_capturer_ && screen_capturer_->is_monitoring_window_events()) {
         screen_capturer_->stop_window_events_monitoring();
@@ -286,16 +426,7 @@ void SauronEyePanel::on_capture_window_clicked() {
     if (iter) {
         Gtk::TreeModel::Row row = *iter;
         unsigned long window_id = row[windows_columns_.m_col_id];
-        
-        std::string filepath = take_capture("window", window_id);
-        if (!filepath.empty() && mqtt_client_) {
-            std::string topic = "sauron"; // Use unified MQTT topic
-            bool use_base64 = true;
-            // Pass routing info properly encoded
-            std::string routing = "to:agent,from:ui,type:image";
-            mqtt_client_->publish_image(topic, filepath, routing, "window", use_base64);
-            std::cout << "✅ Published capture to MQTT: " << filepath << std::endl;
-        }
+        take_capture("window", window_id, "", true);
     } else {
         std::cerr << "❌ No window selected" << std::endl;
     }
@@ -314,35 +445,74 @@ void SauronEyePanel::on_capture_screen_clicked() {
         int screen_id = row[screens_columns_.m_col_id];
         
         // Use the screen_id in place of window_id for screen capture
-        std::string filepath = take_capture("screen", screen_id);
-        if (!filepath.empty() && mqtt_client_) {
-            std::string topic = "sauron"; // Use unified MQTT topic
-            bool use_base64 = true;
-            // Pass routing info in a format that won't break JSON
-            std::string routing = "to:agent,from:ui,type:image";
-            mqtt_client_->publish_image(topic, filepath, routing, "screen", use_base64);
-            std::cout << "✅ Published screen capture to MQTT: " << filepath << std::endl;
-        }
+        take_capture("screen", screen_id, "", true);
     } else {
         std::cerr << "❌ No screen selected" << std::endl;
     }
 }
 
+void SauronEyePanel::on_capture_monitors_clicked() {
+    // Grabbed and encoded on the capture thread, saved and published on the
+    // main loop
+    struct Monitor {
+        std::string name;
+        std::shared_ptr<EncodedImage> encoded;
+    };
+    auto monitors = std::make_shared<std::vector<Monitor>>();
+    ImageScaler::Limits limits = get_scale_limits("monitors");
+    std::vector<X11ScreenCapturer::MonitorImage>& buffers = monitor_images_;
+    auto job = [monitors, limits, &buffers](X11ScreenCapturer& capturer, RawImage& /* raw */) {
+        if (!capturer.capture_monitors_encoded(buffers, limits)) {
+            return false;
+        }
+        monitors->clear();
+        for (auto& monitor : buffers) {
+            monitors->push_back({monitor.screen.name, std::make_shared<EncodedImage>(std::move(monitor.encoded))});
+        }
+        return true;
+    };
+
+    auto done = [this, monitors](uint64_t job_id, std::shared_ptr<RawImage> raw) {
+        Glib::signal_idle().connect_once([this, monitors, job_id, raw]() {
+            update_queue_status();
+            if (!raw) {
+                std::cerr << "❌ Failed to capture monitors (capture " << job_id << ")" << std::endl;
+                return;
+            }
+            if (monitors->empty()) {
+                // Joined a pending monitors capture, which saves and publishes it
+                return;
+            }
+
+            std::filesystem::path directory = std::filesystem::absolute("captures/monitors_" + capture_timestamp());
+            std::vector<std::shared_ptr<const EncodedImage>> images;
+            for (const auto& monitor : *monitors) {
+                images.push_back(monitor.encoded);
+
+                if (save_to_disk_check_.get_active()) {
+                    std::string name = monitor.name + ImageFormat::extension(monitor.encoded->format);
+                    capture_writer_.write((directory / name).string(), monitor.encoded);
+                }
+            }
+
+            if (mqtt_client_ && mqtt_client_->is_connected()) {
+                std::string topic = MqttTopics::make("ui", "agent", "image_sequence");
+                std::string routing = "to:agent,from:ui,type:image_sequence";
+                mqtt_client_->publish_images(topic, images, {}, routing, "monitors");
+            }
+        });
+    };
+
+    schedule_capture("monitors", "monitors", job, done);
+}
+
 void SauronEyePanel::on_tree_view_row_activated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn* /* column */) {
     Gtk::TreeModel::iterator iter = windows_list_store_->get_iter(path);
     if (iter) {
         Gtk::TreeModel::Row row = *iter;
         unsigned long window_id = row[windows_columns_.m_col_id];
         // Capture and immediately publish on double-click
-        std::string filepath = take_capture("window", window_id);
-        if (!filepath.empty() && mqtt_client_) {
-            std::string topic = "sauron"; // Use unified MQTT topic
-            bool use_base64 = true;
-            // Pass routing info correctly
-            std::string routing = "to:agent,from:ui,type:image";
-            mqtt_client_->publish_image(topic, filepath, routing, "window-double-click", use_base64); // Updated trigger_type
-            std::cout << "✅ Published window capture (double-click) to MQTT: " << filepath << std::endl; // Added log
-        }
+        take_capture("window", window_id, "window-double-click", true);
     }
 }
 
@@ -352,15 +522,7 @@ void SauronEyePanel::on_screens_row_activated(const Gtk::TreeModel::Path& path,
         Gtk::TreeModel::Row row = *iter;
         int screen_id = row[screens_columns_.m_col_id];
         // Capture and immediately publish on double-click
-        std::string filepath = take_capture("screen", screen_id);
-        if (!filepath.empty() && mqtt_client_) {
-            std::string topic = "sauron"; // Use unified MQTT topic
-            bool use_base64 = true;
-            // Pass routing info correctly
-            std::string routing = "to:agent,from:ui,type:image";
-            mqtt_client_->publish_image(topic, filepath, routing, "screen-double-click", use_base64); // Updated trigger_type
-            std::cout << "✅ Published screen capture (double-click) to MQTT: " << filepath << std::endl; // Added log
-        }
+        take_capture("screen", screen_id, "screen-double-click", true);
     }
 }
 
@@ -368,11 +530,11 @@ void SauronEyePanel::trigger_capture() {
     trigger_capture("manual");
 }
 
-void SauronEyePanel::trigger_capture(const std::string& /* trigger_type */) {
+void SauronEyePanel::trigger_capture(const std::string& trigger_type) {
     auto selected_window = get_selected_window();
     
     if (selected_window) {
-        take_capture("window", selected_window->id);
+        take_capture("window", selected_window->id, trigger_type);
     } else {
         // No window selected, try to capture the first screen
         if (!screens_list_store_->children().empty()) {
@@ -380,7 +542,7 @@ void SauronEyePanel::trigger_capture(const std::string& /* trigger_type */) {
             if (iter) {
                 Gtk::TreeModel::Row row = *iter;
                 unsigned long screen_id = row[screens_columns_.m_col_id];
-                take_capture("screen", screen_id);
+                take_capture("screen", screen_id, trigger_type);
             }
         }
     }
@@ -389,10 +551,7 @@ void SauronEyePanel::trigger_capture(const std::string& /* trigger_type */) {
 void SauronEyePanel::perform_capture() {
     auto selected_window = get_selected_window();
     if (selected_window) {
-        std::string filepath = take_capture("window", selected_window->id);
-        if (!filepath.empty()) {
-            std::cout << "Captured window to: " << filepath << std::endl;
-        }
+        take_capture("window", selected_window->id);
     } else {
         std::cerr << "No window selected for capture" << std::endl;
     }
@@ -404,12 +563,10 @@ std::optional<X11ScreenCapturer::WindowInfo> SauronEyePanel::get_selected_window
     if (!iter) return std::nullopt;
     auto row = *iter;
     unsigned long window_id = row[windows_columns_.m_col_id];
-    // Directly lookup full WindowInfo from capturer
-    auto windows = screen_capturer_->list_windows();
-    for (const auto& w : windows) {
-        if (w.id == window_id) {
-            return w;
-        }
+    // Directly lookup full WindowInfo from capturer (window table, no round trips)
+    X11ScreenCapturer::WindowInfo info;
+    if (screen_capturer_->find_window(window_id, info)) {
+        return info;
     }
     return std::nullopt;
 }
@@ -444,60 +601,273 @@ std::string SauronEyePanel::generate_capture_filename(const std::string& type) {
     
     // Add timestamp to filename
     std::tm tm = *std::localtime(&time_t_now);
-    ss << (type == "window" ? "window_" : "screen_")
-       << std::put_time(&tm, "%Y%m%d_%H%M%S") << ".png";
+    ss << type << "_"
+       << std::put_time(&tm, "%Y%m%d_%H%M%S")
+       << ImageFormat::extension(screen_capturer_->get_output_format());
     
     return ss.str();
 }
 
-std::string SauronEyePanel::take_capture(const std::string& type, unsigned long id) {
-    int delay_seconds = delay_spin_.get_value_as_int();
-    std::optional<X11ScreenCapturer::WindowInfo> window_info_opt;
-
-    if (delay_seconds > 0) {
-        std::cout << "⏱️ Capture will start in " << delay_seconds << " seconds..." << std::endl;
-        // Sleep for the specified delay
-        std::this_thread::sleep_for(std::chrono::seconds(delay_seconds));
+void SauronEyePanel::take_capture(const std::string& type, unsigned long id, const std::string& trigger,
+                                  bool publish) {
+    // The target is resolved now, the capture thread only grabs it when due
+    std::optional<X11ScreenCapturer::WindowInfo> window;
+    std::optional<X11ScreenCapturer::ScreenInfo> screen;
+    if (type == "window") {
+        window = get_selected_window();
+        if (!window) {
+            std::cerr << "❌ No window selected" << std::endl;
+            return;
+        }
+    } else if (type == "screen") {
+        screen = get_selected_screen();
+        if (!screen) {
+            std::cerr << "❌ No screen selected" << std::endl;
+            return;
+        }
+    } else {
+        std::cerr << "❌ Unknown capture type: " << type << std::endl;
+        return;
     }
 
-    std::string filename = generate_capture_filename(type);
-    std::string filepath = "";
+    // A continuous capture of the same target already has a recent frame
+    const ContinuousCapture& continuous = continuous_capture_;
+    auto job = [window, screen, id, &continuous](X11ScreenCapturer& capturer, RawImage& raw) {
+        auto ring_target = window ? ContinuousCapture::Target::Window : ContinuousCapture::Target::Screen;
+        FrameRing::Frame frame;
+        if (continuous.is_capturing(ring_target, id) && continuous.ring().read_latest(frame)) {
+            raw = std::move(frame.image);
+            return true;
+        }
+        if (screen) {
+            return capturer.capture_screen_raw(screen->number, raw);
+        }
+        // The window may have moved or been resized while waiting
+        X11ScreenCapturer::WindowInfo info = *window;
+        capturer.get_window_info(window->id, info);
+        return capturer.capture_window_raw(info, raw);
+    };
 
-    if (type == "window") {
-        window_info_opt = get_selected_window();
-        if (window_info_opt) {
-            auto window_info = window_info_opt.value();
-            if (screen_capturer_->capture_window(window_info, filename)) {
-                filepath = std::filesystem::absolute(filename).string();
-            } else {
-                std::cerr << "❌ Failed to capture window" << std::endl;
-                return "";
+    queue_capture(type, id, type + ":" + std::to_string(id), trigger, job, publish);
+}
+
+void SauronEyePanel::queue_capture(const std::string& type, unsigned long id, const std::string& target,
+                                   const std::string& trigger, CaptureScheduler::CaptureJob job, bool publish) {
+    ImageScaler::Limits limits = get_scale_limits(trigger.empty() ? type : trigger);
+    std::string label = trigger.empty() ? type : trigger;
+
+    // Tile hashing and encoding run on the capture thread after the grab,
+    // the main loop only gets the encoded image. A request that joins a
+    // waiting job drops its own job, so completions find the shared result
+    // by job id.
+    auto processed = std::make_shared<ProcessedCapture>();
+    processed->limits = limits;
+    ChangeDetector& detector = change_detector_;
+    auto grab_and_encode = [job, target, limits, processed, &detector](X11ScreenCapturer& capturer, RawImage& raw) {
+        if (!job(capturer, raw)) {
+            return false;
+        }
+        processed->change = detector.update(target, raw);
+        if (processed->change.is_unchanged()) {
+            return true;
+        }
+
+        auto encoded = std::make_shared<EncodedImage>();
+        if (!capturer.encode_image(raw, *encoded, limits)) {
+            std::cerr << "❌ Failed to encode capture" << std::endl;
+            detector.forget(target);
+            return false;
+        }
+
+        // Changed tiles, scaled like the image
+        const ChangeDetector::Change& change = processed->change;
+        if (change.has_previous && change.changed_tiles > 0 && raw.width > 0 && raw.height > 0) {
+            double scale_x = static_cast<double>(encoded->width) / raw.width;
+            double scale_y = static_cast<double>(encoded->height) / raw.height;
+            encoded->changed_x = static_cast<int>(std::floor(change.x * scale_x));
+            encoded->changed_y = static_cast<int>(std::floor(change.y * scale_y));
+            encoded->changed_width = std::min(encoded->width,
+                static_cast<int>(std::ceil((change.x + change.width) * scale_x))) - encoded->changed_x;
+            encoded->changed_height = std::min(encoded->height,
+                static_cast<int>(std::ceil((change.y + change.height) * scale_y))) - encoded->changed_y;
+            if (change.changed_tiles < change.total_tiles) {
+                std::cout << "🧩 " << change.changed_tiles << "/" << change.total_tiles << " tiles changed ("
+                          << change.width << "x" << change.height << " at " << change.x << "," << change.y
+                          << ")" << std::endl;
             }
-        } else {
-            std::cerr << "❌ No window selected" << std::endl;
-            return "";
         }
-    } else if (type == "screen") {
-        auto screen_info_opt = get_selected_screen();
-        if (screen_info_opt) {
-            auto screen_info = screen_info_opt.value();
-            if (screen_capturer_->capture_screen(screen_info.number, filename)) {
-                filepath = std::filesystem::absolute(filename).string();
+        processed->encoded = encoded;
+        return true;
+    };
+
+    // Completion runs on the capture thread, hand it to the main loop
+    auto done = [this, type, id, target, limits, label, publish](uint64_t job_id, std::shared_ptr<RawImage> raw) {
+        Glib::signal_idle().connect_once([this, type, id, target, limits, label, publish, job_id, raw]() {
+            update_queue_status();
+            auto pending = pending_captures_.find(job_id);
+            if (pending == pending_captures_.end()) {
+                return;
+            }
+            std::shared_ptr<ProcessedCapture> processed = pending->second.processed;
+            if (--pending->second.requests == 0) {
+                pending_captures_.erase(pending);
+            }
+            if (!raw) {
+                std::cerr << "❌ Capture " << job_id << " of " << target << " failed or was dropped" << std::endl;
+                return;
+            }
+
+            std::string filepath;
+            if (!processed->finished) {
+                filepath = finish_raw_capture(type, id, target, *raw, processed->change,
+                                              processed->encoded, processed->limits);
+                processed->filepath = filepath;
+                processed->finished = true;
+                if (!filepath.empty()) {
+                    // The new image, or the earlier one standing in for it
+                    processed->encoded = last_capture_;
+                }
+            } else if (limits.max_long_edge == processed->limits.max_long_edge &&
+                       limits.max_megapixels == processed->limits.max_megapixels) {
+                // A request that joined the job gets the same capture
+                filepath = processed->filepath;
+                if (!filepath.empty()) {
+                    last_capture_ = processed->encoded;
+                }
             } else {
-                std::cerr << "❌ Failed to capture screen" << std::endl;
-                return "";
+                // Joined with other size limits, so it gets its own image
+                auto encoded = std::make_shared<EncodedImage>();
+                if (!screen_capturer_->encode_image(*raw, *encoded, limits)) {
+                    std::cerr << "❌ Failed to encode capture" << std::endl;
+                    return;
+                }
+                filepath = finish_capture(type, id, encoded);
             }
-        } else {
-            std::cerr << "❌ No screen selected" << std::endl;
+
+            if (publish && !filepath.empty() && mqtt_client_) {
+                std::string topic = MqttTopics::make("ui", "agent", "image");
+                std::string routing = "to:agent,from:ui,type:image";
+                // Refused means the link is behind and the capture is dropped;
+                // delivered late means the link is slow
+                auto on_sent = [label](const MqttClient::PublishResult& result) {
+                    if (!result.delivered) {
+                        std::cerr << "❌ " << label << " capture not delivered: " << result.error << std::endl;
+                    } else if (result.latency > std::chrono::seconds(1)) {
+                        std::cout << "🐢 " << label << " capture took " << result.latency.count() << " ms to send ("
+                                  << result.bytes / 1024 << " KB)" << std::endl;
+                    }
+                };
+                if (mqtt_client_->publish_image(topic, *last_capture_, filepath, routing, label, on_sent)) {
+                    std::cout << "✅ Published " << label << " capture to MQTT: " << filepath << std::endl;
+                } else {
+                    std::cerr << "⚠️ " << label << " capture not published: " << filepath << std::endl;
+                }
+            }
+        });
+    };
+
+    bool coalesced = false;
+    uint64_t job_id = schedule_capture(target, label, grab_and_encode, done, &coalesced);
+    if (job_id == 0) {
+        return;
+    }
+    // Completions reach the main loop after this, so the entry is always there
+    PendingCapture& pending = pending_captures_[job_id];
+    if (!coalesced) {
+        pending.processed = processed;
+    }
+    ++pending.requests;
+}
+
+uint64_t SauronEyePanel::schedule_capture(const std::string& target, const std::string& label,
+                                          CaptureScheduler::CaptureJob job, CaptureScheduler::CompletionCallback done,
+                                          bool* coalesced_out) {
+    // The capture thread encodes with whatever the panel has set by now
+    capture_scheduler_.set_capture_settings(screen_capturer_->get_capture_settings());
+
+    int delay_seconds = delay_spin_.get_value_as_int();
+    bool coalesced = false;
+    uint64_t job_id = capture_scheduler_.schedule(std::chrono::steady_clock::now() + std::chrono::seconds(delay_seconds),
+                                                  target, job, done, &coalesced);
+    if (job_id == 0) {
+        std::cerr << "⚠️ Capture queue full, " << label << " capture of " << target << " dropped" << std::endl;
+    } else if (coalesced) {
+        // A burst of triggers for one target (key repeat, repeated commands) is one capture
+        std::cout << "🔗 " << label << " capture joined pending capture " << job_id << std::endl;
+    } else if (delay_seconds > 0) {
+        std::cout << "⏱️ Capture " << job_id << " will start in " << delay_seconds << " seconds ("
+                  << capture_scheduler_.pending() << " pending)" << std::endl;
+    }
+    update_queue_status();
+    if (coalesced_out) {
+        *coalesced_out = coalesced;
+    }
+    return job_id;
+}
+
+std::string SauronEyePanel::finish_raw_capture(const std::string& type, unsigned long id,
+                                               const std::string& target, const RawImage& raw,
+                                               const ChangeDetector::Change& change,
+                                               std::shared_ptr<EncodedImage> encoded,
+                                               const ImageScaler::Limits& limits) {
+    auto previous = previous_captures_.find(target);
+    if (change.is_unchanged() && previous != previous_captures_.end()) {
+        const std::string& previous_path = previous->second.filepath;
+        if (skip_unchanged_check_.get_active()) {
+            std::cout << "⏭️ Capture unchanged since " << std::filesystem::path(previous_path).filename().string()
+                      << ", skipped" << std::endl;
+            m_signal_capture_unchanged.emit(previous_path, type);
             return "";
         }
-    } else {
-        std::cerr << "❌ Unknown capture type: " << type << std::endl;
-        return "";
+
+        // The earlier capture stands in for this one, nothing is encoded or written again
+        std::cout << "♻️ Capture unchanged, reusing " << std::filesystem::path(previous_path).filename().string()
+                  << std::endl;
+        last_capture_ = previous->second.image;
+        m_signal_capture_taken.emit(previous->second.saved ? previous_path : "");
+        m_signal_capture_taken_extended.emit(previous_path, type, std::to_string(id));
+        return previous_path;
     }
 
-    // Emit signals
-    m_signal_capture_taken.emit(filepath);
+    if (!encoded) {
+        // Unchanged, but the capture it matched never reached the main loop
+        encoded = std::make_shared<EncodedImage>();
+        if (!screen_capturer_->encode_image(raw, *encoded, limits)) {
+            std::cerr << "❌ Failed to encode capture" << std::endl;
+            return "";
+        }
+    }
+
+    bool saved = save_to_disk_check_.get_active();
+    std::string filepath = finish_capture(type, id, encoded);
+    previous_captures_[target] = PreviousCapture{encoded, filepath, saved};
+    return filepath;
+}
+
+std::string SauronEyePanel::finish_capture(const std::string& type, unsigned long id,
+                                           const std::shared_ptr<EncodedImage>& encoded) {
+    std::string filename = generate_capture_filename(type);
+    std::string filepath = std::filesystem::absolute(filename).string();
+
+    last_capture_ = encoded;
+
+    // Writing the file is a side effect, publishing works from the buffer
+    bool saved = save_to_disk_check_.get_active();
+    if (saved) {
+        capture_writer_.write(filepath, encoded,
+            [this, type](const std::string& path, bool success) {
+                if (!success) {
+                    return;
+                }
+                // Completion runs on the writer thread, hand it to the main loop
+                Glib::signal_idle().connect_once([this, path, type]() {
+                    m_signal_capture_saved.emit(path, type);
+                });
+            });
+    }
+
+    // Emit signals; the file name still labels the capture when publishing
+    m_signal_capture_taken.emit(saved ? filepath : "");
     m_signal_capture_taken_extended.emit(filepath, type, std::to_string(id));
 
     // No internal MQTT publishing; SauronWindow will handle via signals
@@ -505,6 +875,405 @@ std::string SauronEyePanel::take_capture(const std::string& type, unsigned long
     return filepath;
 }
 
+void SauronEyePanel::take_region_capture(const NamedRegion& region, const std::string& trigger) {
+    // Saved regions are compared with their last capture, selections with
+    // earlier selections of the same rectangle
+    std::string target = "region:";
+    if (region.name.empty()) {
+        target += std::to_string(region.region.x) + "," + std::to_string(region.region.y) + "," +
+                  std::to_string(region.region.width) + "x" + std::to_string(region.region.height) +
+                  "@" + region.window_title;
+    } else {
+        target += region.name;
+    }
+    
+    X11ScreenCapturer::CaptureRect rect = region.region;
+    if (region.window_title.empty()) {
+        queue_capture("region", 0, target, trigger,
+            [rect](X11ScreenCapturer& capturer, RawImage& raw) {
+                return capturer.capture_region_raw(rect, raw);
+            });
+        return;
+    }
+    
+    // Window-relative regions follow their window around the desktop
+    for (const auto& window : screen_capturer_->list_windows()) {
+        if (window.title.find(region.window_title) == std::string::npos) {
+            continue;
+        }
+        queue_capture("region", window.id, target, trigger,
+            [window, rect](X11ScreenCapturer& capturer, RawImage& raw) {
+                X11ScreenCapturer::WindowInfo info = window;
+                capturer.get_window_info(window.id, info);
+                return capturer.capture_window_region_raw(info, rect, raw);
+            });
+        return;
+    }
+    
+    std::cerr << "❌ No window titled \"" << region.window_title << "\" for region "
+              << (region.name.empty() ? "selection" : region.name) << std::endl;
+}
+
+bool SauronEyePanel::capture_region(const std::string& name, const std::string& trigger) {
+    auto it = std::find_if(regions_.begin(), regions_.end(),
+                           [&name](const NamedRegion& region) { return region.name == name; });
+    if (it == regions_.end()) {
+        std::cerr << "❌ No saved region named \"" << name << "\"" << std::endl;
+        return false;
+    }
+    take_region_capture(*it, trigger);
+    return true;
+}
+
+bool SauronEyePanel::capture_region_hotkey(int hotkey) {
+    auto it = std::find_if(regions_.begin(), regions_.end(),
+                           [hotkey](const NamedRegion& region) { return region.hotkey == hotkey; });
+    if (it == regions_.end()) {
+        std::cout << "⚠️ No region saved for Ctrl+Numpad " << hotkey << std::endl;
+        return false;
+    }
+    take_region_capture(*it, "region-hotkey");
+    return true;
+}
+
+void SauronEyePanel::set_regions(const std::vector<NamedRegion>& regions) {
+    regions_ = regions;
+    refresh_region_list();
+}
+
+void SauronEyePanel::refresh_region_list() {
+    std::string active = regions_combo_.get_active_id();
+    regions_combo_.remove_all();
+    for (const auto& region : regions_) {
+        std::string label = region.name;
+        if (!region.window_title.empty()) {
+            label += " in \"" + region.window_title + "\"";
+        }
+        if (region.hotkey > 0) {
+            label += " (Ctrl+Numpad " + std::to_string(region.hotkey) + ")";
+        }
+        regions_combo_.append(region.name, label);
+    }
+    
+    if (!regions_.empty() && !regions_combo_.set_active_id(active)) {
+        regions_combo_.set_active(0);
+    }
+    capture_region_button_.set_sensitive(!regions_.empty());
+    remove_region_button_.set_sensitive(!regions_.empty());
+}
+
+void SauronEyePanel::on_select_region_clicked() {
+    // The overlay shows a still of the whole desktop to select on
+    RawImage desktop;
+    if (!screen_capturer_->capture_screen_raw(-1, desktop)) {
+        std::cerr << "❌ Failed to capture the desktop for region selection" << std::endl;
+        return;
+    }
+    
+    region_selector_ = std::make_unique<RegionSelector>(std::move(desktop));
+    region_selector_->signal_region_selected().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::on_region_selected));
+    region_selector_->signal_cancelled().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::close_region_selector));
+    region_selector_->show();
+}
+
+void SauronEyePanel::close_region_selector() {
+    // The overlay and its desktop still are dropped once its signal handler
+    // returns, unless another selection has replaced it by then
+    RegionSelector* selector = region_selector_.get();
+    Glib::signal_idle().connect_once([this, selector]() {
+        if (region_selector_.get() == selector) {
+            region_selector_.reset();
+        }
+    });
+}
+
+void SauronEyePanel::on_region_selected(X11ScreenCapturer::CaptureRect region) {
+    NamedRegion selected;
+    selected.name = region_name_entry_.get_text();
+    selected.region = region;
+    
+    // Entirely inside the selected window: keep it relative to the window
+    auto window = get_selected_window();
+    if (window && region.x >= window->x && region.y >= window->y &&
+        static_cast<long>(region.x) + region.width <= static_cast<long>(window->x) + window->width &&
+        static_cast<long>(region.y) + region.height <= static_cast<long>(window->y) + window->height) {
+        selected.window_title = window->title;
+        selected.region.x -= window->x;
+        selected.region.y -= window->y;
+    }
+    
+    if (!selected.name.empty()) {
+        auto it = std::find_if(regions_.begin(), regions_.end(),
+                               [&selected](const NamedRegion& saved) { return saved.name == selected.name; });
+        if (it != regions_.end()) {
+            selected.hotkey = it->hotkey;
+            *it = selected;
+        } else {
+            // First free hotkey
+            for (int hotkey = 1; hotkey <= 9 && selected.hotkey == 0; ++hotkey) {
+                if (std::none_of(regions_.begin(), regions_.end(),
+                                 [hotkey](const NamedRegion& saved) { return saved.hotkey == hotkey; })) {
+                    selected.hotkey = hotkey;
+                }
+            }
+            regions_.push_back(selected);
+        }
+        
+        std::cout << "✅ Saved region \"" << selected.name << "\" " << region.width << "x" << region.height
+                  << (selected.window_title.empty() ? "" : " in \"" + selected.window_title + "\"") << std::endl;
+        refresh_region_list();
+        regions_combo_.set_active_id(selected.name);
+        region_name_entry_.set_text("");
+        m_signal_regions_changed.emit();
+    }
+    
+    take_region_capture(selected, "region-select");
+    close_region_selector();
+}
+
+void SauronEyePanel::on_capture_region_clicked() {
+    std::string name = regions_combo_.get_active_id();
+    if (name.empty()) {
+        std::cerr << "❌ No region selected" << std::endl;
+        return;
+    }
+    capture_region(name, "region");
+}
+
+void SauronEyePanel::on_remove_region_clicked() {
+    std::string name = regions_combo_.get_active_id();
+    auto it = std::find_if(regions_.begin(), regions_.end(),
+                           [&name](const NamedRegion& region) { return region.name == name; });
+    if (it == regions_.end()) {
+        return;
+    }
+    
+    regions_.erase(it);
+    refresh_region_list();
+    m_signal_regions_changed.emit();
+}
+
+void SauronEyePanel::set_save_to_disk(bool save) {
+    save_to_disk_check_.set_active(save);
+}
+
+bool SauronEyePanel::get_save_to_disk() const {
+    return save_to_disk_check_.get_active();
+}
+
+void SauronEyePanel::set_skip_unchanged(bool skip) {
+    skip_unchanged_check_.set_active(skip);
+}
+
+bool SauronEyePanel::get_skip_unchanged() const {
+    return skip_unchanged_check_.get_active();
+}
+
+void SauronEyePanel::set_output_format(const std::string& format, int quality) {
+    screen_capturer_->set_quality(quality);
+    screen_capturer_->set_output_format(format);
+    quality_spin_.set_value(screen_capturer_->get_quality());
+    format_combo_.set_active_id(screen_capturer_->get_output_format());
+}
+
+std::string SauronEyePanel::get_output_format() const {
+    return screen_capturer_->get_output_format();
+}
+
+int SauronEyePanel::get_quality() const {
+    return screen_capturer_->get_quality();
+}
+
+void SauronEyePanel::on_format_changed() {
+    std::string format = format_combo_.get_active_id();
+    if (!format.empty() && screen_capturer_->set_output_format(format)) {
+        quality_spin_.set_sensitive(format != "png");
+        std::cout << "🖼️ Capture format: " << format << std::endl;
+    }
+}
+
+void SauronEyePanel::on_quality_changed() {
+    screen_capturer_->set_quality(quality_spin_.get_value_as_int());
+}
+
+void SauronEyePanel::set_continuous_fps(double fps) {
+    continuous_fps_spin_.set_value(fps);
+    continuous_capture_.set_fps(continuous_fps_spin_.get_value());
+}
+
+double SauronEyePanel::get_continuous_fps() const {
+    return continuous_capture_.get_fps();
+}
+
+void SauronEyePanel::on_continuous_toggled() {
+    if (!continuous_check_.get_active()) {
+        if (continuous_status_connection_.connected()) {
+            continuous_status_connection_.disconnect();
+        }
+        replay_buffer_.stop();
+        continuous_capture_.stop();
+        continuous_status_label_.set_text("");
+        return;
+    }
+    
+    // Follow the selected window, otherwise the selected screen (or the whole desktop)
+    double fps = continuous_fps_spin_.get_value();
+    bool started = false;
+    auto window = get_selected_window();
+    if (window) {
+        started = continuous_capture_.start(ContinuousCapture::Target::Window, window->id, fps,
+                                            static_cast<int>(window->width), static_cast<int>(window->height));
+    } else {
+        auto screen = get_selected_screen();
+        int screen_number = screen ? screen->number : -1;
+        int width = 0, height = 0;
+        if (screen) {
+            width = static_cast<int>(screen->width);
+            height = static_cast<int>(screen->height);
+        } else {
+            // The whole desktop spans every screen
+            for (const auto& each : screen_capturer_->detect_screens()) {
+                width = std::max(width, each.x + static_cast<int>(each.width));
+                height = std::max(height, each.y + static_cast<int>(each.height));
+            }
+        }
+        started = continuous_capture_.start(ContinuousCapture::Target::Screen,
+                                            static_cast<unsigned long>(screen_number), fps, width, height);
+    }
+    
+    if (!started) {
+        std::cerr << "❌ Failed to start continuous capture" << std::endl;
+        continuous_check_.set_active(false);
+        return;
+    }
+    
+    if (replay_enabled_) {
+        replay_buffer_.clear();
+        replay_buffer_.start(continuous_capture_.ring());
+    }
+    
+    continuous_status_connection_ = Glib::signal_timeout().connect(
+        sigc::mem_fun(*this, &SauronEyePanel::update_continuous_status), 1000);
+}
+
+void SauronEyePanel::on_continuous_fps_changed() {
+    continuous_capture_.set_fps(continuous_fps_spin_.get_value());
+}
+
+bool SauronEyePanel::update_continuous_status() {
+    // The capture thread ends by itself when its window goes away
+    if (!continuous_capture_.is_running()) {
+        continuous_check_.set_active(false);
+        return false;
+    }
+    
+    const FrameRing& ring = continuous_capture_.ring();
+    std::string status = std::to_string(ring.frames_written()) + " frames, " +
+                         std::to_string(ring.frames_dropped()) + " dropped";
+    if (replay_buffer_.is_running()) {
+        status += ", replay " + std::to_string(replay_buffer_.frame_count()) + " frames / " +
+                  std::to_string(replay_buffer_.size_bytes() / 1024) + " KB";
+    }
+    continuous_status_label_.set_text(status);
+    return true;
+}
+
+void SauronEyePanel::update_queue_status() {
+    CaptureScheduler::Stats stats = capture_scheduler_.stats();
+    std::string status = std::to_string(stats.pending) + " pending, " +
+                         std::to_string(stats.completed) + " done";
+    if (stats.coalesced > 0) {
+        status += ", " + std::to_string(stats.coalesced) + " coalesced";
+    }
+    if (stats.dropped > 0) {
+        status += ", " + std::to_string(stats.dropped) + " dropped";
+    }
+    if (stats.failed > 0) {
+        status += ", " + std::to_string(stats.failed) + " failed";
+    }
+    queue_status_label_.set_text(status);
+}
+
+void SauronEyePanel::set_capture_queue(size_t depth, CaptureScheduler::DropPolicy policy) {
+    capture_scheduler_.set_max_pending(depth);
+    capture_scheduler_.set_drop_policy(policy);
+}
+
+void SauronEyePanel::set_use_mirror(bool use_mirror) {
+    screen_capturer_->set_use_mirror(use_mirror);
+    CaptureSettings settings = screen_capturer_->get_capture_settings();
+    capture_scheduler_.set_capture_settings(settings);
+    continuous_capture_.set_capture_settings(settings);
+}
+
+void SauronEyePanel::set_replay_enabled(bool enabled) {
+    replay_enabled_ = enabled;
+    if (!enabled) {
+        replay_buffer_.stop();
+        replay_buffer_.clear();
+    } else if (continuous_capture_.is_running()) {
+        replay_buffer_.start(continuous_capture_.ring());
+    }
+}
+
+void SauronEyePanel::set_scale_limits(const std::string& trigger, const ImageScaler::Limits& limits) {
+    scale_limits_[trigger] = limits;
+    
+    // The replay buffer encodes on its own thread and keeps a copy
+    if (trigger == "replay" || trigger == "default") {
+        replay_buffer_.set_scale_limits(get_scale_limits("replay"), screen_capturer_->get_scale_filter());
+    }
+}
+
+ImageScaler::Limits SauronEyePanel::get_scale_limits(const std::string& trigger) const {
+    auto it = scale_limits_.find(trigger);
+    if (it == scale_limits_.end()) {
+        // "window-double-click" falls back to "window"
+        it = scale_limits_.find(trigger.substr(0, trigger.find('-')));
+    }
+    if (it == scale_limits_.end()) {
+        it = scale_limits_.find("default");
+    }
+    return it != scale_limits_.end() ? it->second : ImageScaler::Limits();
+}
+
+void SauronEyePanel::set_scale_filter(ImageScaler::Filter filter) {
+    screen_capturer_->set_scale_filter(filter);
+    replay_buffer_.set_scale_limits(get_scale_limits("replay"), filter);
+}
+
+std::vector<ReplayBuffer::Entry> SauronEyePanel::dump_replay() {
+    auto frames = replay_buffer_.snapshot();
+    
+    // Unchanged frames share one image, keep the first of each run
+    frames.erase(std::unique(frames.begin(), frames.end(),
+                             [](const ReplayBuffer::Entry& a, const ReplayBuffer::Entry& b) {
+                                 return a.image == b.image;
+                             }),
+                 frames.end());
+    
+    if (frames.empty()) {
+        std::cerr << "⚠️ Replay buffer is empty, enable continuous capture first" << std::endl;
+        return frames;
+    }
+    
+    if (save_to_disk_check_.get_active()) {
+        std::filesystem::path directory = std::filesystem::absolute("captures/replay_" + capture_timestamp());
+        
+        for (size_t i = 0; i < frames.size(); ++i) {
+            std::stringstream name;
+            name << "frame_" << std::setw(4) << std::setfill('0') << (i + 1)
+                 << ImageFormat::extension(frames[i].image->format);
+            capture_writer_.write((directory / name.str()).string(), frames[i].image);
+        }
+        std::cout << "⏪ Writing " << frames.size() << " replay frames to " << directory.string() << std::endl;
+    }
+    
+    return frames;
+}
+
 bool SauronEyePanel::save_capture(const std::shared_ptr<Gdk::Pixbuf>& capture, const std::string& filename) {
     if (!capture) {
         std::cerr << "❌ Cannot save null capture" << std::endl;
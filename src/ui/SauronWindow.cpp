@@ -1,4 +1,7 @@
 #include "../../include/SauronWindow.h"
+#include "../../include/ImageFormat.h"
+#include "../../include/MqttTopics.h"
+#include "../../include/X11ErrorTrap.h"
 #include <iostream>
 #include <filesystem>
 #include <chrono>
@@ -11,27 +14,49 @@
 #include <algorithm>      // Include for std::min
 
 SauronWindow::DebugStreambuf::DebugStreambuf(SauronWindow* window)
-    : window_(window) {}
+    : window_(window), main_thread_(std::this_thread::get_id()) {}
 
 SauronWindow::DebugStreambuf::int_type SauronWindow::DebugStreambuf::overflow(int_type c) {
     if (c == traits_type::eof()) return traits_type::not_eof(c);
     char ch = traits_type::to_char_type(c);
-    buffer_.push_back(ch);
-    if (ch == '\n') {
-        window_->add_debug_text(buffer_);
-        buffer_.clear();
+    
+    std::string line;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string& buffer = buffers_[std::this_thread::get_id()];
+        buffer.push_back(ch);
+        if (ch != '\n') {
+            return traits_type::not_eof(c);
+        }
+        line.swap(buffer);
+    }
+    
+    // GTK may only be used from the main thread
+    if (std::this_thread::get_id() == main_thread_) {
+        window_->add_debug_text(line);
+    } else {
+        SauronWindow* window = window_;
+        Glib::signal_idle().connect_once([window, line]() {
+            window->add_debug_text(line);
+        });
     }
     return traits_type::not_eof(c);
 }
 
 SauronWindow::SauronWindow()
-    : capturer_(std::make_shared<X11ScreenCapturer>()),
+    : x11_connection_(std::make_shared<X11Connection>()),
+      capturer_(std::make_shared<X11ScreenCapturer>(x11_connection_)),
       mqtt_client_(std::make_shared<MqttClient>()),
       sauron_eye_panel_(capturer_, mqtt_client_),
       chat_panel_(mqtt_client_),
+      keyboard_controller_(x11_connection_),
       mqtt_connect_button_("Connect"),
       debug_buffer_(Gtk::TextBuffer::create())
 {
+    // GTK has installed its X error handler by now; ours goes on top of it
+    // before any capture thread starts
+    X11ErrorTrap::install();
+
     set_title("Sauron's Eye");
 
     // Get screen dimensions
@@ -96,7 +121,7 @@ SauronWindow::SauronWindow()
     {
         auto lbl_topic = Gtk::manage(new Gtk::Label("Topic:"));
         mqtt_topic_entry_.set_text("sauron");
-        mqtt_topic_entry_.set_tooltip_text("Unified MQTT topic for all communication");
+        mqtt_topic_entry_.set_tooltip_text("Root of the MQTT topics, sauron/<from>/<to>/<type>");
         mqtt_topic_entry_.set_editable(false); // Make it non-editable
         mqtt_topic_entry_.set_sensitive(true);
         auto hb = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 5));
@@ -162,6 +187,8 @@ SauronWindow::SauronWindow()
 
     // Connect signals
     sauron_eye_panel_.signal_capture_taken().connect(sigc::mem_fun(*this, &SauronWindow::on_capture_taken));
+    sauron_eye_panel_.signal_capture_saved().connect(sigc::mem_fun(*this, &SauronWindow::on_capture_saved));
+    sauron_eye_panel_.signal_capture_unchanged().connect(sigc::mem_fun(*this, &SauronWindow::on_capture_unchanged));
     // Handle captures from panel by publishing automatically via MQTT Settings
     sauron_eye_panel_.signal_capture_taken_extended().connect(
         sigc::mem_fun(*this, &SauronWindow::on_panel_capture));
@@ -169,8 +196,14 @@ SauronWindow::SauronWindow()
     // Initialize keyboard shortcuts
     keyboard_controller_.signal_capture_key_pressed().connect(
         sigc::mem_fun(*this, &SauronWindow::on_keyboard_capture_triggered));
+    keyboard_controller_.signal_replay_key_pressed().connect(
+        sigc::mem_fun(*this, &SauronWindow::on_keyboard_replay_triggered));
+    keyboard_controller_.signal_region_key_pressed().connect(
+        sigc::mem_fun(*this, &SauronWindow::on_keyboard_region_triggered));
+    sauron_eye_panel_.signal_regions_changed().connect(
+        sigc::mem_fun(*this, &SauronWindow::save_regions));
     if (keyboard_controller_.start_monitoring()) {
-        std::cout << "🔑 Keyboard shortcuts enabled (Numpad Enter to capture)" << std::endl;
+        std::cout << "🔑 Keyboard shortcuts enabled (Numpad Enter to capture, Ctrl+Numpad Enter for replay, Ctrl+Numpad 1-9 for saved regions)" << std::endl;
     } else {
         std::cout << "⚠️ Keyboard shortcuts could not be enabled" << std::endl;
     }
@@ -182,6 +215,15 @@ SauronWindow::SauronWindow()
     // Load persisted settings if any
     load_settings();
 
+    // Only the messages handled here are delivered by the broker; the
+    // client subscribes once it connects
+    for (const char* type : {"capture_command", "hello"}) {
+        mqtt_handlers_.push_back(mqtt_client_->add_handler(
+            MqttTopics::subscription("ui", type),
+            [this](std::string_view topic, std::string_view payload) { on_mqtt_message(topic, payload); },
+            MqttClient::Delivery::MainLoop));
+    }
+
     // Automatically connect to MQTT on startup
     Glib::signal_idle().connect_once([this]() {
         std::cout << "🔌 Auto-connecting to MQTT..." << std::endl;
@@ -196,6 +238,9 @@ SauronWindow::SauronWindow()
 SauronWindow::~SauronWindow() {
     // Stop keyboard monitoring before cleaning up
     keyboard_controller_.stop_monitoring();
+    for (auto id : mqtt_handlers_) {
+        mqtt_client_->remove_handler(id);
+    }
     
     // Restore original streams
     std::cout.rdbuf(cout_buffer_);
@@ -223,11 +268,25 @@ bool SauronWindow::ensure_captures_directory() {
 
 // Handle captures coming from SauronEyePanel
 void SauronWindow::on_capture_taken(const std::string& filename) {
+    // Nothing on disk to point at when saving is off
+    if (filename.empty()) {
+        status_bar_.push("Captured (not saved to disk)");
+        return;
+    }
     last_capture_path_ = filename;
-    refresh_captures();
     status_bar_.push("Captured: " + filename);
 }
 
+// The file is written in the background, refresh thumbnails once it exists
+void SauronWindow::on_capture_saved(const std::string& filepath [[maybe_unused]], const std::string& type [[maybe_unused]]) {
+    refresh_captures();
+}
+
+void SauronWindow::on_capture_unchanged(const std::string& previous_filepath, const std::string& type) {
+    status_bar_.push("Unchanged " + type + " capture skipped (same as " +
+                     std::filesystem::path(previous_filepath).filename().string() + ")");
+}
+
 // Handle key press and delete events
 bool SauronWindow::on_key_press_event(GdkEventKey* key_event) { 
     return Gtk::Window::on_key_press_event(key_event);
@@ -263,19 +322,17 @@ void SauronWindow::on_mqtt_connect_clicked() {
     std::cout << "Attempting to connect to MQTT broker at " << host << ":" << port << std::endl;
 
     if (!mqtt_connected_) {
+        // Images go as JSON until the agent says it takes binary frames
+        mqtt_client_->set_image_transport(MqttClient::ImageTransport::Json);
+        mqtt_client_->set_connect_callback([this]() {
+            Glib::signal_idle().connect_once([this]() { send_hello_to_agent(); });
+        });
+        
         if (mqtt_client_->connect(host, "PipeWrenchClient_" + std::to_string(std::time(nullptr)), port)) {
             mqtt_connected_ = true;
             mqtt_connect_button_.set_label("Disconnect");
             mqtt_status_label_.set_markup("<span foreground='green'>Connected</span>");
             status_bar_.push("Connected to MQTT broker at " + host + ":" + std::to_string(port));
-            
-            // Subscribe to unified topic and set message handler
-            const std::string unified_topic = "sauron";
-            mqtt_client_->set_message_callback(
-                sigc::mem_fun(*this, &SauronWindow::on_mqtt_message));
-            if (mqtt_client_->subscribe(unified_topic)) {
-                status_bar_.push("Subscribed to topic: " + unified_topic);
-            }
         } else {
             status_bar_.push("Failed to connect to MQTT broker");
             mqtt_status_label_.set_markup("<span foreground='red'>Connection failed</span>");
@@ -289,26 +346,54 @@ void SauronWindow::on_mqtt_connect_clicked() {
     }
 }
 
-void SauronWindow::on_mqtt_message(const std::string& topic, const std::string& payload) {
-    // Handle messages in the UI thread
-    Glib::signal_idle().connect_once([this, topic, payload]() {
-        if (topic == "sauron") {
-            // Check if this is a command message
-            try {
-                auto j = nlohmann::json::parse(payload);
-                if (j.contains("type") && j["type"] == "capture_command" && 
-                    j.contains("to") && j["to"] == "ui") {
-                    handle_capture_command();
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing message: " << e.what() << std::endl;
-            }
+void SauronWindow::on_mqtt_message(std::string_view topic, std::string_view payload) {
+    // The topic says what the message is, only those handled here are parsed
+    std::string from, to, type;
+    if (!MqttTopics::parse(std::string(topic), from, to, type) || to != "ui") {
+        return;
+    }
+    
+    try {
+        auto j = nlohmann::json::parse(payload);
+        if (type == "capture_command") {
+            // Optionally a saved region instead of the selected window or screen
+            handle_capture_command(j.value("region", ""));
+        } else if (type == "hello" && from == "agent") {
+            handle_agent_hello(j);
         }
-    });
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing message: " << e.what() << std::endl;
+    }
+}
+
+void SauronWindow::send_hello_to_agent() {
+    nlohmann::json hello;
+    hello["to"] = "agent";
+    hello["from"] = "ui";
+    hello["type"] = "hello";
+    hello["image_transport"] = {"json", "binary"};
+    mqtt_client_->publish(MqttTopics::make("ui", "agent", "hello"), hello.dump());
+}
+
+void SauronWindow::handle_agent_hello(const nlohmann::json& hello) {
+    // Agents that predate binary frames never say hello and keep getting JSON
+    bool binary = false;
+    if (hello.contains("image_transport") && hello["image_transport"].is_array()) {
+        for (const auto& transport : hello["image_transport"]) {
+            binary = binary || transport == "binary";
+        }
+    }
+    mqtt_client_->set_image_transport(binary ? MqttClient::ImageTransport::Binary
+                                             : MqttClient::ImageTransport::Json);
+    std::cout << "🤝 Agent connected, sending images as " << (binary ? "binary frames" : "JSON") << std::endl;
 }
 
-void SauronWindow::handle_capture_command() {
+void SauronWindow::handle_capture_command(const std::string& region) {
     std::cout << "📸 Received capture command via MQTT" << std::endl;
+    if (!region.empty()) {
+        sauron_eye_panel_.capture_region(region, "region-mqtt");
+        return;
+    }
     sauron_eye_panel_.trigger_capture();
     
     // After capture is taken, the on_capture_taken handler will be called
@@ -322,13 +407,13 @@ void SauronWindow::refresh_captures() {
         captures_flow_.remove(*child);
     }
 
-    // Get all PNG files in captures directory and sort by modification time
+    // Get all image files in captures directory and sort by modification time
     const std::string captures_dir = "captures";
     std::vector<std::filesystem::directory_entry> entries;
     
     try {
         for (const auto& entry : std::filesystem::directory_iterator(captures_dir)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".png") {
+            if (entry.is_regular_file() && !ImageFormat::from_path(entry.path().string()).empty()) {
                 entries.push_back(entry);
             }
         }
@@ -370,7 +455,7 @@ void SauronWindow::add_thumbnail(const std::string& filepath) {
 }
 
 void SauronWindow::on_thumbnail_clicked(const std::string& filepath) {
-    const auto topic = mqtt_topic_entry_.get_text();
+    const auto topic = MqttTopics::make("ui", "agent", "image");
     std::cout << "Publishing thumbnail to topic: " << topic << std::endl;
     if (mqtt_connected_) {
         // Pass routing info correctly
@@ -421,10 +506,12 @@ void SauronWindow::on_thumbnail_activated_capture(const std::string& filepath) {
 // "Send Latest" button removed as redundant with thumbnail functionality
 
 void SauronWindow::on_panel_capture(const std::string& filepath, const std::string& type, const std::string& id [[maybe_unused]]) {
-    if (mqtt_connected_ && !filepath.empty()) {
-        const auto topic = mqtt_topic_entry_.get_text();
-        // Always encode as Base64
-        if (mqtt_client_->publish_image(topic, filepath, "", type, true)) {
+    auto capture = sauron_eye_panel_.last_capture();
+    if (mqtt_connected_ && !filepath.empty() && capture) {
+        // Not addressed to anyone, any client interested in captures can subscribe
+        const auto topic = MqttTopics::make("ui", MqttTopics::BROADCAST, "image");
+        // Publish straight from memory, the file may not be written yet
+        if (mqtt_client_->publish_image(topic, *capture, filepath, "", type)) {
             status_bar_.push("Sent capture to MQTT: " + filepath);
         } else {
             status_bar_.push("Failed to send capture to MQTT: " + filepath);
@@ -461,9 +548,145 @@ void SauronWindow::load_settings() {
                     mqtt_port_entry_.set_text(std::to_string(keyfile.get_integer("MQTT", "port")));
                     std::cout << "Loaded MQTT port from settings: " << mqtt_port_entry_.get_text() << std::endl;
                 }
+                
+                // Images larger than this go out in chunks, 0 for never
+                if (keyfile.has_key("MQTT", "chunk_kb")) {
+                    mqtt_client_->set_chunk_size(
+                        static_cast<size_t>(std::max(0, keyfile.get_integer("MQTT", "chunk_kb"))) * 1024);
+                }
+                // 1 or 2 to have image deliveries acknowledged by the broker
+                if (keyfile.has_key("MQTT", "image_qos")) {
+                    mqtt_client_->set_image_qos(keyfile.get_integer("MQTT", "image_qos"));
+                }
+                // Captures are dropped while this much is still being sent, 0 for no limit
+                if (keyfile.has_key("MQTT", "max_in_flight_mb")) {
+                    mqtt_client_->set_max_in_flight_bytes(
+                        static_cast<size_t>(std::max(0, keyfile.get_integer("MQTT", "max_in_flight_mb"))) * 1024 * 1024);
+                }
             } else {
                 std::cout << "Settings file exists but has no MQTT group, using defaults" << std::endl;
             }
+            
+            // Capture encoding settings
+            if (keyfile.has_group("Capture")) {
+                if (keyfile.has_key("Capture", "png_preset")) {
+                    PngEncoder::Preset preset;
+                    std::string name = keyfile.get_string("Capture", "png_preset");
+                    if (PngEncoder::preset_from_string(name, preset)) {
+                        capturer_->set_png_preset(preset);
+                        std::cout << "Loaded PNG preset from settings: " << name << std::endl;
+                    } else {
+                        std::cerr << "Unknown PNG preset '" << name << "', using default" << std::endl;
+                    }
+                }
+                
+                if (keyfile.has_key("Capture", "png_level")) {
+                    capturer_->set_png_compression_level(keyfile.get_integer("Capture", "png_level"));
+                }
+                
+                std::string format = sauron_eye_panel_.get_output_format();
+                int quality = sauron_eye_panel_.get_quality();
+                if (keyfile.has_key("Capture", "format")) {
+                    format = keyfile.get_string("Capture", "format");
+                }
+                if (keyfile.has_key("Capture", "quality")) {
+                    quality = keyfile.get_integer("Capture", "quality");
+                }
+                sauron_eye_panel_.set_output_format(format, quality);
+                
+                if (keyfile.has_key("Capture", "skip_unchanged")) {
+                    sauron_eye_panel_.set_skip_unchanged(keyfile.get_boolean("Capture", "skip_unchanged"));
+                }
+                
+                // Capture queue depth and what to drop when full ("oldest" or "newest")
+                if (keyfile.has_key("Capture", "queue_depth") || keyfile.has_key("Capture", "queue_drop")) {
+                    size_t depth = sauron_eye_panel_.get_capture_queue_depth();
+                    auto policy = sauron_eye_panel_.get_capture_queue_policy();
+                    if (keyfile.has_key("Capture", "queue_depth")) {
+                        depth = std::max(1, keyfile.get_integer("Capture", "queue_depth"));
+                    }
+                    if (keyfile.has_key("Capture", "queue_drop")) {
+                        policy = keyfile.get_string("Capture", "queue_drop") == "newest"
+                            ? CaptureScheduler::DropPolicy::RejectNew
+                            : CaptureScheduler::DropPolicy::DropOldest;
+                    }
+                    sauron_eye_panel_.set_capture_queue(depth, policy);
+                }
+                
+                // Opt-in damage-tracked mirror for instant screen captures
+                if (keyfile.has_key("Capture", "mirror") && keyfile.get_boolean("Capture", "mirror")) {
+                    sauron_eye_panel_.set_use_mirror(true);
+                }
+                
+                if (keyfile.has_key("Capture", "continuous_fps")) {
+                    sauron_eye_panel_.set_continuous_fps(keyfile.get_double("Capture", "continuous_fps"));
+                }
+            }
+            
+            // Replay buffer limits
+            if (keyfile.has_group("Replay")) {
+                ReplayBuffer& replay = sauron_eye_panel_.replay_buffer();
+                if (keyfile.has_key("Replay", "enabled")) {
+                    sauron_eye_panel_.set_replay_enabled(keyfile.get_boolean("Replay", "enabled"));
+                }
+                if (keyfile.has_key("Replay", "seconds")) {
+                    replay.set_duration(keyfile.get_double("Replay", "seconds"));
+                }
+                if (keyfile.has_key("Replay", "budget_mb")) {
+                    replay.set_byte_budget(static_cast<size_t>(keyfile.get_integer("Replay", "budget_mb")) * 1024 * 1024);
+                }
+                if (keyfile.has_key("Replay", "quality")) {
+                    replay.set_quality(keyfile.get_integer("Replay", "quality"));
+                }
+                if (keyfile.has_key("Replay", "request_frames")) {
+                    replay_request_frames_ = static_cast<size_t>(std::max(1, keyfile.get_integer("Replay", "request_frames")));
+                }
+            }
+            
+            // Downscaling before encoding: max_long_edge / max_megapixels apply to
+            // every trigger, <trigger>_max_long_edge / <trigger>_max_megapixels
+            // override them for one trigger (window, screen, monitors, replay, ...)
+            if (keyfile.has_group("Scale")) {
+                if (keyfile.has_key("Scale", "filter")) {
+                    ImageScaler::Filter filter;
+                    std::string name = keyfile.get_string("Scale", "filter");
+                    if (ImageScaler::parse_filter(name, filter)) {
+                        sauron_eye_panel_.set_scale_filter(filter);
+                    } else {
+                        std::cerr << "Unknown scale filter '" << name << "', using "
+                                  << ImageScaler::filter_name(capturer_->get_scale_filter()) << std::endl;
+                    }
+                }
+                
+                std::map<std::string, ImageScaler::Limits> limits;
+                // "max_long_edge" -> "default", "window_max_long_edge" -> "window"
+                auto trigger_of = [](const std::string& key, const std::string& setting, std::string& trigger) {
+                    if (key == setting) {
+                        trigger = "default";
+                        return true;
+                    }
+                    std::string suffix = "_" + setting;
+                    if (key.size() <= suffix.size() ||
+                        key.compare(key.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                        return false;
+                    }
+                    trigger = key.substr(0, key.size() - suffix.size());
+                    return true;
+                };
+                for (const auto& key : keyfile.get_keys("Scale")) {
+                    std::string trigger;
+                    if (trigger_of(key, "max_long_edge", trigger)) {
+                        limits[trigger].max_long_edge = std::max(0, keyfile.get_integer("Scale", key));
+                    } else if (trigger_of(key, "max_megapixels", trigger)) {
+                        limits[trigger].max_megapixels = std::max(0.0, keyfile.get_double("Scale", key));
+                    }
+                }
+                for (const auto& [trigger, trigger_limits] : limits) {
+                    sauron_eye_panel_.set_scale_limits(trigger, trigger_limits);
+                }
+            }
+            
+            load_regions(keyfile);
         } catch (const Glib::Error& e) {
             std::cerr << "Failed to load settings, using defaults: " << e.what() << std::endl;
         }
@@ -495,6 +718,21 @@ void SauronWindow::save_settings() {
     keyfile.set_string("MQTT", "host", mqtt_host_entry_.get_text());
     keyfile.set_integer("MQTT", "port", std::stoi(mqtt_port_entry_.get_text()));
     keyfile.set_string("MQTT", "topic", "sauron"); // Always save the unified topic
+    keyfile.set_integer("MQTT", "chunk_kb", static_cast<int>(mqtt_client_->get_chunk_size() / 1024));
+    keyfile.set_integer("MQTT", "image_qos", mqtt_client_->get_image_qos());
+    keyfile.set_integer("MQTT", "max_in_flight_mb",
+                        static_cast<int>(mqtt_client_->get_max_in_flight_bytes() / (1024 * 1024)));
+    
+    // Update capture format settings
+    keyfile.set_string("Capture", "format", sauron_eye_panel_.get_output_format());
+    keyfile.set_integer("Capture", "quality", sauron_eye_panel_.get_quality());
+    keyfile.set_double("Capture", "continuous_fps", sauron_eye_panel_.get_continuous_fps());
+    keyfile.set_boolean("Capture", "skip_unchanged", sauron_eye_panel_.get_skip_unchanged());
+    keyfile.set_integer("Capture", "queue_depth", static_cast<int>(sauron_eye_panel_.get_capture_queue_depth()));
+    keyfile.set_string("Capture", "queue_drop",
+                       sauron_eye_panel_.get_capture_queue_policy() == CaptureScheduler::DropPolicy::RejectNew
+                           ? "newest" : "oldest");
+    store_regions(keyfile);
     
     try {
         keyfile.save_to_file(fname);
@@ -510,6 +748,76 @@ void SauronWindow::save_settings() {
     }
 }
 
+void SauronWindow::load_regions(const Glib::KeyFile& keyfile) {
+    const std::string prefix = "Region ";
+    std::vector<SauronEyePanel::NamedRegion> regions;
+    for (const auto& group : keyfile.get_groups()) {
+        std::string name = group;
+        if (name.compare(0, prefix.size(), prefix) != 0 || name.size() == prefix.size()) {
+            continue;
+        }
+        
+        try {
+            SauronEyePanel::NamedRegion region;
+            region.name = name.substr(prefix.size());
+            region.region.x = keyfile.get_integer(group, "x");
+            region.region.y = keyfile.get_integer(group, "y");
+            region.region.width = static_cast<unsigned int>(std::max(1, keyfile.get_integer(group, "width")));
+            region.region.height = static_cast<unsigned int>(std::max(1, keyfile.get_integer(group, "height")));
+            if (keyfile.has_key(group, "window")) {
+                region.window_title = keyfile.get_string(group, "window");
+            }
+            if (keyfile.has_key(group, "hotkey")) {
+                region.hotkey = keyfile.get_integer(group, "hotkey");
+            }
+            regions.push_back(region);
+        } catch (const Glib::Error& e) {
+            std::cerr << "Skipping region '" << name << "': " << e.what() << std::endl;
+        }
+    }
+    sauron_eye_panel_.set_regions(regions);
+}
+
+void SauronWindow::store_regions(Glib::KeyFile& keyfile) {
+    // Regions removed in the panel disappear from the file too
+    const std::string prefix = "Region ";
+    for (const auto& group : keyfile.get_groups()) {
+        std::string name = group;
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            keyfile.remove_group(group);
+        }
+    }
+    
+    for (const auto& region : sauron_eye_panel_.get_regions()) {
+        const std::string group = prefix + region.name;
+        keyfile.set_integer(group, "x", region.region.x);
+        keyfile.set_integer(group, "y", region.region.y);
+        keyfile.set_integer(group, "width", static_cast<int>(region.region.width));
+        keyfile.set_integer(group, "height", static_cast<int>(region.region.height));
+        if (!region.window_title.empty()) {
+            keyfile.set_string(group, "window", region.window_title);
+        }
+        if (region.hotkey > 0) {
+            keyfile.set_integer(group, "hotkey", region.hotkey);
+        }
+    }
+}
+
+void SauronWindow::save_regions() {
+    // Only the region groups change, other settings keep their saved values
+    Glib::KeyFile keyfile;
+    const std::string fname = "settings.ini";
+    try {
+        if (Glib::file_test(fname, Glib::FILE_TEST_EXISTS)) {
+            keyfile.load_from_file(fname);
+        }
+        store_regions(keyfile);
+        keyfile.save_to_file(fname);
+    } catch (const Glib::Error& e) {
+        std::cerr << "Failed to save regions: " << e.what() << std::endl;
+    }
+}
+
 void SauronWindow::on_save_settings_clicked() {
     save_settings();
 }
@@ -521,4 +829,38 @@ void SauronWindow::on_keyboard_capture_triggered() {
     // Use the same trigger mechanism as MQTT commands
     std::cout << "📸 Keyboard shortcut triggered capture" << std::endl;
     sauron_eye_panel_.trigger_capture("keyboard");
+}
+
+void SauronWindow::on_keyboard_region_triggered(int hotkey) {
+    status_bar_.push("⌨️ Region capture triggered by keyboard shortcut (Ctrl+Numpad " +
+                     std::to_string(hotkey) + ")");
+    sauron_eye_panel_.capture_region_hotkey(hotkey);
+}
+
+void SauronWindow::on_keyboard_replay_triggered() {
+    status_bar_.push("⌨️ Replay triggered by keyboard shortcut (Ctrl+Numpad Enter)");
+    
+    auto frames = sauron_eye_panel_.dump_replay();
+    if (frames.empty() || !mqtt_connected_) {
+        return;
+    }
+    
+    // Evenly sample the replay down to a request size the agent can handle
+    size_t count = std::min(frames.size(), replay_request_frames_);
+    std::vector<std::shared_ptr<const EncodedImage>> images;
+    std::vector<long> offsets_ms;
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = (count == 1) ? frames.size() - 1 : i * (frames.size() - 1) / (count - 1);
+        images.push_back(frames[index].image);
+        offsets_ms.push_back(static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            frames[index].timestamp - frames.front().timestamp).count()));
+    }
+    
+    const auto topic = MqttTopics::make("ui", "agent", "image_sequence");
+    if (mqtt_client_->publish_images(topic, images, offsets_ms,
+                                     "to:agent,from:ui,type:image_sequence", "replay")) {
+        status_bar_.push("Sent replay (" + std::to_string(images.size()) + " frames) to MQTT");
+    } else {
+        status_bar_.push("Failed to send replay to MQTT");
+    }
 }
\ No newline at end of file
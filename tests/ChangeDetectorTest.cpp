@@ -0,0 +1,120 @@
+#include "../include/ChangeDetector.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Checks that the AVX2 and scalar tile hashes are identical for full and
+// partial tiles, and that a changed pixel is reported in the right tile.
+
+namespace {
+
+struct Size {
+    int width;
+    int height;
+};
+
+const Size kSizes[] = {
+    { 64, 64 },
+    { 1920, 1080 },
+    { 1001, 603 },
+    { 67, 33 },
+    { 1, 1 },
+    { 7, 130 },
+    { 129, 5 },
+};
+
+void fill_random(RawImage& image, int width, int height, std::mt19937& random) {
+    image.resize(width, height);
+    for (int y = 0; y < height; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(image.row(y));
+        for (int x = 0; x < width; ++x) {
+            row[x] = 0xFF000000u | (random() & 0xFFFFFF);
+        }
+    }
+}
+
+// Hash one image with both kernels
+// @return Number of differing tile hashes
+int check_kernels(const RawImage& image) {
+    ChangeDetector::TileHashes scalar, simd;
+    ChangeDetector::set_simd_enabled(false);
+    ChangeDetector::hash_tiles(image, scalar);
+    ChangeDetector::set_simd_enabled(true);
+    ChangeDetector::hash_tiles(image, simd);
+
+    if (scalar.hashes.size() != simd.hashes.size()) {
+        std::cerr << "❌ " << image.width << "x" << image.height << ": tile counts differ" << std::endl;
+        return 1;
+    }
+    int mismatches = 0;
+    for (size_t i = 0; i < scalar.hashes.size(); ++i) {
+        if (scalar.hashes[i] != simd.hashes[i] && mismatches++ < 4) {
+            std::cerr << "❌ " << image.width << "x" << image.height << " tile " << i << ": scalar "
+                      << std::hex << scalar.hashes[i] << ", " << ChangeDetector::kernel_name() << " "
+                      << simd.hashes[i] << std::dec << std::endl;
+        }
+    }
+    return mismatches;
+}
+
+// Flip one pixel and expect exactly its tile to change
+int check_change(RawImage image, std::mt19937& random) {
+    ChangeDetector detector;
+    ChangeDetector::Change first = detector.update("target", image);
+    ChangeDetector::Change same = detector.update("target", image);
+    if (first.has_previous || !same.is_unchanged()) {
+        std::cerr << "❌ " << image.width << "x" << image.height << ": identical capture reported as changed"
+                  << std::endl;
+        return 1;
+    }
+
+    int x = static_cast<int>(random() % image.width);
+    int y = static_cast<int>(random() % image.height);
+    image.row(y)[x * 4] ^= 0x01;
+    ChangeDetector::Change change = detector.update("target", image);
+
+    int tile_x = x / ChangeDetector::TILE_SIZE * ChangeDetector::TILE_SIZE;
+    int tile_y = y / ChangeDetector::TILE_SIZE * ChangeDetector::TILE_SIZE;
+    if (change.changed_tiles != 1 || change.x != tile_x || change.y != tile_y ||
+        x >= change.x + change.width || y >= change.y + change.height) {
+        std::cerr << "❌ " << image.width << "x" << image.height << ": pixel " << x << "," << y << " gave "
+                  << change.changed_tiles << " tile(s) at " << change.x << "," << change.y << " "
+                  << change.width << "x" << change.height << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(12345);
+    int failures = 0;
+
+    ChangeDetector::set_simd_enabled(true);
+    bool has_simd = std::strcmp(ChangeDetector::kernel_name(), "scalar") != 0;
+    if (!has_simd) {
+        std::cout << "⚠️ AVX2 not supported by this CPU, only the scalar hash is checked" << std::endl;
+    }
+
+    for (const Size& size : kSizes) {
+        RawImage image;
+        fill_random(image, size.width, size.height, random);
+        if (has_simd) {
+            failures += check_kernels(image) ? 1 : 0;
+        }
+        for (bool simd : { false, true }) {
+            ChangeDetector::set_simd_enabled(simd);
+            failures += check_change(image, random);
+        }
+        ChangeDetector::set_simd_enabled(true);
+    }
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " change detection check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Scalar and SIMD tile hashes match" << std::endl;
+    return 0;
+}
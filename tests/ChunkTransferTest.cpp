@@ -0,0 +1,275 @@
+#include "../include/ChunkTransfer.h"
+#include "../include/ChunkAssembler.h"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Round trips messages through ChunkTransfer and ChunkAssembler, and feeds
+// them forged headers, repeated and shuffled chunks, a memory budget too
+// small for the message and transfers that never finish.
+
+namespace {
+
+// Header field offsets, see ChunkTransfer.h
+const size_t kCountOffset = 17;
+const size_t kOffsetOffset = 21;
+const size_t kSizeOffset = 29;
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "❌ " << what << std::endl;
+        failures++;
+    }
+}
+
+std::string make_message(size_t size) {
+    std::string message(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        message[i] = static_cast<char>((i * 31 + 7) & 0xFF);
+    }
+    return message;
+}
+
+void put_number(std::string& payload, size_t at, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        payload[at + i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+std::vector<std::string> split(const std::string& message, uint64_t transfer_id, size_t chunk_size) {
+    std::vector<std::string> chunks;
+    uint32_t count = ChunkTransfer::chunk_count(message.size(), chunk_size);
+    for (uint32_t i = 0; i < count; i++) {
+        chunks.push_back(ChunkTransfer::encode(message, transfer_id, i, chunk_size));
+    }
+    return chunks;
+}
+
+// Every chunk decodes to its own piece of the message
+void check_round_trip() {
+    for (size_t size : { 0, 1, 99, 100, 101, 1000 }) {
+        for (size_t chunk_size : { 1, 7, 100, 5000 }) {
+            std::string message = make_message(size);
+            std::string name = std::to_string(size) + " bytes in " + std::to_string(chunk_size) + " byte chunks";
+            std::string rebuilt;
+            for (const std::string& payload : split(message, 42, chunk_size)) {
+                ChunkTransfer::Chunk chunk;
+                if (!ChunkTransfer::is_chunk(payload) || !ChunkTransfer::decode(payload, chunk)) {
+                    expect(false, name + ": chunk does not decode");
+                    break;
+                }
+                expect(chunk.transfer_id == 42 && chunk.total_size == size, name + ": wrong header");
+                rebuilt.append(reinterpret_cast<const char*>(chunk.data), chunk.size);
+            }
+            expect(rebuilt == message, name + ": chunks do not rebuild the message");
+        }
+    }
+}
+
+// Headers that disagree with the message they claim to be part of
+void check_forged_headers() {
+    std::string message = make_message(1000);
+    ChunkTransfer::Chunk chunk;
+
+    std::string payload = ChunkTransfer::encode(message, 1, 0, 100);
+    put_number(payload, kCountOffset, 0xFFFFFFF0u, 4);
+    expect(!ChunkTransfer::decode(payload, chunk), "huge chunk count accepted");
+    put_number(payload, kCountOffset, 11, 4);
+    expect(!ChunkTransfer::decode(payload, chunk), "chunk count one too many accepted");
+
+    payload = ChunkTransfer::encode(message, 1, 3, 100);
+    put_number(payload, kOffsetOffset, 301, 8);
+    expect(!ChunkTransfer::decode(payload, chunk), "shifted offset accepted");
+    put_number(payload, kOffsetOffset, UINT64_MAX - 10, 8);
+    expect(!ChunkTransfer::decode(payload, chunk), "offset past the message accepted");
+
+    payload = ChunkTransfer::encode(message, 1, 3, 100);
+    put_number(payload, kSizeOffset, 100000, 8);
+    expect(!ChunkTransfer::decode(payload, chunk), "larger message size accepted");
+
+    payload = ChunkTransfer::encode(message, 1, 3, 100);
+    payload.pop_back();
+    expect(!ChunkTransfer::decode(payload, chunk), "short chunk accepted");
+
+    payload = ChunkTransfer::encode(message, 1, 9, 100);
+    payload += "x";
+    expect(!ChunkTransfer::decode(payload, chunk), "long last chunk accepted");
+
+    expect(!ChunkTransfer::decode(payload.substr(0, ChunkTransfer::HEADER_SIZE - 1), chunk),
+           "truncated header accepted");
+}
+
+// Chunks in reverse and shuffled order, with duplicates, complete once
+void check_assembly_order(const std::filesystem::path& spool) {
+    std::string message = make_message(1000);
+    std::vector<std::string> chunks = split(message, 7, 100);
+
+    ChunkAssembler assembler(spool.string(), 1 << 20, std::chrono::seconds(30));
+    std::string out;
+    std::vector<size_t> order = { 9, 3, 3, 0, 8, 1, 7, 2, 6, 0, 5, 4 };
+    size_t completed = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i == 6) {
+            // A chunk of another message under the same transfer id is refused
+            std::string other = ChunkTransfer::encode(make_message(2000), 7, 1, 100);
+            expect(assembler.add(other, out) == ChunkAssembler::Result::Rejected,
+                   "chunk of another message accepted");
+        }
+        ChunkAssembler::Result result = assembler.add(chunks[order[i]], out);
+        if (result == ChunkAssembler::Result::Complete) {
+            completed++;
+            expect(i == order.size() - 1, "message completed before its last chunk");
+        } else {
+            expect(result == ChunkAssembler::Result::Incomplete, "duplicate or shuffled chunk rejected");
+        }
+    }
+    expect(completed == 1 && out == message, "shuffled chunks do not rebuild the message");
+    expect(assembler.transfers_in_progress() == 0, "completed transfer still held");
+}
+
+// A transfer over the memory budget goes to the spool file, and completes
+// once reading it back fits the budget; memory transfers keep using the
+// budget, and messages larger than all of it are refused
+void check_spill(const std::filesystem::path& spool) {
+    std::string small = make_message(500);
+    std::string large = make_message(800);
+    std::string huge = make_message(5000);
+
+    ChunkAssembler assembler(spool.string(), 1000, std::chrono::seconds(30));
+    std::string out;
+    std::vector<std::string> small_chunks = split(small, 1, 100);
+    std::vector<std::string> large_chunks = split(large, 2, 100);
+
+    expect(assembler.add(split(huge, 3, 1000)[0], out) == ChunkAssembler::Result::Rejected,
+           "message over the whole memory budget accepted");
+
+    assembler.add(small_chunks[0], out);
+    expect(assembler.memory_in_use() == 500, "small transfer not buffered in memory");
+    assembler.add(large_chunks[0], out);
+    expect(assembler.memory_in_use() == 500, "large transfer counted against the memory budget");
+    expect(std::filesystem::exists(spool / "0000000000000002.part"), "large transfer not spooled to disk");
+
+    ChunkAssembler::Result result = ChunkAssembler::Result::Incomplete;
+    for (size_t i = 1; i < small_chunks.size(); i++) {
+        result = assembler.add(small_chunks[i], out);
+    }
+    expect(result == ChunkAssembler::Result::Complete && out == small, "buffered transfer does not rebuild");
+    expect(assembler.memory_in_use() == 0, "memory budget not released");
+
+    for (size_t i = 1; i < large_chunks.size(); i++) {
+        result = assembler.add(large_chunks[i], out);
+    }
+    expect(result == ChunkAssembler::Result::Complete && out == large, "spooled transfer does not rebuild");
+    expect(!std::filesystem::exists(spool / "0000000000000002.part"), "spool file left behind");
+
+    // Read back while a buffered transfer holds most of the budget
+    small_chunks = split(small, 4, 100);
+    large_chunks = split(large, 5, 100);
+    assembler.add(small_chunks[0], out);
+    for (const std::string& chunk : large_chunks) {
+        result = assembler.add(chunk, out);
+    }
+    expect(result == ChunkAssembler::Result::Rejected, "spooled transfer read back over the memory budget");
+    expect(!std::filesystem::exists(spool / "0000000000000005.part"), "refused spool file left behind");
+    expect(assembler.memory_in_use() == 500, "refused read-back changed the memory budget");
+}
+
+// Spooled transfers are capped in number and bytes; first chunks past
+// either cap are refused, and a finished transfer frees its place
+void check_spool_limits(const std::filesystem::path& spool) {
+    std::string buffered = make_message(900);
+    std::string large = make_message(800);
+
+    ChunkAssembler assembler(spool.string(), 1000, std::chrono::seconds(30));
+    assembler.set_spool_limits(2, 2000);
+    std::string out;
+    std::vector<std::string> buffered_chunks = split(buffered, 1, 100);
+    assembler.add(buffered_chunks[0], out);
+
+    std::vector<std::string> first = split(large, 10, 100);
+    expect(assembler.add(first[0], out) == ChunkAssembler::Result::Incomplete, "first spooled transfer refused");
+    expect(assembler.add(split(large, 11, 100)[0], out) == ChunkAssembler::Result::Incomplete,
+           "second spooled transfer refused");
+    expect(assembler.spooled_transfers() == 2, "spooled transfers not counted");
+    expect(assembler.add(split(large, 12, 100)[0], out) == ChunkAssembler::Result::Rejected,
+           "spooled transfer past the count limit accepted");
+    expect(!std::filesystem::exists(spool / "000000000000000c.part"), "refused transfer opened a spool file");
+    expect(assembler.add(split(large, 12, 100)[1], out) == ChunkAssembler::Result::Rejected,
+           "late chunk of a refused transfer accepted");
+
+    // The buffered transfer leaves room to read the first spooled one back
+    ChunkAssembler::Result result = ChunkAssembler::Result::Incomplete;
+    for (size_t i = 1; i < buffered_chunks.size(); i++) {
+        assembler.add(buffered_chunks[i], out);
+    }
+    for (size_t i = 1; i < first.size(); i++) {
+        result = assembler.add(first[i], out);
+    }
+    expect(result == ChunkAssembler::Result::Complete && out == large, "spooled transfer does not rebuild");
+    expect(assembler.spooled_transfers() == 1, "finished transfer still counted as spooled");
+    expect(assembler.add(split(large, 13, 100)[0], out) == ChunkAssembler::Result::Incomplete,
+           "spool place not freed by a finished transfer");
+
+    ChunkAssembler by_size(spool.string(), 1000, std::chrono::seconds(30));
+    by_size.set_spool_limits(8, 1000);
+    by_size.add(split(buffered, 30, 100)[0], out);
+    expect(by_size.add(split(large, 31, 100)[0], out) == ChunkAssembler::Result::Incomplete,
+           "spooled transfer within the byte limit refused");
+    expect(by_size.add(split(large, 32, 100)[0], out) == ChunkAssembler::Result::Rejected,
+           "spooled transfer past the byte limit accepted");
+}
+
+// Transfers with no chunk for the timeout are dropped, and their late
+// chunks refused
+void check_expiry(const std::filesystem::path& spool) {
+    std::string message = make_message(1000);
+    std::vector<std::string> chunks = split(message, 3, 100);
+
+    ChunkAssembler assembler(spool.string(), 1 << 20, std::chrono::seconds(0));
+    std::string out;
+    assembler.add(chunks[0], out);
+    assembler.add(chunks[1], out);
+
+    std::vector<std::string> expired = assembler.expire();
+    expect(expired.size() == 1, "stale transfer not expired");
+    expect(!expired.empty() && expired[0].find("missing 8 of 10") != std::string::npos,
+           "expiry does not report the missing chunks");
+    expect(assembler.transfers_in_progress() == 0 && assembler.memory_in_use() == 0,
+           "expired transfer still held");
+    expect(assembler.add(chunks[2], out) == ChunkAssembler::Result::Rejected, "chunk of an expired transfer accepted");
+
+    ChunkAssembler patient(spool.string(), 1 << 20, std::chrono::seconds(30));
+    patient.add(chunks[0], out);
+    expect(patient.expire().empty() && patient.transfers_in_progress() == 1, "live transfer expired");
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::path spool = std::filesystem::temp_directory_path() /
+                                  ("chunk_transfer_test_" + std::to_string(std::chrono::steady_clock::now()
+                                                                               .time_since_epoch().count()));
+
+    check_round_trip();
+    check_forged_headers();
+    check_assembly_order(spool);
+    check_spill(spool);
+    check_spool_limits(spool);
+    check_expiry(spool);
+
+    std::error_code error;
+    std::filesystem::remove_all(spool, error);
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " chunk transfer check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Chunk transfers round trip, and bad chunks are refused" << std::endl;
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "../include/ImageFrame.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Builds image frames with ImageFrame::encode and checks decode gives the
+// images back, and refuses frames that are cut short, carry images that
+// do not match their hash or have header entries of the wrong type.
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "❌ " << what << std::endl;
+        failures++;
+    }
+}
+
+EncodedImage make_image(size_t size, unsigned char seed) {
+    EncodedImage image;
+    image.data.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        image.data[i] = static_cast<unsigned char>(seed + i * 13);
+    }
+    image.width = 4;
+    image.height = 2;
+    return image;
+}
+
+// A frame around a hand-written header, as a sender might forge it
+std::string make_frame(const std::string& meta, const std::string& body) {
+    std::string frame = "PWIM";
+    frame.push_back(static_cast<char>(ImageFrame::VERSION));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        frame.push_back(static_cast<char>((meta.size() >> shift) & 0xFF));
+    }
+    return frame + meta + body;
+}
+
+bool decodes(std::string_view payload) {
+    nlohmann::json header;
+    std::vector<ImageFrame::Image> images;
+    return ImageFrame::decode(payload, header, images);
+}
+
+void check_round_trip(const std::string& frame, const EncodedImage& first, const EncodedImage& second) {
+    nlohmann::json header;
+    std::vector<ImageFrame::Image> images;
+    if (!ImageFrame::is_frame(frame) || !ImageFrame::decode(frame, header, images) || images.size() != 2) {
+        expect(false, "frame does not decode");
+        return;
+    }
+    expect(header.value("trigger", "") == "test", "header fields lost");
+    expect(images[0].size == first.data.size() &&
+           std::equal(first.data.begin(), first.data.end(), images[0].data), "first image changed");
+    expect(images[1].size == second.data.size() &&
+           std::equal(second.data.begin(), second.data.end(), images[1].data), "second image changed");
+}
+
+// Every prefix of a frame is refused
+void check_truncation(const std::string& frame) {
+    for (size_t length = 0; length < frame.size(); length++) {
+        if (decodes(std::string_view(frame).substr(0, length))) {
+            expect(false, "frame cut to " + std::to_string(length) + " of " + std::to_string(frame.size()) +
+                          " bytes accepted");
+            return;
+        }
+    }
+}
+
+// Any flipped image byte fails the hash check
+void check_hash_mismatch(const std::string& frame, size_t image_bytes) {
+    for (size_t i = frame.size() - image_bytes; i < frame.size(); i++) {
+        std::string corrupt = frame;
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x01);
+        if (decodes(corrupt)) {
+            expect(false, "image byte " + std::to_string(i) + " flipped and accepted");
+            return;
+        }
+    }
+
+    // Images swapped under their entries
+    expect(!decodes(make_frame(R"({"images":[{"size":2,"sha256":")" +
+                                   ImageFrame::sha256(reinterpret_cast<const unsigned char*>("ab"), 2) +
+                                   R"("}]})", "ba")), "swapped bytes accepted");
+}
+
+void check_malformed_headers() {
+    expect(!decodes(make_frame("{\"images\":", "")), "unparsable header accepted");
+    expect(!decodes(make_frame("{}", "")), "header without images accepted");
+    expect(!decodes(make_frame(R"({"images":{}})", "")), "images that are not an array accepted");
+    for (const char* meta : { R"({"images":[1]})", R"({"images":[{"size":"2"}]})", R"({"images":[{"size":-1}]})",
+                              R"({"images":[{"size":1.5}]})", R"({"images":[{"sha256":3}]})" }) {
+        expect(!decodes(make_frame(meta, "ab")), std::string("entry accepted: ") + meta);
+    }
+    expect(!decodes(make_frame(R"({"images":[{"size":3}]})", "ab")), "image past the frame accepted");
+
+    std::string frame = make_frame(R"({"images":[]})", "");
+    frame[4] = static_cast<char>(ImageFrame::VERSION + 1);
+    expect(!decodes(frame), "unknown version accepted");
+
+    // Entries without a size or hash are still read
+    nlohmann::json header;
+    std::vector<ImageFrame::Image> images;
+    expect(ImageFrame::decode(make_frame(R"({"images":[{"size":2},{}]})", "ab"), header, images) &&
+           images.size() == 2 && images[0].size == 2 && images[1].size == 0, "minimal entries refused");
+}
+
+} // namespace
+
+int main() {
+    EncodedImage first = make_image(300, 1);
+    EncodedImage second = make_image(17, 99);
+    nlohmann::json header;
+    header["trigger"] = "test";
+    std::string frame = ImageFrame::encode(header, { &first, &second });
+
+    check_round_trip(frame, first, second);
+    check_truncation(frame);
+    check_hash_mismatch(frame, first.data.size() + second.data.size());
+    check_malformed_headers();
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " image frame check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Image frames round trip, and damaged frames are refused" << std::endl;
+    return 0;
+}
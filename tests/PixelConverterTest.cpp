@@ -0,0 +1,163 @@
+#include "../include/PixelConverter.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Checks every PixelConverter kernel against Xlib's own pixel decoding:
+// images are built with XInitImage and filled with XPutPixel, and each
+// converted pixel must match XGetPixel's value decoded through the masks.
+
+namespace {
+
+struct Format {
+    const char* name;
+    int depth;
+    int bits_per_pixel;
+    int byte_order;
+    unsigned long red_mask;
+    unsigned long green_mask;
+    unsigned long blue_mask;
+};
+
+const Format kFormats[] = {
+    { "xRGB 32",           24, 32, LSBFirst, 0xFF0000, 0x00FF00, 0x0000FF },
+    { "xBGR 32",           24, 32, LSBFirst, 0x0000FF, 0x00FF00, 0xFF0000 },
+    { "xRGB 32 MSB-first", 24, 32, MSBFirst, 0xFF0000, 0x00FF00, 0x0000FF },
+    { "30-bit",            30, 32, LSBFirst, 0x3FF00000, 0x000FFC00, 0x000003FF },
+    { "565",               16, 16, LSBFirst, 0xF800, 0x07E0, 0x001F },
+    { "565 MSB-first",     16, 16, MSBFirst, 0xF800, 0x07E0, 0x001F },
+    { "555",               15, 16, LSBFirst, 0x7C00, 0x03E0, 0x001F },
+    { "packed 24",         24, 24, LSBFirst, 0xFF0000, 0x00FF00, 0x0000FF },
+};
+
+const int kWidths[] = { 1, 7, 33, 67 };
+const int kHeight = 3;
+
+// A channel scaled to 8 bits: wider channels keep their top bits, narrower
+// ones repeat their bits so full intensity is 0xFF
+uint32_t channel_to_8bit(unsigned long pixel, unsigned long mask) {
+    if (!mask) {
+        return 0;
+    }
+    int shift = 0;
+    while (!((mask >> shift) & 1)) {
+        shift++;
+    }
+    int bits = 0;
+    while ((mask >> (shift + bits)) & 1) {
+        bits++;
+    }
+    uint64_t value = (pixel & mask) >> shift;
+    uint64_t repeated = 0;
+    int filled = 0;
+    while (filled < 8) {
+        repeated = (repeated << bits) | value;
+        filled += bits;
+    }
+    return static_cast<uint32_t>(repeated >> (filled - 8)) & 0xFF;
+}
+
+uint32_t expected_argb(unsigned long pixel, const Format& format) {
+    return 0xFF000000u | (channel_to_8bit(pixel, format.red_mask) << 16) |
+           (channel_to_8bit(pixel, format.green_mask) << 8) | channel_to_8bit(pixel, format.blue_mask);
+}
+
+const char* simd_name(PixelConverter::Simd simd) {
+    switch (simd) {
+        case PixelConverter::Simd::AVX2: return "AVX2";
+        case PixelConverter::Simd::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+// Convert one image with the kernels allowed at this level
+// @return Number of mismatching pixels
+int check(const Format& format, int width, PixelConverter::Simd simd, std::mt19937& random) {
+    // Rows padded past the pixels, so kernels reading too far show up
+    int bytes_per_line = ((width * format.bits_per_pixel + 31) / 32) * 4 + 8;
+    std::vector<char> data(static_cast<size_t>(bytes_per_line) * kHeight, 0);
+
+    XImage image;
+    std::memset(&image, 0, sizeof(image));
+    image.width = width;
+    image.height = kHeight;
+    image.format = ZPixmap;
+    image.data = data.data();
+    image.byte_order = format.byte_order;
+    image.bitmap_unit = 32;
+    image.bitmap_bit_order = format.byte_order;
+    image.bitmap_pad = 32;
+    image.depth = format.depth;
+    image.bytes_per_line = bytes_per_line;
+    image.bits_per_pixel = format.bits_per_pixel;
+    image.red_mask = format.red_mask;
+    image.green_mask = format.green_mask;
+    image.blue_mask = format.blue_mask;
+    if (!XInitImage(&image)) {
+        std::cerr << "❌ XInitImage failed for " << format.name << std::endl;
+        return 1;
+    }
+
+    // Random pixels, including bits outside the channel masks
+    unsigned long pixel_mask = format.bits_per_pixel >= 32 ? 0xFFFFFFFFul : (1ul << format.bits_per_pixel) - 1;
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < width; x++) {
+            XPutPixel(&image, x, y, random() & pixel_mask);
+        }
+    }
+
+    PixelConverter::set_max_simd(simd);
+    PixelConverter converter(&image);
+    if (!converter.is_valid()) {
+        std::cerr << "❌ " << format.name << " not supported" << std::endl;
+        return 1;
+    }
+
+    int dst_stride = width * 4 + 16;
+    std::vector<uint32_t> dst(static_cast<size_t>(dst_stride / 4) * kHeight, 0);
+    converter.convert(&image, reinterpret_cast<unsigned char*>(dst.data()), dst_stride);
+
+    int mismatches = 0;
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned long pixel = XGetPixel(&image, x, y);
+            uint32_t expected = expected_argb(pixel, format);
+            uint32_t actual = dst[static_cast<size_t>(y) * (dst_stride / 4) + x];
+            if (actual != expected && mismatches++ < 4) {
+                std::cerr << "❌ " << format.name << " (" << converter.kernel_name() << ", " << simd_name(simd)
+                          << ") width " << width << " at " << x << "," << y << ": pixel " << std::hex << pixel
+                          << " gave " << actual << ", expected " << expected << std::dec << std::endl;
+            }
+        }
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(12345);
+    int failures = 0;
+
+    for (PixelConverter::Simd simd : { PixelConverter::Simd::Scalar, PixelConverter::Simd::SSE2,
+                                       PixelConverter::Simd::AVX2 }) {
+        if (simd > PixelConverter::detected_simd()) {
+            std::cout << "⚠️ " << simd_name(simd) << " not supported by this CPU, skipped" << std::endl;
+            continue;
+        }
+        for (const Format& format : kFormats) {
+            for (int width : kWidths) {
+                failures += check(format, width, simd, random) ? 1 : 0;
+            }
+        }
+    }
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " conversion(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ All conversions match XGetPixel" << std::endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "../include/PngEncoder.h"
+#include "../include/WorkerPool.h"
+#include <png.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Decodes PngEncoder output with libpng, which checks the chunk CRCs and the
+// zlib stream's Adler-32, for every preset and for images split into one or
+// several bands, and compares the pixels with the source.
+
+namespace {
+
+struct Size {
+    int width;
+    int height;
+};
+
+const Size kSizes[] = {
+    { 1, 1 },
+    { 33, 7 },
+    { 640, 480 },
+    { 1001, 803 },
+    { 1920, 1080 },
+};
+
+// Noise in the top half and gradients below, so each filter type gets chosen
+void fill_image(RawImage& image, int width, int height, std::mt19937& random) {
+    image.resize(width, height);
+    for (int y = 0; y < height; ++y) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(image.row(y));
+        for (int x = 0; x < width; ++x) {
+            uint32_t rgb = y < height / 2 ? (random() & 0xFFFFFF)
+                                          : ((x & 0xFF) << 16) | ((y & 0xFF) << 8) | ((x + y) & 0xFF);
+            row[x] = 0xFF000000u | rgb;
+        }
+    }
+}
+
+// Encode and decode one image
+// @return Number of failures
+int check(const RawImage& raw, PngEncoder::Preset preset, WorkerPool& pool) {
+    const char* name = PngEncoder::preset_name(preset);
+    PngEncoder encoder(preset, &pool);
+    EncodedImage encoded;
+    if (!encoder.encode(raw, encoded)) {
+        std::cerr << "❌ " << name << " " << raw.width << "x" << raw.height << ": encode failed" << std::endl;
+        return 1;
+    }
+
+    png_image image;
+    std::memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, encoded.data.data(), encoded.data.size())) {
+        std::cerr << "❌ " << name << " " << raw.width << "x" << raw.height << ": " << image.message << std::endl;
+        return 1;
+    }
+    if (static_cast<int>(image.width) != raw.width || static_cast<int>(image.height) != raw.height) {
+        std::cerr << "❌ " << name << " " << raw.width << "x" << raw.height << ": decoded as "
+                  << image.width << "x" << image.height << std::endl;
+        png_image_free(&image);
+        return 1;
+    }
+
+    image.format = PNG_FORMAT_RGB;
+    std::vector<unsigned char> decoded(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, decoded.data(), 0, nullptr)) {
+        std::cerr << "❌ " << name << " " << raw.width << "x" << raw.height << ": " << image.message << std::endl;
+        return 1;
+    }
+
+    for (int y = 0; y < raw.height; ++y) {
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(raw.row(y));
+        const unsigned char* rgb = decoded.data() + static_cast<size_t>(y) * raw.width * 3;
+        for (int x = 0; x < raw.width; ++x) {
+            uint32_t actual = 0xFF000000u | (rgb[x * 3] << 16) | (rgb[x * 3 + 1] << 8) | rgb[x * 3 + 2];
+            if (actual != src[x]) {
+                std::cerr << "❌ " << name << " " << raw.width << "x" << raw.height << " at " << x << "," << y
+                          << ": " << std::hex << actual << ", expected " << src[x] << std::dec << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(12345);
+    // A fixed pool, so large images are split into several bands on any machine
+    WorkerPool pool(4);
+    int failures = 0;
+
+    for (const Size& size : kSizes) {
+        RawImage raw;
+        fill_image(raw, size.width, size.height, random);
+        for (PngEncoder::Preset preset : { PngEncoder::Preset::Fastest, PngEncoder::Preset::Balanced,
+                                           PngEncoder::Preset::Smallest }) {
+            failures += check(raw, preset, pool);
+        }
+    }
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " PNG round trip(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ All PNGs decode to their source pixels" << std::endl;
+    return 0;
+}
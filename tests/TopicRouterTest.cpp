@@ -0,0 +1,111 @@
+#include "../include/TopicRouter.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Checks TopicRouter against the MQTT matching rules: "+" takes exactly
+// one level, "#" any number including none (so "a/#" matches "a"), and
+// wildcards at the first level never match topics starting with "$".
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "❌ " << what << std::endl;
+        failures++;
+    }
+}
+
+// Filters of the handlers matching a topic, sorted
+std::vector<std::string> matching(const TopicRouter& router, const std::string& topic) {
+    std::vector<std::string> filters;
+    for (const auto& route : router.match(topic)) {
+        filters.push_back(route->filter);
+    }
+    std::sort(filters.begin(), filters.end());
+    return filters;
+}
+
+void expect_match(const TopicRouter& router, const std::string& topic, std::vector<std::string> filters) {
+    std::sort(filters.begin(), filters.end());
+    std::vector<std::string> actual = matching(router, topic);
+    if (actual != filters) {
+        std::string got;
+        for (const std::string& filter : actual) {
+            got += (got.empty() ? "" : ", ") + filter;
+        }
+        expect(false, "\"" + topic + "\" matched [" + got + "]");
+    }
+}
+
+uint64_t add(TopicRouter& router, const std::string& filter) {
+    return router.add(filter, TopicRouter::Delivery::NetworkThread, [](std::string_view, std::string_view) {});
+}
+
+void check_matching() {
+    TopicRouter router;
+    for (const char* filter : { "sauron/+/agent/#", "sauron/ui/agent/image", "sauron/+/+/hello", "sauron/#", "#",
+                                "+/+", "+", "$SYS/#", "$SYS/broker/+" }) {
+        expect(add(router, filter) != 0, std::string("filter refused: ") + filter);
+    }
+
+    expect_match(router, "sauron/ui/agent/image",
+                 { "sauron/+/agent/#", "sauron/ui/agent/image", "sauron/#", "#" });
+    expect_match(router, "sauron/agent/ui/hello", { "sauron/+/+/hello", "sauron/#", "#" });
+
+    // "#" takes its parent level too
+    expect_match(router, "sauron/ui/agent", { "sauron/+/agent/#", "sauron/#", "#" });
+    expect_match(router, "sauron", { "sauron/#", "#", "+" });
+    expect_match(router, "sauron/ui", { "sauron/#", "#", "+/+" });
+
+    // "+" takes exactly one level, empty ones included
+    expect_match(router, "sauron//agent/x", { "sauron/+/agent/#", "sauron/#", "#" });
+    expect_match(router, "/", { "#", "+/+" });
+
+    // Only filters starting with "$" match "$" topics
+    expect_match(router, "$SYS/broker/clients", { "$SYS/#", "$SYS/broker/+" });
+    expect_match(router, "$SYS", { "$SYS/#" });
+    expect_match(router, "$other/x", {});
+}
+
+void check_filters() {
+    TopicRouter router;
+    for (const char* filter : { "", "a/#/b", "a/b#", "a/b+", "a/+b/c", "#/a" }) {
+        expect(add(router, filter) == 0, std::string("malformed filter accepted: \"") + filter + "\"");
+    }
+    expect(router.filters().empty(), "malformed filter registered");
+}
+
+void check_remove() {
+    TopicRouter router;
+    uint64_t first = add(router, "sauron/+/agent/#");
+    uint64_t second = add(router, "sauron/+/agent/#");
+    uint64_t other = add(router, "sauron/ui/#");
+
+    std::string unused;
+    expect(router.remove(first, unused) && unused.empty(), "shared filter reported unused");
+    expect_match(router, "sauron/ui/agent/image", { "sauron/+/agent/#", "sauron/ui/#" });
+    expect(router.remove(second, unused) && unused == "sauron/+/agent/#", "last handler's filter not reported");
+    expect(!router.remove(second, unused), "handler removed twice");
+    expect_match(router, "sauron/ui/agent/image", { "sauron/ui/#" });
+    expect(router.filters() == std::vector<std::string>{ "sauron/ui/#" }, "removed filters still listed");
+    (void)other;
+}
+
+} // namespace
+
+int main() {
+    check_matching();
+    check_filters();
+    check_remove();
+
+    if (failures) {
+        std::cerr << "❌ " << failures << " topic router check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✅ Topics route like the broker matches them" << std::endl;
+    return 0;
+}